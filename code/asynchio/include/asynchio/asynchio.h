@@ -8,7 +8,7 @@
  * - Created: 5. April 2009
  * - Lead-Dev: - David Herrmann
  * - Contributors: /
- * - Last-Change: 30. May 2009
+ * - Last-Change: 17. October 2026
  */
 
 /* Main and public header of asynchio.
@@ -24,6 +24,9 @@
 SUNDRY_EXTERN_C_BEGIN
 
 
+#include <stdint.h>
+
+
 /* Return codes.
  * This is a list of all codes which can be returned by functions of
  * asynchio. Every function returns either such a code or nothing.
@@ -85,6 +88,7 @@ SUNDRY_EXTERN_C_BEGIN
  *                 in no way related to the system's memory limit but to the sockets internal
  *                 buffer limit.
  * - ASYN_DENIED: Kernel denied access to perform this action.
+ * - ASYN_INUSE: The requested address is already in use.
  * - ASYN_LAST: This is *NO* valid return code! Don't use it as an return code! This simply is
  *              defined to the number of available error codes.
  */
@@ -99,6 +103,7 @@ enum asyn_ret_t {
     ASYN_TOOMANY,
     ASYN_MEMFAIL,
     ASYN_DENIED,
+    ASYN_INUSE,
     ASYN_LAST
 };
 #define ASYN_G_SUCCESS 0x0001
@@ -161,6 +166,150 @@ extern unsigned int asyn_str2addr(unsigned int type, const char *str, void *addr
 extern void asyn_addr2str(unsigned int type, const void *addr, char *str);
 
 
+/* Socket addresses
+ * A full socket address consists of the address type (ASYN_IPV4 or ASYN_IPV6),
+ * the port in host byte order and the binary IP address as returned by
+ * \asyn_str2addr. IPv4 addresses use only the first ASYN_V4SIZE bytes of \ip.
+ * ASYN_NOADDR as \type marks an empty address. Messages with an empty destination
+ * are sent to the connected peer.
+ */
+#define ASYN_NOADDR 0xffff
+typedef struct asyn_addr_t {
+    unsigned int type;
+    unsigned int port;
+    unsigned char ip[ASYN_V6SIZE];
+} asyn_addr_t;
+
+
+/* Datagram messages
+ * A message describes a single datagram which is received or sent with the batch
+ * functions of the datagram objects.
+ * - \buf: Points to the payload buffer.
+ * - \size: On receive, the size of \buf before the call and the size of the received
+ *          datagram after the call. On send, the size of the payload.
+ * - \addr: On receive, the source address of the datagram. On send, the destination.
+ * - \flags: Set by the receive functions. ASYN_MSG_TRUNC is set if the datagram was
+ *           bigger than \buf and the rest was discarded. ASYN_MSG_PKTINFO is set if
+ *           \dst and \ifindex are valid. On send, ASYN_MSG_PKTINFO makes the datagram
+ *           leave from \dst through \ifindex; all other flags are ignored, but the
+ *           member must be initialized.
+ * - \ret: Set by the send functions. ASYN_DONE if the datagram was queued in the kernel,
+ *         the error code if sending this datagram failed and ASYN_NONE if it was not
+ *         tried because a previous datagram failed or the batch was cut.
+ * - \segsize: Segment size of a super-buffer. A super-buffer contains several datagrams
+ *             of the same size (only the last one may be shorter) which are passed
+ *             through the kernel as one buffer (UDP GSO/GRO on linux).
+ *             On send, \buf is split into datagrams of \segsize bytes by the kernel or
+ *             the network card. 0 or a value not smaller than \size sends a single
+ *             datagram. The kernel limits a super-buffer to 64 segments and 64KB; bigger
+ *             buffers fail with ASYN_NOTSUPP. If the system does not support segmentation
+ *             offload, only single datagrams can be sent.
+ *             On receive, it is set to the size of the datagrams in \buf. It equals \size
+ *             unless ASYN_UDP_SEGMENT is set and the kernel coalesced several datagrams.
+ * - \drops: Set by the receive functions. The number of datagrams the kernel dropped
+ *           on this socket so far because its receive queue was full. Only reported
+ *           if statistics are enabled (see \asyn_udp_stats), otherwise 0.
+ * - \stamp: Set by the receive functions. The time when the datagram reached the host
+ *           in nanoseconds since the epoch, taken by the kernel. Only reported if
+ *           ASYN_UDP_TSTAMP is set, otherwise 0.
+ * - \dst, \ifindex: Set by the receive functions if ASYN_UDP_PKTINFO is set. The
+ *                   destination address of the datagram (the port is 0) and the index
+ *                   of the interface it arrived on. On send, they select the source
+ *                   address and the outgoing interface if ASYN_MSG_PKTINFO is set in
+ *                   \flags, so a received message can be turned into its reply by only
+ *                   replacing the payload: it then leaves from the address the request
+ *                   was sent to, even on sockets bound to the ANY address. An ANY
+ *                   address or index 0 lets the kernel choose. Replies to broadcast or
+ *                   multicast requests must replace \dst by a local address.
+ *
+ * \asyn_stamp_now: Returns the current time on the clock of \stamp, so the
+ *                  difference is the time the datagram spent in the kernel's queue
+ *                  and in the application. Returns 0 if timestamps are not supported.
+ */
+#define ASYN_MSG_TRUNC 0x0001
+#define ASYN_MSG_PKTINFO 0x0002
+typedef struct asyn_msg_t {
+    void *buf;
+    size_t size;
+    asyn_addr_t addr;
+    unsigned int flags;
+    unsigned int ret;
+    size_t segsize;
+    unsigned long drops;
+    uint64_t stamp;
+    asyn_addr_t dst;
+    unsigned int ifindex;
+} asyn_msg_t;
+extern uint64_t asyn_stamp_now(void);
+
+
+/* Buffer pools
+ * A pool hands out packet buffers of a fixed size. The buffers are carved out of big
+ * blocks (see mem_block_alloc) and every buffer and its payload start at a cache line
+ * boundary, so two buffers never share a cache line.
+ *
+ * Buffers are reference counted. A received datagram can be handed to several
+ * processing stages (probably in other threads) without copying it. Every stage
+ * takes its own reference with \asyn_buf_ref and drops it with \asyn_buf_unref. The
+ * buffer returns to its pool when the last reference is dropped.
+ *
+ * A pool has a single owner thread which is the only one allowed to allocate
+ * buffers (normally the thread which receives the datagrams). References can be
+ * dropped from any thread. Buffers which are released by other threads are collected
+ * on a lock-free list which the owner takes over as a whole when it runs out of
+ * buffers, hence, no lock is needed on either side.
+ *
+ * \asyn_buf_t: A buffer. \msg describes the buffer's content: \msg.buf points to the
+ *              payload area of \pool->size bytes and \msg.size is the number of valid
+ *              bytes. The other members of \msg are filled by the receive functions.
+ *              All other members are private.
+ * \asyn_bufpool_t: A pool. \size is the payload size of every buffer and \count the
+ *                  number of buffers which are allocated at once when the pool is
+ *                  empty. All other members are private.
+ *
+ * \asyn_bufpool_init: Initializes a new pool. No buffer is allocated, yet.
+ *      - \size: Payload size of every buffer.
+ *      - \count: Number of buffers which are allocated with one block.
+ *      - Returns: void
+ * \asyn_bufpool_free: Frees all blocks of the pool. All buffers must be released.
+ *      - Returns: void
+ * \asyn_buf_alloc: Returns a buffer of \pool with a reference count of 1 and
+ *                  \msg.size set to the payload size. Must only be called by the
+ *                  owner thread. Like all memoria allocators, this never fails but
+ *                  calls the out-of-memory handler.
+ * \asyn_buf_ref: Takes another reference to \buf.
+ *      - Returns: \buf
+ * \asyn_buf_unref: Drops a reference to \buf. The buffer returns to its pool when
+ *                  this was the last reference. Can be called from any thread.
+ *      - Returns: void
+ */
+#define ASYN_BUF_ALIGN 64
+struct asyn_bufpool_t;
+typedef struct asyn_buf_t {
+    asyn_msg_t msg;
+
+    /* private */
+    struct asyn_bufpool_t *pool;
+    volatile long refs;
+    struct asyn_buf_t *next;
+} asyn_buf_t;
+typedef struct asyn_bufpool_t {
+    size_t size;
+    unsigned int count;
+
+    /* private */
+    size_t stride;
+    asyn_buf_t *local;
+    void * volatile remote;
+    void *blocks;
+} asyn_bufpool_t;
+extern void asyn_bufpool_init(asyn_bufpool_t *pool, size_t size, unsigned int count);
+extern void asyn_bufpool_free(asyn_bufpool_t *pool);
+extern asyn_buf_t *asyn_buf_alloc(asyn_bufpool_t *pool);
+extern asyn_buf_t *asyn_buf_ref(asyn_buf_t *buf);
+extern void asyn_buf_unref(asyn_buf_t *buf);
+
+
 /* UDP object
  * This is a socket using the UDP protocol. You have to allocate this object
  * on the stack or heap and then pass it to \asyn_udp_init to create a new
@@ -196,6 +345,39 @@ extern void asyn_addr2str(unsigned int type, const void *addr, char *str);
  *                     It is recommended to pass this option directly to the init
  *                     function to make the kernel setting this option immediately
  *                     on the new socket.
+ * - ASYN_UDP_SEGMENT: Enables receive segmentation offload. The kernel may coalesce
+ *                     several datagrams of the same size from the same peer into a
+ *                     single super-buffer which is returned with one call. The
+ *                     \segsize member of the message tells where to split it, hence,
+ *                     you have to receive with \asyn_udp_recv_batch when this option
+ *                     is set. Sending super-buffers works without this option. If the
+ *                     system does not support it, the init and ctl functions return
+ *                     ASYN_NOTSUPP.
+ * - ASYN_UDP_REUSEPORT: Allows several sockets to be bound to the same address. The
+ *                       kernel spreads the incoming flows across all of them. This can
+ *                       only be passed to the init function, see \asyn_udp_group_t.
+ * - ASYN_UDP_TSTAMP: Enables kernel receive timestamps. Every received datagram carries
+ *                    the time when it reached the host in its \stamp member (see
+ *                    \asyn_msg_t). Use \asyn_udp_recv_msg or the batch functions to
+ *                    read it. If the system does not support it, the init and ctl
+ *                    functions return ASYN_NOTSUPP.
+ * - ASYN_UDP_PKTINFO: Reports the destination address and the interface of every
+ *                     received datagram in the \dst and \ifindex members of the
+ *                     message (see \asyn_msg_t). A single socket bound to the ANY
+ *                     address can then serve every local address and still send each
+ *                     reply from the address its request was sent to, instead of one
+ *                     socket per local address. Use \asyn_udp_recv_msg or the batch
+ *                     functions to read it. If the system does not support it, the
+ *                     init and ctl functions return ASYN_NOTSUPP.
+ * - ASYN_UDP_AUTOBUF: Sizes the receive and send buffers of the socket by its load
+ *                     (see \asyn_udp_autobuf). A buffer is doubled when the kernel
+ *                     reports drops (SO_RXQ_OVFL on linux), when a send call blocks
+ *                     or when it is more than half full, and halved again when it
+ *                     stayed nearly empty for ASYN_UDP_TUNE_QUIET intervals. Buffers
+ *                     which never overflow thus do not pin kernel memory. The state
+ *                     is checked every ASYN_UDP_TUNE_CALLS receive and send calls of
+ *                     the object, call \asyn_udp_tune from a timer to let idle
+ *                     sockets shrink. The completion ring does not update it.
  *
  * The following actions can be performed on the UDP object:
  * - sending: You can send data over the UDP object to an arbitrary destination.
@@ -212,11 +394,15 @@ extern void asyn_addr2str(unsigned int type, const void *addr, char *str);
  *
  * \asyn_udp_t: Contains the UDP object information. \fd is the system's file
  *              descriptor. \error is the last error which occurred on this UDP
- *              object. Those members can either be directly accessed or with:
+ *              object. \opts are the options which are currently set. \slot is the
+ *              index of the object in a completion ring or -1 (see
+ *              \asyn_ring_attach). Those members can either be directly accessed
+ *              or with:
  *              - \asyn_udp_error: Returns the last error of object \udp.
  *              - \asyn_udp_fd: Returns the fd of object \udp.
  *              \error will be ASYN_NONE when no error occurred on the object yet.
  *              \fd is guaranteed to be always a valid file descriptor (fd >= 0).
+ *              All other members are private.
  *
  * \asyn_udp_init: Initializes a new UDP object. The space has to be allocated by
  *                 the user and is not freed by any function operating on this
@@ -231,6 +417,9 @@ extern void asyn_addr2str(unsigned int type, const void *addr, char *str);
  *               random port.
  *      - Returns: ASYN_DONE: The socket was created successfully with all options set
  *                            and bound to the given address.
+ *                 ASYN_INUSE: The address is already in use.
+ *                 ASYN_DENIED: The kernel denied to bind to the address.
+ *                 Every error of socket creation (ASYN_NOTSUPP, ASYN_TOOMANY, ...).
  *
  * \asyn_udp_close: Closes the socket of the UDP object. The library does not allocate
  *                  any memory to this object so this function does not free anything
@@ -238,22 +427,1467 @@ extern void asyn_addr2str(unsigned int type, const void *addr, char *str);
  *      - \udp: Points to the UDP object.
  *      - Returns: void
  *
- * \asyn_udp_ctl: Modifies the options which are set on the socket. 
+ * \asyn_udp_ctl: Modifies the options which are set on the socket.
+ *      - \opts: The new set of options. Options which are not in \opts are reset.
+ *               ASYN_UDP_CLOEXEC and ASYN_UDP_REUSEPORT can only be set in the init
+ *               function and are ignored.
+ *      - Returns: ASYN_DONE: All options were set.
+ *                 ASYN_NOTSUPP: An option is not supported by the system. All other
+ *                               options are still set.
+ *                 Any other error of the underlying syscall.
+ *
+ * \asyn_udp_autobuf: Sets the bounds of the buffer sizes of \udp, which must have
+ *                    ASYN_UDP_AUTOBUF set. The sizes are meant as reported by the
+ *                    kernel, that is, including its bookkeeping. Both buffers are
+ *                    moved into the new bounds immediately. Enabling the option
+ *                    sets the bounds to the sizes the socket had and ASYN_UDP_BUFMAX.
+ *      - \rmin, \rmax: Bounds of the receive buffer. 0 keeps the current bound.
+ *      - \smin, \smax: Bounds of the send buffer. 0 keeps the current bound.
+ *      - Returns: ASYN_DONE: The bounds were set.
+ *                 ASYN_FAILED: ASYN_UDP_AUTOBUF is not set.
+ *                 Any other error of the underlying syscall.
+ *      Buffers above the system limit (net.core.rmem_max on linux) need a privileged
+ *      process (SO_RCVBUFFORCE). Otherwise the upper bound is silently lowered to the
+ *      limit the first time the kernel caps a buffer.
+ * \asyn_udp_tune: Checks the buffers of \udp at once. The state is only evaluated if
+ *                 ASYN_UDP_TUNE_INTERVAL nanoseconds passed since the last check, so
+ *                 it is cheap to call this from a timer (eg. once a second). A buffer
+ *                 which dropped is grown at most every ASYN_UDP_TUNE_HOLD nanoseconds
+ *                 so a single burst does not push it to the upper bound. Does nothing
+ *                 if ASYN_UDP_AUTOBUF is not set.
+ *      - Returns: void
+ *
+ * \asyn_udp_busypoll: Makes receive calls on the socket poll the network device for
+ *                    up to \usecs microseconds instead of returning ASYN_BLOCKED
+ *                    (or sleeping) at once, and asks the kernel to leave the device
+ *                    queue to these calls (SO_BUSY_POLL and SO_PREFER_BUSY_POLL on
+ *                    linux). This saves the interrupt and wakeup latency at the cost
+ *                    of CPU time; see \asyn_loop_spin. 0 disables it.
+ *      - Returns: ASYN_DONE: The value was set.
+ *                 ASYN_DENIED: \usecs exceeds the system's limit (net.core.busy_read
+ *                              on linux) and the process is not privileged.
+ *                 ASYN_NOTSUPP: Busy polling is not supported.
+ *
+ * \asyn_udp_join: Joins the multicast group \group (the port is ignored) on the
+ *                 interface with index \ifindex (0 lets the kernel choose). If \source
+ *                 is not NULL, only datagrams of this sender are delivered
+ *                 (source-specific multicast); the same group can then be joined for
+ *                 several sources. The socket must be bound to the group's port and
+ *                 have the group's address type. To serve many groups with one
+ *                 socket, see \asyn_mcast_t.
+ *      - Returns: ASYN_DONE: The group was joined.
+ *                 ASYN_INUSE: The group was already joined on this interface.
+ *                 ASYN_FAILED: The interface does not exist or has no address.
+ *                 ASYN_TOOMANY: The socket reached the system's limit of memberships
+ *                               (net.ipv4.igmp_max_memberships and
+ *                               net.ipv4.igmp_max_msf on linux; raise them for feeds
+ *                               with hundreds of groups).
+ *                 ASYN_NOTSUPP: \group is not a multicast address or multicast is not
+ *                               supported.
+ * \asyn_udp_leave: Leaves a group which was joined with the same arguments.
+ *      - Returns: ASYN_DONE: The group was left.
+ *                 ASYN_FAILED: The group was not joined.
+ *                 Every other error of \asyn_udp_join.
+ * \asyn_udp_mcast_hops: Sets the TTL (IPv4) or hop limit (IPv6) of sent multicast
+ *                       datagrams. The system's default is 1, that is, they do not
+ *                       leave the local network.
+ *      - Returns: ASYN_DONE: The value was set.
+ *                 ASYN_NOTSUPP: Invalid value or multicast is not supported.
+ * \asyn_udp_mcast_loop: Enables (\set is not 0, the system's default) or disables the
+ *                       delivery of sent multicast datagrams to members on this host.
+ *      - Returns: Same as \asyn_udp_mcast_hops.
+ *
+ * \asyn_udp_adopt: Initializes \udp with the bound UDP socket \fd, normally one which
+ *                  was received from another process (see \asyn_unix_recv). The
+ *                  options \opts are set like with \asyn_udp_ctl.
+ *      - Returns: ASYN_DONE: \udp is ready.
+ *                 Every error of \asyn_udp_ctl. \fd is closed then.
+ *
+ * \asyn_udp_addr: Saves the local address of the socket in \addr. If the socket was
+ *                 bound to port 0, this returns the port which the kernel picked.
+ *      - Returns: ASYN_DONE: The address was saved.
+ *                 Any other error of the underlying syscall.
+ *
+ * \asyn_udp_recv: Receives a single datagram.
+ *      - \buf: Points to the buffer which receives the payload.
+ *      - \size: Size of \buf. After the call it contains the size of the payload. If
+ *               the datagram was bigger than \buf, the rest is discarded.
+ *      - \addr: If not NULL, the source address is saved here.
+ *      - Returns: ASYN_DONE: A datagram was received.
+ *                 ASYN_BLOCKED: The socket is nonblocking and no datagram is queued.
+ *                 ASYN_FAILED: A previous datagram caused an error (eg. ICMP port
+ *                              unreachable). The socket is still usable.
+ *                 ASYN_MEMFAIL: The kernel could not allocate enough memory.
+ *                 ASYN_SYSCALL: Unknown error. The socket should be closed.
+ *
+ * \asyn_udp_recv_msg: Same as \asyn_udp_recv but receives into the message \msg, so
+ *                     all per-datagram information (eg. the timestamp) is returned.
+ *                     The \buf and \size members must be set by the caller.
+ *      - Returns: Same as \asyn_udp_recv.
+ *
+ * \asyn_udp_recv_batch: Receives up to \count datagrams into the array \msgs with as
+ *                       few syscalls as possible (a single recvmmsg() on linux).
+ *                       The \buf and \size members of every message must be set by
+ *                       the caller. On blocking sockets the call blocks until the first
+ *                       datagram is available and then returns all datagrams which are
+ *                       queued (partial batch).
+ *      - \done: The number of received datagrams is saved here. This is always
+ *               greater than 0 if ASYN_DONE is returned.
+ *      - Returns: Same as \asyn_udp_recv. Errors are only returned if no datagram was
+ *                 received, otherwise they are returned by the next call.
+ *
+ * \asyn_udp_recv_pool: Same as \asyn_udp_recv_batch but the datagrams are received
+ *                      directly into buffers of \pool. The buffers are saved in \bufs
+ *                      and the caller owns one reference to each of them. Must only
+ *                      be called by the owner thread of \pool.
+ *      - Returns: Same as \asyn_udp_recv_batch.
+ *
+ * \asyn_udp_send: Sends a single datagram.
+ *      - \buf: Points to the payload.
+ *      - \size: Size of the payload. After the call it contains the number of sent
+ *               bytes which is either 0 or the full payload.
+ *      - \addr: The destination. NULL sends to the connected peer.
+ *      - Returns: ASYN_DONE: The datagram was queued.
+ *                 ASYN_BLOCKED: The socket is nonblocking and the send buffer is full.
+ *                 ASYN_FAILED: The datagram could not be sent (eg. too big or network
+ *                              unreachable). The socket is still usable.
+ *                 ASYN_DENIED: Sending to this address is not allowed (eg. broadcast).
+ *                 ASYN_MEMFAIL: The kernel could not allocate enough memory.
+ *                 ASYN_SYSCALL: Unknown error. The socket should be closed.
+ *
+ * \asyn_udp_connect: Connects the socket to the peer \addr (the type must match the
+ *                    socket). The kernel then looks the route up only once, delivers
+ *                    only datagrams of this peer and reports ICMP errors of the peer
+ *                    (eg. port unreachable) as ASYN_FAILED on the next call. NULL
+ *                    dissolves the association. Sockets which talk to a single server
+ *                    should always be connected and use the peer functions below.
+ *      - Returns: ASYN_DONE: The socket is connected.
+ *                 ASYN_FAILED: The peer is unreachable.
+ *                 ASYN_DENIED: Sending to this address is not allowed.
+ *                 ASYN_NOTSUPP: Invalid address.
+ *                 Every other error of \asyn_tcp_connect.
+ *
+ * \asyn_udp_send_peer: Same as \asyn_udp_send to the connected peer, but without any
+ *                      address or control message processing (a plain send()).
+ *      - Returns: Same as \asyn_udp_send.
+ *
+ * \asyn_udp_recv_peer: Same as \asyn_udp_recv on a connected socket, but without any
+ *                      address or control message processing (a plain recv()). Drops
+ *                      (see \asyn_udp_stats) and timestamps are not reported, use
+ *                      \asyn_udp_recv_msg for them. Datagrams which do not fit are
+ *                      cut to the size of \buf.
+ *      - Returns: Same as \asyn_udp_recv.
+ *
+ * \asyn_udp_send_batch: Sends up to \count datagrams from the array \msgs with as few
+ *                       syscalls as possible (a single sendmmsg() on linux). Every
+ *                       message can have a different destination. The \ret member of
+ *                       every message reports whether it was sent.
+ *      - \done: The number of sent datagrams is saved here. The datagrams are always
+ *               sent in order, that is, the first \done messages were sent and the
+ *               rest has to be passed again to send them.
+ *      - Returns: Same as \asyn_udp_send. Errors are only returned if no datagram was
+ *                 sent, otherwise they are returned by the next call.
+ *
+ * \asyn_udp_stats: Attaches the statistics block \stats to \udp and resets it. NULL
+ *                  detaches the current block. The counters are updated by every
+ *                  receive and send function of \udp with plain (non-atomic) writes,
+ *                  so they cost nearly nothing on the hot path. The memory is managed
+ *                  by the user. Attaching also enables the kernel's drop counter
+ *                  (SO_RXQ_OVFL on linux). The completion ring does not update them.
+ *      - Returns: ASYN_DONE: The block was attached.
+ *                 ASYN_NOTSUPP: The system does not report kernel drops. The block is
+ *                               attached nevertheless, only \drops stays 0.
+ *                 ASYN_MEMFAIL: The kernel could not allocate memory. Not attached.
+ *                 ASYN_SYSCALL: Unknown error. Not attached.
+ * \asyn_udp_stats_t: The statistics of one socket. A super-buffer (see \asyn_msg_t)
+ *                    counts as \segsize datagrams.
+ *      - \pkts_in, \bytes_in: Received datagrams and payload bytes.
+ *      - \pkts_out, \bytes_out: Sent datagrams and payload bytes.
+ *      - \blocked_in, \blocked_out: Calls which returned ASYN_BLOCKED.
+ *      - \errors_in, \errors_out: Calls which failed with any other error.
+ *      - \truncated: Datagrams which did not fit into the buffer (ASYN_MSG_TRUNC).
+ *      - \drops: Datagrams which the kernel dropped because the receive queue was
+ *                full. The kernel reports this counter with every received datagram,
+ *                hence, it is only updated when the next datagram arrives.
+ * \asyn_udp_stats_snapshot: Sums up the statistics of the \count sockets in the array
+ *                           \udps (eg. the sockets of a \asyn_udp_group_t) into \sum.
+ *                           Sockets without a statistics block are skipped. It can be
+ *                           called from any thread, but the counters of sockets which
+ *                           are used at the same time may be slightly out of date.
+ *      - Returns: void
  */
+typedef struct asyn_udp_stats_t {
+    uint64_t pkts_in;
+    uint64_t bytes_in;
+    uint64_t pkts_out;
+    uint64_t bytes_out;
+    uint64_t blocked_in;
+    uint64_t blocked_out;
+    uint64_t errors_in;
+    uint64_t errors_out;
+    uint64_t truncated;
+    uint64_t drops;
+} asyn_udp_stats_t;
+typedef struct asyn_udp_tune_t {
+    size_t rmin;
+    size_t rmax;
+    size_t smin;
+    size_t smax;
+    size_t rcvbuf;
+    size_t sndbuf;
+    unsigned long drops;
+    unsigned int primed;
+    unsigned int rpress;
+    unsigned int spress;
+    unsigned int rquiet;
+    unsigned int squiet;
+    unsigned int noforce;
+    unsigned int calls;
+    uint64_t stamp;
+    uint64_t grown;
+} asyn_udp_tune_t;
 typedef struct asyn_udp_t {
     signed int fd;
     unsigned int error;
+    unsigned int opts;
+    signed int slot;
+    asyn_udp_stats_t *stats;
+
+    /* private */
+    asyn_udp_tune_t tune;
 } asyn_udp_t;
 #define asyn_udp_error(udp) ((udp)->error)
 #define asyn_udp_fd(udp) ((udp)->fd)
 #define ASYN_UDP_NBLOCK 0x0001
 #define ASYN_UDP_CLOEXEC 0x0002
+#define ASYN_UDP_SEGMENT 0x0004
+#define ASYN_UDP_REUSEPORT 0x0008
+#define ASYN_UDP_TSTAMP 0x0010
+#define ASYN_UDP_PKTINFO 0x0020
+#define ASYN_UDP_AUTOBUF 0x0040
+#define ASYN_UDP_BUFMAX (16 * 1024 * 1024)
+#define ASYN_UDP_TUNE_CALLS 4096
+#define ASYN_UDP_TUNE_INTERVAL 1000000000
+#define ASYN_UDP_TUNE_HOLD 10000000
+#define ASYN_UDP_TUNE_QUIET 8
 extern unsigned int asyn_udp_init(asyn_udp_t *udp, unsigned int opts, unsigned int type, const void *addr, unsigned int port);
 extern void asyn_udp_close(asyn_udp_t *udp);
 extern unsigned int asyn_udp_ctl(asyn_udp_t *udp, unsigned int opts);
-extern unsigned int asyn_udp_addr(asyn_udp_t *udp, unsigned int *type, void *addr);
-extern unsigned int asyn_udp_send(asyn_udp_t *udp, const void *buf, size_t *size);
-extern unsigned int asyn_udp_recv(asyn_udp_t *udp, void *buf, size_t *size);
+extern unsigned int asyn_udp_adopt(asyn_udp_t *udp, signed int fd, unsigned int opts);
+extern unsigned int asyn_udp_autobuf(asyn_udp_t *udp, size_t rmin, size_t rmax, size_t smin, size_t smax);
+extern void asyn_udp_tune(asyn_udp_t *udp);
+extern unsigned int asyn_udp_busypoll(asyn_udp_t *udp, unsigned int usecs);
+extern unsigned int asyn_udp_join(asyn_udp_t *udp, const asyn_addr_t *group, const asyn_addr_t *source, unsigned int ifindex);
+extern unsigned int asyn_udp_leave(asyn_udp_t *udp, const asyn_addr_t *group, const asyn_addr_t *source, unsigned int ifindex);
+extern unsigned int asyn_udp_mcast_hops(asyn_udp_t *udp, unsigned int hops);
+extern unsigned int asyn_udp_mcast_loop(asyn_udp_t *udp, unsigned int set);
+extern unsigned int asyn_udp_addr(asyn_udp_t *udp, asyn_addr_t *addr);
+extern unsigned int asyn_udp_send(asyn_udp_t *udp, const void *buf, size_t *size, const asyn_addr_t *addr);
+extern unsigned int asyn_udp_connect(asyn_udp_t *udp, const asyn_addr_t *addr);
+extern unsigned int asyn_udp_send_peer(asyn_udp_t *udp, const void *buf, size_t *size);
+extern unsigned int asyn_udp_recv_peer(asyn_udp_t *udp, void *buf, size_t *size);
+extern unsigned int asyn_udp_send_batch(asyn_udp_t *udp, asyn_msg_t *msgs, unsigned int count, unsigned int *done);
+extern unsigned int asyn_udp_stats(asyn_udp_t *udp, asyn_udp_stats_t *stats);
+extern void asyn_udp_stats_snapshot(asyn_udp_stats_t *sum, const asyn_udp_t *udps, unsigned int count);
+extern unsigned int asyn_udp_recv(asyn_udp_t *udp, void *buf, size_t *size, asyn_addr_t *addr);
+extern unsigned int asyn_udp_recv_msg(asyn_udp_t *udp, asyn_msg_t *msg);
+extern unsigned int asyn_udp_recv_batch(asyn_udp_t *udp, asyn_msg_t *msgs, unsigned int count, unsigned int *done);
+extern unsigned int asyn_udp_recv_pool(asyn_udp_t *udp, asyn_bufpool_t *pool, asyn_buf_t **bufs, unsigned int count, unsigned int *done);
+
+
+/* UDP groups
+ * A group serves a single UDP port with several worker threads. Every worker owns
+ * its own socket, all of them are bound to the same address with ASYN_UDP_REUSEPORT.
+ * The kernel distributes the incoming flows across the sockets by a hash of the
+ * addresses, hence, all datagrams of one peer arrive at the same worker and the
+ * workers never share a socket or its receive queue.
+ *
+ * \asyn_udp_group_t: \count is the number of sockets/workers and \udps is the array
+ *                    of sockets. \arg is the user defined pointer which was passed to
+ *                    \asyn_udp_group_start. All other members are private.
+ *
+ * \asyn_udp_worker_t: The function which runs in every worker thread. \udp is the
+ *                     socket of the worker and \index its position in \group->udps.
+ *                     The worker must return when \asyn_udp_group_stopped is true.
+ *                     When the group is freed, all sockets are shut down so blocking
+ *                     calls return immediately (receiving 0 bytes or failing).
+ *
+ * \asyn_udp_group_init: Opens \count sockets bound to the same address. The
+ *                       arguments are the same as of \asyn_udp_init, ASYN_UDP_REUSEPORT
+ *                       is always set. If \port is 0, the first socket picks a random
+ *                       port and all others are bound to it.
+ *      - Returns: ASYN_DONE: All sockets were opened.
+ *                 ASYN_NOTSUPP: The system cannot share ports between sockets.
+ *                 Every error of \asyn_udp_init. No socket is left open on errors.
+ * \asyn_udp_group_start: Starts one thread per socket which runs \fn.
+ *      - Returns: ASYN_DONE: All workers are running.
+ *                 ASYN_TOOMANY: Not all threads could be created. The started threads
+ *                               are stopped again and the sockets are shut down,
+ *                               so the group can only be freed.
+ * \asyn_udp_group_free: Stops all workers, waits for them and closes all sockets.
+ *                       Must not be called from a worker.
+ *      - Returns: void
+ * \asyn_udp_group_stopped: Returns not 0 if the workers have to return.
+ */
+struct asyn_udp_group_t;
+typedef void (*asyn_udp_worker_t)(struct asyn_udp_group_t *group, asyn_udp_t *udp, unsigned int index);
+typedef struct asyn_udp_group_t {
+    unsigned int count;
+    asyn_udp_t *udps;
+    void *arg;
+
+    /* private */
+    asyn_udp_worker_t fn;
+    void *workers;
+    unsigned int running;
+    volatile unsigned int stop;
+} asyn_udp_group_t;
+extern unsigned int asyn_udp_group_init(asyn_udp_group_t *group, unsigned int count, unsigned int opts, unsigned int type, const void *addr, unsigned int port);
+extern unsigned int asyn_udp_group_start(asyn_udp_group_t *group, asyn_udp_worker_t fn, void *arg);
+extern void asyn_udp_group_free(asyn_udp_group_t *group);
+#define asyn_udp_group_stopped(group) ((group)->stop)
+
+
+/* UDP send queues
+ * A send queue catches the datagrams which a nonblocking UDP socket cannot take
+ * because its send buffer is full, instead of making the caller drop them or spin.
+ * The queue is a bounded ring of \count slots. Every slot owns a buffer of \bufsize
+ * bytes, so the payload is copied once when it is queued and no memory is allocated
+ * afterwards. Bigger datagrams are only sent if they can go out immediately, they are
+ * never queued. When the socket becomes writable again, the queued datagrams are sent
+ * in order with a single batch call (sendmmsg() on linux) per flush.
+ *
+ * Register the socket on the event loop with ASYN_EV_WRITE and call \asyn_outq_flush
+ * in the write callback. Readiness is edge-triggered, so the callback only runs when
+ * the send buffer drains after it was full and costs nothing otherwise.
+ *
+ * When the ring is full, the \policy of the queue decides:
+ * - ASYN_OUTQ_REPORT: The new datagram is not queued and ASYN_BLOCKED is returned,
+ *                     so the caller decides what to do (default).
+ * - ASYN_OUTQ_DROPNEW: The new datagram is dropped.
+ * - ASYN_OUTQ_DROPOLD: The oldest queued datagram is dropped to make room for the
+ *                      new one, which is usually the better choice for replies that
+ *                      become stale.
+ * Dropped datagrams are counted in \dropped.
+ *
+ * Producers can slow down before datagrams are lost: if \fn is set, it is called with
+ * ASYN_OUTQ_HIGH when the number of queued datagrams reaches \high and with
+ * ASYN_OUTQ_LOW when it falls back to \low after that. Both default to 3/4 and 1/4
+ * of \count.
+ *
+ * \asyn_outq_t: The queue. \udp is the socket, \count the number of slots and \bufsize
+ *               the size of every slot. \policy, \high, \low, \fn and \arg can be
+ *               changed at any time. \queued is the number of queued datagrams,
+ *               \dropped counts the datagrams which were dropped by the policy and
+ *               \failed those which the kernel refused when they were flushed (eg.
+ *               network unreachable). All other members are private.
+ * \asyn_outq_fn_t: The watermark callback. \event is ASYN_OUTQ_HIGH or ASYN_OUTQ_LOW.
+ *
+ * \asyn_outq_init: Initializes the queue \outq for the nonblocking socket \udp.
+ *      - Returns: void
+ * \asyn_outq_free: Drops all queued datagrams and frees the slots.
+ *      - Returns: void
+ * \asyn_outq_send: Sends a single datagram like \asyn_udp_send or queues it if the
+ *                  socket is blocked. If datagrams are queued already, the datagram is
+ *                  queued behind them without a syscall so the order is preserved.
+ *      - Returns: ASYN_DONE: The datagram was sent, queued or dropped by the policy.
+ *                 ASYN_BLOCKED: The ring is full and the policy is ASYN_OUTQ_REPORT.
+ *                 ASYN_FAILED: The datagram is bigger than \bufsize and could not be
+ *                              sent immediately. It is not queued, so do not retry.
+ *                 Every other error of \asyn_udp_send.
+ * \asyn_outq_flush: Sends up to ASYN_OUTQ_BATCH queued datagrams with a single call.
+ *                   Datagrams which the kernel refuses are dropped and counted in
+ *                   \failed. The return values fit the loop's callback contract.
+ *      - Returns: ASYN_DONE: Datagrams were sent and more are queued.
+ *                 ASYN_BLOCKED: The queue is empty or the socket is blocked again.
+ *                 ASYN_SYSCALL: Unknown error. The socket should be closed.
+ */
+#define ASYN_OUTQ_REPORT 0
+#define ASYN_OUTQ_DROPNEW 1
+#define ASYN_OUTQ_DROPOLD 2
+#define ASYN_OUTQ_HIGH 1
+#define ASYN_OUTQ_LOW 2
+#define ASYN_OUTQ_BATCH 64
+struct asyn_outq_t;
+typedef void (*asyn_outq_fn_t)(struct asyn_outq_t *outq, unsigned int event);
+typedef struct asyn_outq_t {
+    asyn_udp_t *udp;
+    unsigned int count;
+    size_t bufsize;
+    unsigned int policy;
+    unsigned int high;
+    unsigned int low;
+    asyn_outq_fn_t fn;
+    void *arg;
+    unsigned int queued;
+    uint64_t dropped;
+    uint64_t failed;
+
+    /* private */
+    asyn_msg_t *msgs;
+    unsigned char *bufs;
+    unsigned int head;
+    unsigned int pressure;
+} asyn_outq_t;
+extern void asyn_outq_init(asyn_outq_t *outq, asyn_udp_t *udp, unsigned int count, size_t bufsize);
+extern void asyn_outq_free(asyn_outq_t *outq);
+extern unsigned int asyn_outq_send(asyn_outq_t *outq, const void *buf, size_t size, const asyn_addr_t *addr);
+extern unsigned int asyn_outq_flush(asyn_outq_t *outq);
+
+
+/* Multicast demultiplexer
+ * A feed which is spread across hundreds of multicast groups does not need one socket
+ * per group. A single socket bound to the feed's port joins all groups and the
+ * demultiplexer routes every received datagram to the handler of its group, which
+ * it finds with a hash lookup of the datagram's destination address. This needs the
+ * destination address of every datagram, so ASYN_UDP_PKTINFO is enabled on the
+ * socket. All groups must use the same port and the address type of the socket.
+ *
+ * Source-specific groups are matched by group and sender, so several sources of
+ * the same group can have different handlers. Any-source groups match every sender.
+ * A group address is either joined for any source or for single sources on one
+ * socket and interface, the system does not allow to mix both. Datagrams are routed
+ * to the groups of the interface they arrived on; groups which let the kernel choose
+ * the interface get the datagrams which match no group of that interface.
+ *
+ * \asyn_mgroup_t: A group. \addr is the group address, \source the sender of a
+ *                 source-specific group (type ASYN_NOADDR for any source) and \ifindex
+ *                 the interface to join on (0 lets the kernel choose). \fn is called
+ *                 for every datagram of the group and \arg is a user defined pointer.
+ *                 \pkts counts the routed datagrams. The memory is managed by the
+ *                 user and must stay valid while the group is added. All other
+ *                 members are private.
+ * \asyn_mgroup_fn_t: The handler. \group is NULL when the fallback handler is called.
+ * \asyn_mcast_t: The demultiplexer. \udp is the socket. \fallback (if not NULL) is
+ *                called for datagrams which match no group (eg. unicast datagrams or
+ *                groups which were just left), \arg is a user defined pointer.
+ *                \count is the number of added groups and \unknown counts the
+ *                datagrams which matched no group. All other members are private.
+ *
+ * \asyn_mcast_init: Initializes \mcast for the bound socket \udp and enables
+ *                   ASYN_UDP_PKTINFO on it. \buckets is the size of the hash table
+ *                   (rounded up to a power of 2, 0 uses ASYN_MCAST_BUCKETS); use about
+ *                   the number of expected groups.
+ *      - Returns: ASYN_DONE: The demultiplexer is ready.
+ *                 Every error of \asyn_udp_ctl. Nothing is allocated then.
+ * \asyn_mcast_free: Leaves all groups and frees the hash table. The socket is not
+ *                   closed.
+ *      - Returns: void
+ * \asyn_mcast_add: Joins \group on the socket and adds it.
+ *      - Returns: ASYN_DONE: The group was joined and added.
+ *                 ASYN_INUSE: The group address was already added on this interface
+ *                             in the other mode (any-source or source-specific).
+ *                 Every error of \asyn_udp_join. The group was not added then.
+ * \asyn_mcast_del: Leaves \group and removes it. It can be called from a handler,
+ *                  even for the current group.
+ *      - Returns: void
+ * \asyn_mcast_dispatch: Routes the \count received messages \msgs to their handlers.
+ *      - Returns: void
+ * \asyn_mcast_recv: Receives up to \count datagrams into \msgs with a single call (see
+ *                   \asyn_udp_recv_batch) and routes them. The \buf and \size members
+ *                   of every message must be set by the caller; sizes are restored for
+ *                   the next call. The return values fit the loop's callback contract,
+ *                   so this can be called directly in the read callback.
+ *      - Returns: Same as \asyn_udp_recv_batch.
+ */
+#define ASYN_MCAST_BUCKETS 256
+struct asyn_mcast_t;
+struct asyn_mgroup_t;
+typedef void (*asyn_mgroup_fn_t)(struct asyn_mcast_t *mcast, struct asyn_mgroup_t *group, asyn_msg_t *msg);
+typedef struct asyn_mgroup_t {
+    asyn_addr_t addr;
+    asyn_addr_t source;
+    unsigned int ifindex;
+    asyn_mgroup_fn_t fn;
+    void *arg;
+    uint64_t pkts;
+
+    /* private */
+    struct asyn_mgroup_t *next;
+} asyn_mgroup_t;
+typedef struct asyn_mcast_t {
+    asyn_udp_t *udp;
+    asyn_mgroup_fn_t fallback;
+    void *arg;
+    size_t count;
+    uint64_t unknown;
+
+    /* private */
+    asyn_mgroup_t **buckets;
+    unsigned int mask;
+} asyn_mcast_t;
+extern unsigned int asyn_mcast_init(asyn_mcast_t *mcast, asyn_udp_t *udp, unsigned int buckets);
+extern void asyn_mcast_free(asyn_mcast_t *mcast);
+extern unsigned int asyn_mcast_add(asyn_mcast_t *mcast, asyn_mgroup_t *group);
+extern void asyn_mcast_del(asyn_mcast_t *mcast, asyn_mgroup_t *group);
+extern void asyn_mcast_dispatch(asyn_mcast_t *mcast, asyn_msg_t *msgs, unsigned int count);
+extern unsigned int asyn_mcast_recv(asyn_mcast_t *mcast, asyn_msg_t *msgs, unsigned int count);
+
+
+/* TCP object
+ * This is a stream socket using the TCP protocol. Like the UDP object it is allocated
+ * by the user and initialized either as listening socket with \asyn_tcp_listen, as
+ * outgoing connection with \asyn_tcp_connect or as incoming connection with
+ * \asyn_tcp_accept. Close it with \asyn_tcp_close.
+ *
+ * The object is designed for event loops which serve many connections with a single
+ * thread, hence, it is normally used with ASYN_TCP_NBLOCK:
+ * - Listening sockets become readable when connections are pending. Drain them with
+ *   \asyn_tcp_accept_batch which accepts many connections per call and sets the new
+ *   sockets' options atomically (accept4() on linux).
+ * - A nonblocking connect returns ASYN_BLOCKED. The socket becomes writable when the
+ *   connection is established or failed, then \asyn_tcp_connected returns the result.
+ * - Outgoing data is queued as a chain of user buffers (\asyn_chunk_t) with
+ *   \asyn_tcp_queue and written with as few syscalls as possible by \asyn_tcp_flush,
+ *   which passes up to 64 chunks to a single gather write (writev()). When the socket
+ *   is not writable, the rest stays queued; flush again when it becomes writable.
+ * - Files are streamed by queueing file chunks. Their data is moved from the file to
+ *   the socket by the kernel without passing a user buffer (sendfile() on linux). If
+ *   the file does not support it, the data is moved through a pipe (splice()) or, at
+ *   last, copied through a small buffer. A partly sent file chunk stays queued like
+ *   every other chunk.
+ *
+ * Options:
+ * - ASYN_TCP_NBLOCK: Nonblocking mode, see ASYN_UDP_NBLOCK.
+ * - ASYN_TCP_CLOEXEC: Do not inherit the socket on exec(), see ASYN_UDP_CLOEXEC.
+ * - ASYN_TCP_NODELAY: Disables Nagle's algorithm, that is, small writes are sent
+ *                     immediately. \asyn_tcp_flush already merges small chunks, so
+ *                     this is normally what you want.
+ * - ASYN_TCP_ZEROCOPY: Sends queued chunks without copying them into the socket buffer
+ *                      (MSG_ZEROCOPY on linux). The kernel sends directly from the
+ *                      chunk's pages, so a chunk is only released when the kernel
+ *                      reports that it is done with it, which is after the peer
+ *                      acknowledged the data. \asyn_tcp_flush collects these reports
+ *                      from the socket's error queue. Pinning pages costs more than
+ *                      copying small buffers, hence, writes of less than
+ *                      ASYN_TCP_ZCMIN bytes are copied as usual. \asyn_tcp_send always
+ *                      copies. If the system does not support it, the option is
+ *                      silently dropped from \opts.
+ *                      \asyn_tcp_close cannot wait for the reports of a closed
+ *                      socket and releases these chunks, too, but the kernel may
+ *                      still transmit from them while the connection lingers.
+ *                      Hence, buffers which were released by \asyn_tcp_close must
+ *                      not be overwritten or reused; queue only data with this
+ *                      option which does not change afterwards.
+ * Options passed to \asyn_tcp_listen are not inherited by accepted connections, pass
+ * them to the accept functions.
+ *
+ * Connection errors (reset, refused, timed out, broken pipe) are returned as
+ * ASYN_FAILED. The connection is unusable then and should be closed.
+ *
+ * \asyn_chunk_t: An output buffer. \buf and \size describe the data and \fn (if not
+ *                NULL) is called when the chunk is not needed anymore, either because
+ *                it was written completely or because the connection was closed. \arg
+ *                is a user defined pointer. All other members are private. The chunk
+ *                and its data are owned by the connection until \fn is called.
+ *                If \buf is NULL, the chunk is a file chunk and describes \size bytes
+ *                of the file descriptor \file starting at offset \foff. The file's
+ *                position is not changed, so one file may be queued on many
+ *                connections at once. \file must stay open until \fn is called.
+ * \asyn_chunk_fn_t: Release callback of a chunk. \sent is the number of bytes of the
+ *                   chunk which were written. It may free or requeue the chunk.
+ *
+ * \asyn_tcp_listen: Creates a listening socket bound to \addr and \port (see
+ *                   \asyn_udp_init). SO_REUSEADDR is always set.
+ *      - \backlog: The size of the queue of pending connections. 0 uses
+ *                  ASYN_TCP_BACKLOG. The kernel may cut it.
+ *      - Returns: ASYN_DONE: The socket is listening.
+ *                 Every error of \asyn_udp_init.
+ * \asyn_tcp_accept: Accepts a single connection into \tcp with the options \opts and
+ *                   saves the peer's address in \addr if it is not NULL.
+ *      - Returns: ASYN_DONE: A connection was accepted.
+ *                 ASYN_BLOCKED: No connection is pending.
+ *                 ASYN_FAILED: The connection was aborted before it was accepted.
+ *                              Simply try again.
+ *                 ASYN_TOOMANY: Too many open file descriptors.
+ *                 ASYN_MEMFAIL: The kernel could not allocate enough memory.
+ *                 ASYN_DENIED: A firewall rule denied the connection.
+ *                 ASYN_NOTSUPP: \listener is not a listening socket.
+ *                 ASYN_SYSCALL: Unknown error.
+ * \asyn_tcp_accept_batch: Accepts up to \count connections into the array \tcps. If
+ *                         \addrs is not NULL, the peer addresses are saved in it.
+ *                         Aborted connections are skipped.
+ *      - \done: The number of accepted connections is saved here. This is always
+ *               greater than 0 if ASYN_DONE is returned.
+ *      - Returns: Same as \asyn_tcp_accept. Errors are only returned if no connection
+ *                 was accepted, otherwise they are returned by the next call.
+ * \asyn_tcp_connect: Creates a new socket with the options \opts and connects it to
+ *                    \addr and \port. \type is ASYN_IPV4 or ASYN_IPV6.
+ *      - Returns: ASYN_DONE: The connection is established.
+ *                 ASYN_BLOCKED: The socket is nonblocking and the connection is in
+ *                               progress. Wait until the socket is writable, then call
+ *                               \asyn_tcp_connected.
+ *                 ASYN_FAILED: The peer refused the connection or is unreachable.
+ *                 ASYN_INUSE: No free local address or port.
+ *                 ASYN_TOOMANY: Too many open file descriptors or no free local port.
+ *                 Every other error of \asyn_udp_init.
+ *                 The socket is closed on every code but ASYN_DONE and ASYN_BLOCKED.
+ * \asyn_tcp_connected: Returns the result of a nonblocking connect: ASYN_DONE if it is
+ *                      established, ASYN_BLOCKED if it is still in progress and the
+ *                      error code of \asyn_tcp_connect if it failed.
+ * \asyn_tcp_adopt: Initializes \tcp with the connected or listening TCP socket \fd,
+ *                  normally one which was received from another process (see
+ *                  \asyn_unix_recv). Sets the options \opts but ASYN_TCP_CLOEXEC.
+ *      - Returns: ASYN_DONE: \tcp is ready.
+ *                 Every error of \asyn_udp_ctl. \fd is closed then.
+ * \asyn_tcp_addr: Saves the local address of the socket in \addr. See \asyn_udp_addr.
+ * \asyn_tcp_close: Reaps the zero-copy notifications (see \asyn_tcp_reap) and closes
+ *                  the socket. Queued chunks are released, see ASYN_TCP_ZEROCOPY.
+ *      - Returns: void
+ * \asyn_tcp_recv: Reads up to \*size bytes into \buf. The number of read bytes is
+ *                 saved in \size.
+ *      - Returns: ASYN_DONE: Data was read.
+ *                 ASYN_BLOCKED: The socket is nonblocking and no data is available.
+ *                 ASYN_NONE: The peer closed the connection (end of stream).
+ *                 ASYN_FAILED: The connection broke.
+ *                 ASYN_MEMFAIL: The kernel could not allocate enough memory.
+ *                 ASYN_SYSCALL: Unknown error. The socket should be closed.
+ * \asyn_tcp_send: Writes up to \*size bytes of \buf directly, bypassing the output
+ *                 queue. The number of written bytes is saved in \size. Do not use it
+ *                 while chunks are queued, otherwise the data is reordered.
+ *      - Returns: Same as \asyn_tcp_recv but never ASYN_NONE.
+ * \asyn_tcp_queue: Appends \chunk to the output queue. This never calls the kernel.
+ *      - Returns: void
+ * \asyn_tcp_flush: Releases chunks which completed zero-copy transmission (see
+ *                  \asyn_tcp_reap) and writes queued chunks until the queue is empty or
+ *                  the socket blocks.
+ *      - Returns: ASYN_DONE: The queue is empty. Zero-copy chunks may still wait for
+ *                            their release.
+ *                 ASYN_BLOCKED: The socket is not writable, chunks are still queued.
+ *                 ASYN_NONE: A file chunk reaches behind the end of its file.
+ *                            The connection should be closed.
+ *                 ASYN_SYSCALL: Reading a file chunk failed.
+ *                 Every error of \asyn_tcp_send. The remaining chunks stay queued.
+ * \asyn_tcp_reap: Reads the zero-copy notifications of the socket and releases the
+ *                 chunks which the kernel does not need anymore. The socket reports an
+ *                 error event (both callbacks of the event loop are called) when
+ *                 notifications are available.
+ *      - Returns: void
+ * \asyn_tcp_queued: Returns the number of bytes in the output queue.
+ */
+#define ASYN_TCP_BACKLOG 1024
+#define ASYN_TCP_ZCMIN 16384
+struct asyn_tcp_t;
+struct asyn_chunk_t;
+typedef void (*asyn_chunk_fn_t)(struct asyn_tcp_t *tcp, struct asyn_chunk_t *chunk, size_t sent);
+typedef struct asyn_chunk_t {
+    const void *buf;
+    size_t size;
+    asyn_chunk_fn_t fn;
+    void *arg;
+    signed int file;
+    uint64_t foff;
+
+    /* private */
+    size_t off;
+    unsigned int zc;
+    unsigned int fmode;
+    uint32_t zlo;
+    uint32_t zhi;
+    uint32_t zpend;
+    struct asyn_chunk_t *next;
+} asyn_chunk_t;
+typedef struct asyn_tcp_t {
+    signed int fd;
+    unsigned int error;
+    unsigned int opts;
+
+    /* private */
+    asyn_chunk_t *first;
+    asyn_chunk_t *last;
+    size_t queued;
+    asyn_chunk_t *zfirst;
+    asyn_chunk_t *zlast;
+    uint32_t zseq;
+    signed int pipe[2];
+    size_t piped;
+} asyn_tcp_t;
+#define asyn_tcp_error(tcp) ((tcp)->error)
+#define asyn_tcp_fd(tcp) ((tcp)->fd)
+#define asyn_tcp_queued(tcp) ((tcp)->queued)
+#define ASYN_TCP_NBLOCK 0x0001
+#define ASYN_TCP_CLOEXEC 0x0002
+#define ASYN_TCP_NODELAY 0x0004
+#define ASYN_TCP_ZEROCOPY 0x0008
+extern unsigned int asyn_tcp_listen(asyn_tcp_t *tcp, unsigned int opts, unsigned int type, const void *addr, unsigned int port, unsigned int backlog);
+extern unsigned int asyn_tcp_accept(asyn_tcp_t *listener, asyn_tcp_t *tcp, unsigned int opts, asyn_addr_t *addr);
+extern unsigned int asyn_tcp_accept_batch(asyn_tcp_t *listener, asyn_tcp_t *tcps, asyn_addr_t *addrs, unsigned int count, unsigned int opts, unsigned int *done);
+extern unsigned int asyn_tcp_connect(asyn_tcp_t *tcp, unsigned int opts, unsigned int type, const void *addr, unsigned int port);
+extern unsigned int asyn_tcp_connected(asyn_tcp_t *tcp);
+extern unsigned int asyn_tcp_adopt(asyn_tcp_t *tcp, signed int fd, unsigned int opts);
+extern void asyn_tcp_close(asyn_tcp_t *tcp);
+extern unsigned int asyn_tcp_addr(asyn_tcp_t *tcp, asyn_addr_t *addr);
+extern unsigned int asyn_tcp_recv(asyn_tcp_t *tcp, void *buf, size_t *size);
+extern unsigned int asyn_tcp_send(asyn_tcp_t *tcp, const void *buf, size_t *size);
+extern void asyn_tcp_queue(asyn_tcp_t *tcp, asyn_chunk_t *chunk);
+extern unsigned int asyn_tcp_flush(asyn_tcp_t *tcp);
+extern void asyn_tcp_reap(asyn_tcp_t *tcp);
+
+
+/* Local sockets
+ * Stream or datagram sockets of the AF_UNIX family which connect processes on the
+ * same machine and are addressed by a filesystem path. Besides data they pass open
+ * file descriptors (SCM_RIGHTS), so a front process can accept TCP connections and
+ * hand them to worker processes, or an old process hands its listening sockets to
+ * its successor and not a single connection or datagram is lost. The receiver wraps
+ * the descriptors with \asyn_tcp_adopt or \asyn_udp_adopt.
+ *
+ * Options:
+ * - ASYN_UNIX_NBLOCK: Nonblocking mode, see ASYN_UDP_NBLOCK.
+ * - ASYN_UNIX_CLOEXEC: Do not inherit the socket on exec(), see ASYN_UDP_CLOEXEC. The
+ *                      descriptors which are received on the socket are not
+ *                      inherited, either.
+ * - ASYN_UNIX_DGRAM: Datagram socket, otherwise it is a stream socket. Datagram
+ *                    sockets keep message boundaries and are reliable on local
+ *                    machines, but they send only to their connected peer.
+ *
+ * \asyn_unix_listen: Creates a socket bound to \path. Stream sockets listen for
+ *                    connections with a backlog of \backlog (0 uses
+ *                    ASYN_TCP_BACKLOG), datagram sockets receive datagrams.
+ *      - Returns: ASYN_DONE: The socket is bound.
+ *                 ASYN_INUSE: \path exists. Stale socket files of a previous
+ *                             process have to be removed by the user.
+ *                 ASYN_DENIED: The directory is not writable.
+ *                 ASYN_NOTSUPP: \path is too long or its directory does not exist.
+ *                 Every error of \asyn_udp_init.
+ * \asyn_unix_accept: Accepts a single connection into \ux with the options \opts.
+ *      - Returns: Same as \asyn_tcp_accept.
+ * \asyn_unix_connect: Creates a new socket with the options \opts and connects it to
+ *                     the socket at \path.
+ *      - Returns: ASYN_DONE: The socket is connected.
+ *                 ASYN_BLOCKED: The socket is nonblocking and the listener's backlog
+ *                               is full. Try again later.
+ *                 ASYN_FAILED: Nobody listens at \path.
+ *                 Every error of \asyn_unix_listen.
+ *                 The socket is closed on every code but ASYN_DONE.
+ * \asyn_unix_pair: Creates two connected sockets with the options \opts, eg. to talk
+ *                  to a child process.
+ *      - Returns: ASYN_DONE: \a and \b are connected.
+ *                 Every error of \asyn_udp_init.
+ * \asyn_unix_close: Closes the socket. The socket file is not removed.
+ *      - Returns: void
+ * \asyn_unix_send: Writes up to \*size bytes of \buf and passes the \nfds descriptors
+ *                  of \fds (at most ASYN_UNIX_FDMAX) along with them. The number of
+ *                  written bytes is saved in \size. The descriptors stay open in this
+ *                  process. Stream sockets need at least one byte of data to pass
+ *                  descriptors; they arrive with the first byte.
+ *      - Returns: ASYN_DONE: Data was written.
+ *                 ASYN_BLOCKED: The socket is nonblocking and not writable.
+ *                 ASYN_FAILED: The peer closed its socket.
+ *                 ASYN_TOOMANY: The peer holds too many descriptors in flight.
+ *                 ASYN_NOTSUPP: An entry of \fds is not an open descriptor.
+ *                 Every other error of \asyn_tcp_send.
+ * \asyn_unix_recv: Reads up to \*size bytes into \buf. The number of read bytes is
+ *                  saved in \size. \fds has room for \*nfds descriptors and receives
+ *                  the passed descriptors; their number is saved in \nfds. Passed
+ *                  descriptors which do not fit are closed. \fds may be NULL.
+ *      - Returns: ASYN_DONE: Data or descriptors were read. Datagram sockets may
+ *                            receive empty datagrams.
+ *                 ASYN_NONE: The peer closed the stream.
+ *                 Every error of \asyn_tcp_recv.
+ */
+#define ASYN_UNIX_FDMAX 16
+typedef struct asyn_unix_t {
+    signed int fd;
+    unsigned int error;
+    unsigned int opts;
+} asyn_unix_t;
+#define asyn_unix_error(ux) ((ux)->error)
+#define asyn_unix_fd(ux) ((ux)->fd)
+#define ASYN_UNIX_NBLOCK 0x0001
+#define ASYN_UNIX_CLOEXEC 0x0002
+#define ASYN_UNIX_DGRAM 0x0004
+extern unsigned int asyn_unix_listen(asyn_unix_t *ux, unsigned int opts, const char *path, unsigned int backlog);
+extern unsigned int asyn_unix_accept(asyn_unix_t *listener, asyn_unix_t *ux, unsigned int opts);
+extern unsigned int asyn_unix_connect(asyn_unix_t *ux, unsigned int opts, const char *path);
+extern unsigned int asyn_unix_pair(asyn_unix_t *a, asyn_unix_t *b, unsigned int opts);
+extern void asyn_unix_close(asyn_unix_t *ux);
+extern unsigned int asyn_unix_send(asyn_unix_t *ux, const void *buf, size_t *size, const signed int *fds, unsigned int nfds);
+extern unsigned int asyn_unix_recv(asyn_unix_t *ux, void *buf, size_t *size, signed int *fds, unsigned int *nfds);
+
+
+/* Timers
+ * A timing wheel manages huge numbers of timeouts (eg. one retransmission timer per
+ * outstanding request). Arming, cancelling and expiring a timer costs O(1)
+ * independent of the number of armed timers.
+ *
+ * The wheel counts time in ticks of \resolution milliseconds which are derived from
+ * the monotonic clock, so steps of the wall clock do not affect it. It has
+ * ASYN_WHEEL_LEVELS levels with ASYN_WHEEL_SLOTS slots each. Level 0 has one slot
+ * per tick, every further level covers ASYN_WHEEL_SLOTS times the range of the
+ * previous level. Timers far in the future are kept in a higher level and moved into
+ * the lower levels when their time comes closer. Timeouts longer than 2^32 ticks are shortened to this range.
+ * Timers fire at the earliest on the tick boundary after their timeout elapsed,
+ * that is, up to one tick late, but never early.
+ *
+ * A wheel is not thread-safe. It can be attached to an event loop with
+ * \asyn_loop_wheel, then the loop never sleeps beyond the next expiry and runs the
+ * wheel after every wakeup.
+ *
+ * \asyn_timer_t: A timer. \fn is called when the timer expires and \arg is a user
+ *                defined pointer. All other members are private. The memory is
+ *                managed by the user and the timer must be cancelled before it is
+ *                freed.
+ * \asyn_timer_fn_t: The expiry callback. The timer is already disarmed when it is
+ *                   called so the callback may arm it again or free it. It may also
+ *                   arm or cancel any other timer.
+ * \asyn_wheel_t: The wheel. All members are private.
+ *
+ * \asyn_wheel_init: Initializes \wheel with a tick length of \resolution milliseconds.
+ *                   0 means 1ms. The wheel allocates no memory and needs no free
+ *                   function.
+ *      - Returns: void
+ * \asyn_timer_init: Initializes the disarmed timer \timer with the given values.
+ *      - Returns: void
+ * \asyn_timer_arm: Arms \timer to expire in \ms milliseconds. If it is already armed,
+ *                  it is rearmed with the new timeout.
+ *      - Returns: void
+ * \asyn_timer_cancel: Disarms \timer. Does nothing if it is not armed.
+ *      - Returns: void
+ * \asyn_timer_armed: Returns not 0 if \timer is armed.
+ * \asyn_wheel_run: Reads the clock and expires all timers which are due.
+ *      - Returns: The number of expired timers.
+ * \asyn_wheel_next: Returns the number of milliseconds until the next timer may
+ *                   expire or -1 if no timer is armed. Timers in the higher levels
+ *                   are not searched, so this can be earlier than the real expiry.
+ * \asyn_clock_now: Returns the monotonic clock in nanoseconds which drives the
+ *                  wheels, loops and pacers. It is only useful for differences as it
+ *                  is not related to the wall clock.
+ */
+#define ASYN_WHEEL_LEVELS 4
+#define ASYN_WHEEL_SLOTS 256
+struct asyn_wheel_t;
+struct asyn_timer_t;
+typedef void (*asyn_timer_fn_t)(struct asyn_wheel_t *wheel, struct asyn_timer_t *timer);
+typedef struct asyn_wslot_t {
+    struct asyn_timer_t *first;
+    struct asyn_timer_t *last;
+} asyn_wslot_t;
+typedef struct asyn_timer_t {
+    asyn_timer_fn_t fn;
+    void *arg;
+
+    /* private */
+    struct asyn_wheel_t *wheel;
+    uint64_t expire;
+    unsigned int level;
+    asyn_wslot_t *slot;
+    struct asyn_timer_t *next;
+    struct asyn_timer_t *prev;
+} asyn_timer_t;
+typedef struct asyn_wheel_t {
+    unsigned int resolution;
+    uint64_t origin;
+    uint64_t now;
+    unsigned long count[ASYN_WHEEL_LEVELS];
+    asyn_wslot_t slots[ASYN_WHEEL_LEVELS][ASYN_WHEEL_SLOTS];
+} asyn_wheel_t;
+extern void asyn_wheel_init(asyn_wheel_t *wheel, unsigned int resolution);
+extern void asyn_timer_init(asyn_timer_t *timer, asyn_timer_fn_t fn, void *arg);
+extern void asyn_timer_arm(asyn_wheel_t *wheel, asyn_timer_t *timer, unsigned long ms);
+extern void asyn_timer_cancel(asyn_timer_t *timer);
+#define asyn_timer_armed(timer) ((timer)->slot != NULL)
+extern unsigned long asyn_wheel_run(asyn_wheel_t *wheel);
+extern signed long asyn_wheel_next(asyn_wheel_t *wheel);
+extern uint64_t asyn_clock_now(void);
+
+
+/* Pacing
+ * A pacer spreads the datagrams of a sender evenly over time instead of sending
+ * them in bursts which overflow the queues of the network and of the receiver. It is
+ * a token bucket in front of a send queue (see \asyn_outq_t): the bucket fills with
+ * \rate bytes per second up to \burst bytes and every datagram takes its size out
+ * of it. Datagrams which find the bucket empty wait in the queue until a timer of
+ * the loop's timing wheel releases them.
+ *
+ * Use one pacer per socket to limit the socket's total rate or one pacer per
+ * destination (all on the same socket) to pace every receiver independently.
+ *
+ * If ASYN_PACER_KERNEL is passed and the system supports it (SO_MAX_PACING_RATE on
+ * linux), the kernel paces the socket itself and the pacer only passes the datagrams
+ * on, which costs no timer wakeups and is finer grained than the wheel. The kernel paces
+ * UDP only with the "fq" queueing discipline on the outgoing interface. The rate is
+ * per socket, so this must not be used with several pacers on the same socket. If
+ * the kernel refuses it, the pacer silently falls back to software pacing.
+ *
+ * The send queue of the pacer is \queue, so its policy, watermarks and counters
+ * apply as usual. Register the socket with ASYN_EV_WRITE and call
+ * \asyn_pacer_flush (not \asyn_outq_flush) in the write callback.
+ *
+ * \asyn_pacer_t: The pacer. \queue is its send queue, \rate and \burst are the
+ *                bucket's parameters in bytes. \kernel is set if the kernel paces.
+ *                \delays counts the datagrams which had to wait for tokens. All
+ *                other members are private.
+ *
+ * \asyn_pacer_init: Initializes \pacer for the nonblocking socket \udp. The timer is
+ *                   armed on \wheel which must be attached to the socket's loop.
+ *                   \count and \bufsize are passed to \asyn_outq_init. \burst is
+ *                   raised to \bufsize if it is smaller, so every datagram which can
+ *                   be queued can be sent; 0 allows a burst of 1ms at \rate, but at
+ *                   least 64KB.
+ *      - Returns: void
+ * \asyn_pacer_free: Cancels the timer and frees the queue with all waiting datagrams.
+ *                   The kernel's rate is reset.
+ *      - Returns: void
+ * \asyn_pacer_rate: Changes \rate and \burst (see \asyn_pacer_init). The bucket keeps
+ *                   its tokens.
+ *      - Returns: void
+ * \asyn_pacer_send: Sends a datagram if the bucket holds enough tokens and nothing
+ *                   waits, otherwise the datagram is queued.
+ *      - Returns: Same as \asyn_outq_send.
+ * \asyn_pacer_flush: Sends the waiting datagrams which the bucket allows.
+ *      - Returns: ASYN_DONE: Datagrams were sent and more are allowed.
+ *                 ASYN_BLOCKED: The queue is empty, the socket is blocked or the
+ *                               bucket is empty (then the timer is armed).
+ *                 ASYN_SYSCALL: Unknown error. The socket should be closed.
+ */
+#define ASYN_PACER_KERNEL 0x0001
+typedef struct asyn_pacer_t {
+    asyn_outq_t queue;
+    uint64_t rate;
+    size_t burst;
+    unsigned int kernel;
+    uint64_t delays;
+
+    /* private */
+    asyn_wheel_t *wheel;
+    asyn_timer_t timer;
+    uint64_t tokens;
+    uint64_t stamp;
+} asyn_pacer_t;
+extern void asyn_pacer_init(asyn_pacer_t *pacer, asyn_udp_t *udp, asyn_wheel_t *wheel, uint64_t rate, size_t burst, unsigned int count, size_t bufsize, unsigned int opts);
+extern void asyn_pacer_free(asyn_pacer_t *pacer);
+extern void asyn_pacer_rate(asyn_pacer_t *pacer, uint64_t rate, size_t burst);
+extern unsigned int asyn_pacer_send(asyn_pacer_t *pacer, const void *buf, size_t size, const asyn_addr_t *addr);
+extern unsigned int asyn_pacer_flush(asyn_pacer_t *pacer);
+
+
+/* Event loop
+ * The event loop waits for readiness on many asynchio objects at once and dispatches
+ * read and write callbacks. The loop uses the fastest readiness interface of the
+ * system (see ONS_POLL_* in machine.h) and registers every object edge-triggered.
+ * Therefore, the cost of a wakeup only depends on the number of ready objects and
+ * not on the number of registered objects.
+ *
+ * You have to allocate a \asyn_ev_t for every object which you want to register
+ * with the loop. Initialize it with \asyn_ev_init and add it with \asyn_loop_add.
+ * The object must be in nonblocking mode (eg. ASYN_UDP_NBLOCK).
+ *
+ * Edge-triggered notification means that an object is only reported once when it
+ * becomes ready. The loop remembers the readiness and calls the related callback
+ * until it returns ASYN_BLOCKED. However, to avoid that a single busy object starves
+ * all other objects, every callback is invoked at most \budget times per wakeup.
+ * If the budget is exhausted, the object is queued at the end of the loop's ready
+ * queue and dispatched again after all other ready objects were served. The loop does
+ * not sleep as long as objects are on the ready queue.
+ *
+ * The callbacks must process exactly one unit of work (eg. one datagram) per call
+ * and return:
+ * - ASYN_DONE: The work was done and there is probably more work left.
+ * - ASYN_BLOCKED: The object returned ASYN_BLOCKED, that is, the readiness is
+ *                 consumed. The callback is not called again until the object
+ *                 becomes ready again.
+ * - Every other code: The loop does not touch \ev anymore in this round. Return
+ *                     such a code when you removed (and probably freed) \ev
+ *                     inside the callback, for instance, because the object was
+ *                     closed due to an error.
+ * If an error or hangup is reported on an object, both registered callbacks are
+ * called so they can pick up the error with their next IO call.
+ *
+ * Hybrid busy polling: Waking a sleeping thread costs several microseconds. Loops
+ * which serve latency critical objects can trade CPU time for it with
+ * \asyn_loop_spin. Before the loop goes to sleep, it then spins for up to the given
+ * number of microseconds: it calls the read callbacks of all objects whose \spin
+ * member is set (which call the nonblocking receive functions) and checks the
+ * readiness of all other objects without sleeping. Only if nothing became ready
+ * within the budget, the loop sleeps as usual. Combine it with \asyn_udp_busypoll,
+ * so every spinning receive call polls the network device directly. The loop counts
+ * the time it spins and sleeps (see \asyn_loop_stats) to tune the budget: if most
+ * spins miss, the budget is wasted CPU time; if the hits dominate, it pays off.
+ *
+ * \asyn_ev_t: A registered object. \fd is the file descriptor (eg. \asyn_udp_fd).
+ *             \read and \write are the callbacks (NULL if not used) and \arg is a
+ *             user defined pointer. \budget overwrites the loop's budget for this
+ *             object if it is not 0. If \spin is set before \asyn_loop_add, the read
+ *             callback is polled while the loop spins. All other members are
+ *             private.
+ * \asyn_loop_t: The loop. All members are private.
+ * \asyn_loop_stats_t: Spin statistics. \spin_ns and \sleep_ns are the nanoseconds
+ *                     which the loop spent spinning and sleeping, \spin_hits and
+ *                     \spin_misses count the spins which found work and which
+ *                     exhausted the budget.
+ *
+ * \asyn_ev_init: Initializes \ev with the given values.
+ *      - Returns: void
+ * \asyn_loop_init: Initializes a new loop.
+ *      - \budget: The maximum number of callback invocations per object and wakeup.
+ *                 If 0, ASYN_LOOP_BUDGET is used.
+ *      - Returns: ASYN_DONE: The loop was created successfully.
+ *                 ASYN_NOTSUPP: No readiness interface is available on this system.
+ *                 ASYN_TOOMANY: Too many open file descriptors.
+ *                 ASYN_MEMFAIL: Kernel could not allocate the loop.
+ * \asyn_loop_free: Closes the loop. Registered objects are NOT closed.
+ *      - Returns: void
+ * \asyn_loop_add: Registers \ev on \loop. \events is a set of ASYN_EV_READ and
+ *                 ASYN_EV_WRITE.
+ *      - Returns: ASYN_DONE: \ev was registered.
+ *                 ASYN_NOTSUPP: The descriptor cannot be polled or is already registered.
+ *                 ASYN_TOOMANY: The system's limit of watched descriptors is reached.
+ *                 ASYN_MEMFAIL: Kernel could not allocate the watch.
+ * \asyn_loop_mod: Changes the events \ev is registered for. Pending readiness of
+ *                 events which are removed is dropped.
+ *      - Returns: Same as \asyn_loop_add.
+ * \asyn_loop_del: Removes \ev from its loop. This can be safely called from inside any
+ *                 callback, even for other objects than the current one.
+ *      - Returns: void
+ * \asyn_loop_run_once: Waits at most \timeout milliseconds for readiness (-1 waits
+ *                      infinitely) and dispatches all ready objects once.
+ *      - Returns: ASYN_DONE: Objects were dispatched or the timeout elapsed.
+ *                 ASYN_SYSCALL: Waiting failed. Not recoverable.
+ * \asyn_loop_run: Calls \asyn_loop_run_once until \asyn_loop_stop is called.
+ *      - Returns: Same as \asyn_loop_run_once.
+ * \asyn_loop_stop: Makes \asyn_loop_run return after the current round.
+ *      - Returns: void
+ * \asyn_loop_wheel: Attaches the timing wheel \wheel to \loop (NULL detaches it). The
+ *                   loop shortens its wait timeout to the next expiry of \wheel and
+ *                   runs \asyn_wheel_run after every wakeup.
+ *      - Returns: void
+ * \asyn_loop_spin: Sets the spin budget of \loop to \usecs microseconds. 0 (the
+ *                  default) disables spinning.
+ *      - Returns: void
+ * \asyn_loop_stats: Saves the spin statistics of \loop in \stats and resets them,
+ *                   so every call returns the numbers since the last call. They are
+ *                   only counted while spinning is enabled.
+ *      - Returns: void
+ */
+#define ASYN_EV_READ 0x0001
+#define ASYN_EV_WRITE 0x0002
+#define ASYN_LOOP_BUDGET 64
+struct asyn_loop_t;
+struct asyn_ev_t;
+typedef unsigned int (*asyn_ev_fn_t)(struct asyn_loop_t *loop, struct asyn_ev_t *ev);
+typedef struct asyn_ev_t {
+    signed int fd;
+    asyn_ev_fn_t read;
+    asyn_ev_fn_t write;
+    void *arg;
+    unsigned int budget;
+    unsigned int spin;
+
+    /* private */
+    struct asyn_loop_t *loop;
+    unsigned int events;
+    unsigned int pending;
+    unsigned int queued;
+    struct asyn_ev_t *next;
+    struct asyn_ev_t *prev;
+    struct asyn_ev_t *snext;
+    struct asyn_ev_t *onext;
+} asyn_ev_t;
+typedef struct asyn_loop_stats_t {
+    uint64_t spin_ns;
+    uint64_t sleep_ns;
+    uint64_t spin_hits;
+    uint64_t spin_misses;
+} asyn_loop_stats_t;
+typedef struct asyn_loop_t {
+    signed int fd;
+    unsigned int budget;
+    unsigned int stop;
+    size_t count;
+    size_t nready;
+    asyn_ev_t *first;
+    asyn_ev_t *last;
+    asyn_wheel_t *wheel;
+    unsigned long spin;
+    asyn_ev_t *spinning;
+    asyn_loop_stats_t stats;
+} asyn_loop_t;
+extern void asyn_ev_init(asyn_ev_t *ev, signed int fd, asyn_ev_fn_t read, asyn_ev_fn_t write, void *arg);
+extern unsigned int asyn_loop_init(asyn_loop_t *loop, unsigned int budget);
+extern void asyn_loop_free(asyn_loop_t *loop);
+extern unsigned int asyn_loop_add(asyn_loop_t *loop, asyn_ev_t *ev, unsigned int events);
+extern unsigned int asyn_loop_mod(asyn_ev_t *ev, unsigned int events);
+extern void asyn_loop_del(asyn_ev_t *ev);
+extern unsigned int asyn_loop_run_once(asyn_loop_t *loop, signed int timeout);
+extern unsigned int asyn_loop_run(asyn_loop_t *loop);
+#define asyn_loop_stop(loop) ((loop)->stop = 1)
+#define asyn_loop_wheel(loop, w) ((loop)->wheel = (w))
+#define asyn_loop_spin(loop, usecs) ((loop)->spin = (usecs))
+extern void asyn_loop_stats(asyn_loop_t *loop, asyn_loop_stats_t *stats);
+
+
+/* Submission queues
+ * A socket is owned by the thread which runs its event loop. Other threads must not
+ * use the socket directly, instead, they post requests into the submission queue of
+ * the owning loop. The queue is lock-free for any number of producer threads and a
+ * single consumer (the loop's thread), so the send path never contends on a mutex.
+ *
+ * Producers push a post onto a lock-free list. Only the producer which finds the list
+ * empty signals the loop's wakeup descriptor (eventfd on linux), therefore, a busy
+ * queue costs no syscalls on the producer side. The loop takes the whole list at once,
+ * restores the posting order and dispatches the posts. Consecutive send requests on
+ * the same socket are passed to the kernel in one batch (see \asyn_udp_send_batch).
+ *
+ * \asyn_post_t: A request. If \udp is NULL, the post is a closure and \fn is called
+ *               in the loop's thread. Otherwise, \msg is sent on \udp and \fn (if not
+ *               NULL) is called afterwards with \msg.ret set to the result. \arg is a
+ *               user defined pointer. The memory of the post, \msg.buf included, is
+ *               owned by the queue until \fn is called. All other members are private.
+ * \asyn_post_fn_t: The callback of a post. It is called in the loop's thread and may
+ *                  free or repost \post.
+ * \asyn_queue_t: The queue. \arg is a user defined pointer. All other members are
+ *                private.
+ *
+ * \asyn_queue_init: Creates a new queue and registers it on \loop.
+ *      - Returns: ASYN_DONE: The queue was created successfully.
+ *                 ASYN_NOTSUPP: Wakeup descriptors are not available on this system.
+ *                 ASYN_TOOMANY: Too many open file descriptors.
+ *                 ASYN_MEMFAIL: Kernel could not allocate the descriptor.
+ *                 Every other code of \asyn_loop_add.
+ * \asyn_queue_free: Removes the queue from its loop and frees it. Posts which are still
+ *                   queued are dispatched first. Must be called in the loop's thread
+ *                   after all producers stopped.
+ *      - Returns: void
+ * \asyn_queue_post: Queues \post. This can be called from any thread.
+ *      - Returns: void
+ * \asyn_queue_run: Dispatches all queued posts. The loop calls this when it is woken
+ *                  up, you only need it if you do not run the loop.
+ *      - Returns: The number of dispatched posts.
+ */
+struct asyn_queue_t;
+struct asyn_post_t;
+typedef void (*asyn_post_fn_t)(struct asyn_queue_t *queue, struct asyn_post_t *post);
+typedef struct asyn_post_t {
+    asyn_post_fn_t fn;
+    void *arg;
+    asyn_udp_t *udp;
+    asyn_msg_t msg;
+
+    /* private */
+    struct asyn_post_t *next;
+} asyn_post_t;
+typedef struct asyn_queue_t {
+    void *arg;
+
+    /* private */
+    asyn_ev_t ev;
+    void * volatile head;
+} asyn_queue_t;
+extern unsigned int asyn_queue_init(asyn_queue_t *queue, asyn_loop_t *loop);
+extern void asyn_queue_free(asyn_queue_t *queue);
+extern void asyn_queue_post(asyn_queue_t *queue, asyn_post_t *post);
+extern size_t asyn_queue_run(asyn_queue_t *queue);
+
+
+/* Loop groups
+ * A loop group runs one event loop per thread on \count threads. Sockets stay owned
+ * by the thread whose loop they are registered on, so their IO never moves and never
+ * needs a lock. CPU-bound work which callbacks generate (eg. parsing a request or
+ * encoding its reply) is pushed as a task onto the worker's own deque instead of
+ * being done inline. Every worker runs its own tasks, newest first, between two
+ * rounds of its loop. Workers which run out of IO and tasks steal the oldest tasks
+ * of other workers (Chase-Lev deque). Therefore, a few hot sockets on one thread are
+ * balanced across all cores without moving file descriptors between threads.
+ *
+ * A stolen task runs on another thread, so it must not touch the sockets of its
+ * origin directly. Post the result to the submission queue of the owning worker
+ * (\asyn_queue_post on \worker->queue), which sends it from the right thread.
+ *
+ * Idle workers sleep in their loop. Pushing a task wakes up one sleeping worker, so
+ * work is stolen immediately even if all other threads were idle.
+ *
+ * \asyn_task_t: A unit of work. \fn is called with \arg on any worker of the group.
+ *               The task is owned by the group until \fn is called, which may free or
+ *               push it again. All other members are private.
+ * \asyn_task_fn_t: The callback of a task. \worker is the worker which runs it.
+ * \asyn_worker_t: A thread of the group. \loop is its event loop and \queue its
+ *                 submission queue. Register sockets on \loop, either before the
+ *                 group is started or in the setup function in the worker's thread.
+ *                 \index is its position in \group->workers. \executed and \stolen
+ *                 count the tasks which it ran and which it stole from others. All
+ *                 other members are private.
+ * \asyn_worker_setup_t: Called in the worker's thread before its loop starts.
+ * \asyn_loopgroup_t: The group. \count is the number of workers, \workers the array of
+ *                    them and \arg a user defined pointer. All other members are
+ *                    private.
+ *
+ * \asyn_loopgroup_init: Creates the \count loops and queues. The threads are not
+ *                       started, yet. \budget is passed to \asyn_loop_init and is also
+ *                       the number of tasks which a worker runs per round.
+ *      - Returns: ASYN_DONE: The group was created.
+ *                 Every error of \asyn_loop_init and \asyn_queue_init.
+ * \asyn_loopgroup_start: Starts one thread per worker. \setup (if not NULL) is called
+ *                        in every thread first.
+ *      - Returns: ASYN_DONE: All threads are running.
+ *                 ASYN_TOOMANY: A thread could not be created. The group is stopped.
+ * \asyn_loopgroup_free: Stops and joins all threads, then frees the loops and queues.
+ *                       Registered sockets are not closed. Tasks which are still
+ *                       queued are dropped.
+ *      - Returns: void
+ * \asyn_loopgroup_stop: Makes all workers return after their current round.
+ *      - Returns: void
+ * \asyn_task_push: Queues \task on \worker, which must be the worker of the calling
+ *                  thread (usually the one of the callback's loop). If its deque is
+ *                  full, the task is run immediately.
+ *      - Returns: void
+ * \asyn_worker_of: Returns the worker of the loop \loop of a group.
+ */
+#define ASYN_TASK_SLOTS 1024
+struct asyn_worker_t;
+struct asyn_task_t;
+struct asyn_loopgroup_t;
+typedef void (*asyn_task_fn_t)(struct asyn_worker_t *worker, struct asyn_task_t *task);
+typedef void (*asyn_worker_setup_t)(struct asyn_worker_t *worker);
+typedef struct asyn_task_t {
+    asyn_task_fn_t fn;
+    void *arg;
+} asyn_task_t;
+typedef struct asyn_worker_t {
+    asyn_loop_t loop;
+    asyn_queue_t queue;
+    struct asyn_loopgroup_t *group;
+    unsigned int index;
+    uint64_t executed;
+    uint64_t stolen;
+
+    /* private */
+    asyn_task_t **tasks;
+    volatile long top;
+    volatile long bottom;
+    volatile long sleeping;
+    unsigned int victim;
+} asyn_worker_t;
+typedef struct asyn_loopgroup_t {
+    unsigned int count;
+    asyn_worker_t *workers;
+    void *arg;
+
+    /* private */
+    asyn_worker_setup_t setup;
+    unsigned int budget;
+    volatile unsigned int stop;
+    volatile long sleepers;
+    void *threads;
+    unsigned int running;
+} asyn_loopgroup_t;
+extern unsigned int asyn_loopgroup_init(asyn_loopgroup_t *group, unsigned int count, unsigned int budget);
+extern unsigned int asyn_loopgroup_start(asyn_loopgroup_t *group, asyn_worker_setup_t setup, void *arg);
+extern void asyn_loopgroup_free(asyn_loopgroup_t *group);
+extern void asyn_loopgroup_stop(asyn_loopgroup_t *group);
+extern void asyn_task_push(asyn_worker_t *worker, asyn_task_t *task);
+#define asyn_worker_of(loop) ((asyn_worker_t*)(loop))
+
+
+/* Coroutines
+ * Callbacks must return as soon as an object is blocked, so a handler which needs
+ * several IO steps becomes a state machine. A coroutine instead runs the handler on
+ * its own small stack and parks it on the event loop whenever an object is blocked:
+ * the handler calls the nonblocking IO function and, if it returns ASYN_BLOCKED,
+ * \asyn_coro_await_readable (or _writable) and tries again. Meanwhile the loop serves
+ * all other objects and resumes the coroutine when the object becomes ready, so
+ * thousands of sequential handlers run on a single thread.
+ *
+ * Switching only saves and restores the callee-saved registers and the stack pointer
+ * (see ONS_CORO_* in machine.h), so it costs about as much as a function call. The
+ * stacks have a fixed size with a guard page below them and are kept in a pool of
+ * the scheduler, so spawning a coroutine usually allocates nothing.
+ *
+ * The loop is edge-triggered, therefore, a coroutine must only wait for an object
+ * after an IO call returned ASYN_BLOCKED. Otherwise it may wait for readiness which
+ * was already reported. Coroutines must not call \asyn_loop_run or
+ * \asyn_loop_run_once and must not be used from other threads than the loop's.
+ *
+ * \asyn_coro_t: A coroutine. \sched is its scheduler and \arg the argument of
+ *               \asyn_coro_spawn. It lives on top of its own stack, so it is freed
+ *               when the coroutine returns. All other members are private.
+ * \asyn_coro_fn_t: The body of a coroutine. The coroutine ends when it returns.
+ * \asyn_sched_t: The scheduler of the coroutines of one loop. \loop is the loop,
+ *                \stacksize the size of every stack, \live the number of running
+ *                coroutines and \pooled the number of stacks in the pool. All other
+ *                members are private.
+ *
+ * \asyn_sched_init: Initializes \sched for \loop. \stacksize is rounded up to whole
+ *                   pages, 0 selects ASYN_CORO_STACK. At most \poolmax stacks of
+ *                   ended coroutines are kept, 0 selects ASYN_CORO_POOL. Batch calls
+ *                   (\asyn_udp_recv_batch, \asyn_udp_send_batch and everything which
+ *                   uses them) need up to 16KB of the stack, so do not go much below
+ *                   ASYN_CORO_STACK if the coroutines use them.
+ *      - Returns: void
+ * \asyn_sched_free: Frees all pooled stacks. All coroutines must have ended.
+ *      - Returns: void
+ * \asyn_coro_spawn: Creates a coroutine which calls \fn with \arg. It runs
+ *                   immediately until it waits the first time or ends, then this
+ *                   returns. It can be called from other coroutines, too.
+ *      - Returns: ASYN_DONE: The coroutine was started.
+ *                 ASYN_NOTSUPP: Coroutines are not available on this system.
+ *                 ASYN_MEMFAIL: No stack could be allocated.
+ * \asyn_coro_add: Initializes \ev for the descriptor \fd and registers it on the
+ *                 scheduler's loop for \coro. \ev belongs to \coro and may be
+ *                 stored on the coroutine's stack, but the coroutine must remove it
+ *                 with \asyn_coro_del before it returns. Its frames are dead then
+ *                 and the loop would report \ev after its memory is reused.
+ *      - Returns: Same as \asyn_loop_add.
+ * \asyn_coro_del: Removes \ev from the loop and from \coro. Use this instead of
+ *                 \asyn_loop_del for every object of \asyn_coro_add.
+ *      - Returns: void
+ * \asyn_coro_await: Parks \coro until \ev reports one of \events (ASYN_EV_READ,
+ *                   ASYN_EV_WRITE). Errors and hangups are reported as readiness,
+ *                   so the next IO call picks them up. Must be called by \coro.
+ *      - Returns: ASYN_DONE: \ev became ready.
+ *                 ASYN_FAILED: \ev is not registered by \coro.
+ * \asyn_coro_await_readable: Same as \asyn_coro_await with ASYN_EV_READ.
+ * \asyn_coro_await_writable: Same as \asyn_coro_await with ASYN_EV_WRITE.
+ */
+#define ASYN_CORO_STACK (64 * 1024)
+#define ASYN_CORO_POOL 256
+struct asyn_coro_t;
+struct asyn_sched_t;
+typedef void (*asyn_coro_fn_t)(struct asyn_coro_t *coro, void *arg);
+typedef struct asyn_coro_t {
+    struct asyn_sched_t *sched;
+    void *arg;
+
+    /* private */
+    asyn_coro_fn_t fn;
+    unsigned int ended;
+    asyn_ev_t *wait;
+    unsigned int events;
+    asyn_ev_t *evs;
+    void *context;
+    void *caller;
+    void *stack;
+    struct asyn_coro_t *next;
+} asyn_coro_t;
+typedef struct asyn_sched_t {
+    asyn_loop_t *loop;
+    size_t stacksize;
+    unsigned int live;
+    unsigned int pooled;
+
+    /* private */
+    unsigned int poolmax;
+    asyn_coro_t *pool;
+} asyn_sched_t;
+extern void asyn_sched_init(asyn_sched_t *sched, asyn_loop_t *loop, size_t stacksize, unsigned int poolmax);
+extern void asyn_sched_free(asyn_sched_t *sched);
+extern unsigned int asyn_coro_spawn(asyn_sched_t *sched, asyn_coro_fn_t fn, void *arg);
+extern unsigned int asyn_coro_add(asyn_coro_t *coro, asyn_ev_t *ev, signed int fd);
+extern void asyn_coro_del(asyn_coro_t *coro, asyn_ev_t *ev);
+extern unsigned int asyn_coro_await(asyn_coro_t *coro, asyn_ev_t *ev, unsigned int events);
+#define asyn_coro_await_readable(coro, ev) asyn_coro_await((coro), (ev), ASYN_EV_READ)
+#define asyn_coro_await_writable(coro, ev) asyn_coro_await((coro), (ev), ASYN_EV_WRITE)
+
+
+/* Completion ring
+ * The ring is an alternative to the event loop which is based on completion instead
+ * of readiness (io_uring on linux, see ONS_SOCKET_URING in machine.h). Operations are
+ * queued on the ring and the ring reports their results. Any number of queued
+ * operations is passed to the kernel with a single syscall and the same syscall
+ * returns all completions, hence, there is no separate syscall per datagram.
+ *
+ * The ring manages three resources which are registered with the kernel once:
+ * - Fixed files: UDP objects are attached to the ring with \asyn_ring_attach. The
+ *                kernel then does not need to look up the descriptor on every
+ *                operation.
+ * - Receive buffers: The ring allocates \bufcount buffers with room for \bufsize
+ *                    bytes of payload each and registers them with the kernel. The
+ *                    kernel picks a free buffer when a datagram arrives, so no buffer
+ *                    is bound to an idle socket.
+ * - Multishot receive: \asyn_ring_recv arms a single receive operation which
+ *                      reports every arriving datagram until it is stopped.
+ *
+ * Every completion is passed to the callback of the ring as \asyn_ring_ev_t:
+ * - \op: ASYN_RING_RECV or ASYN_RING_SEND.
+ * - \ret: ASYN_DONE on success, otherwise the error code of the operation. The codes
+ *         are the same as of \asyn_udp_recv and \asyn_udp_send. ASYN_NONE means that
+ *         the operation was cancelled by \asyn_ring_detach.
+ * - \more: Not 0 if the multishot receive is still armed. If it is 0, the receive
+ *          operation has stopped and you have to call \asyn_ring_recv again to
+ *          receive more datagrams. It stops, for instance, with ASYN_MEMFAIL if all
+ *          receive buffers are in use.
+ * - \msg: On receive, the datagram. \msg.buf points into a receive buffer of the ring
+ *         which is handed back to the kernel when the callback returns. Copy the data
+ *         if you need it later. On send, the message which was passed to
+ *         \asyn_ring_send, with \msg.size set to the number of sent bytes.
+ * - \arg: The user defined pointer which was passed with the operation.
+ * All other members are private.
+ *
+ * \asyn_ring_init: Creates a new ring.
+ *      - \entries: Number of operations which can be queued before the ring has to be
+ *                  flushed to the kernel. Also limits the number of attached objects.
+ *      - \bufsize: Payload size of every receive buffer. Bigger datagrams are truncated.
+ *      - \bufcount: Number of receive buffers. Must be a power of 2 and not bigger
+ *                   than 32768.
+ *      - \fn: The callback which is called for every completion.
+ *      - Returns: ASYN_DONE: The ring was created.
+ *                 ASYN_NOTSUPP: The system does not support completion rings or an
+ *                               argument is invalid.
+ *                 ASYN_DENIED: The system does not allow this process to create rings.
+ *                 ASYN_TOOMANY: Too many open file descriptors.
+ *                 ASYN_MEMFAIL: The kernel could not allocate the ring.
+ * \asyn_ring_free: Closes the ring. Attached objects are NOT closed. Must not be called
+ *                  from inside the callback.
+ *      - Returns: void
+ * \asyn_ring_attach: Registers \udp with the ring. An object can only be attached to
+ *                    a single ring.
+ *      - Returns: ASYN_DONE: \udp was attached.
+ *                 ASYN_TOOMANY: All \entries slots are in use.
+ *                 Any other error of the underlying syscall.
+ * \asyn_ring_detach: Cancels all operations of \udp and removes it from the ring. The
+ *                    cancelled operations are reported with ASYN_NONE by the next call
+ *                    to \asyn_ring_run_once. Detach objects before closing them.
+ *      - Returns: void
+ * \asyn_ring_recv: Arms a multishot receive on the attached object \udp. Arm it only
+ *                  once per object. The completions are reported with \arg.
+ *      - Returns: ASYN_DONE: The operation was queued.
+ *                 ASYN_TOOMANY: Too many operations are in flight.
+ * \asyn_ring_send: Queues \msg to be sent on the attached object \udp. The \buf member
+ *                  of \msg must stay valid until the completion is reported. The
+ *                  \segsize member is supported like in \asyn_udp_send_batch.
+ *      - Returns: ASYN_DONE: The operation was queued.
+ *                 ASYN_TOOMANY: Too many operations are in flight.
+ *                 ASYN_NOTSUPP: \msg requests an unsupported feature.
+ * \asyn_ring_run_once: Passes all queued operations to the kernel and dispatches all
+ *                      completions. If \wait is not 0, it blocks until at least one
+ *                      completion is available.
+ *      - Returns: ASYN_DONE: The operations were passed and completions dispatched.
+ *                 ASYN_MEMFAIL: The kernel could not allocate the operations.
+ *                 ASYN_SYSCALL: Unknown error. The ring should be freed.
+ * \asyn_ring_run: Calls \asyn_ring_run_once until \asyn_ring_stop is called.
+ *      - Returns: Same as \asyn_ring_run_once.
+ * \asyn_ring_stop: Makes \asyn_ring_run return after the current round.
+ *      - Returns: void
+ */
+#define ASYN_RING_RECV 1
+#define ASYN_RING_SEND 2
+struct asyn_ring_t;
+struct asyn_os_ring_t;
+typedef struct asyn_ring_ev_t {
+    unsigned int op;
+    unsigned int ret;
+    unsigned int more;
+    asyn_msg_t msg;
+    void *arg;
+
+    /* private */
+    signed int bid;
+} asyn_ring_ev_t;
+typedef void (*asyn_ring_fn_t)(struct asyn_ring_t *ring, asyn_ring_ev_t *ev);
+typedef struct asyn_ring_t {
+    struct asyn_os_ring_t *os;
+    asyn_ring_fn_t fn;
+    unsigned int stop;
+} asyn_ring_t;
+extern unsigned int asyn_ring_init(asyn_ring_t *ring, unsigned int entries, size_t bufsize, unsigned int bufcount, asyn_ring_fn_t fn);
+extern void asyn_ring_free(asyn_ring_t *ring);
+extern unsigned int asyn_ring_attach(asyn_ring_t *ring, asyn_udp_t *udp);
+extern void asyn_ring_detach(asyn_ring_t *ring, asyn_udp_t *udp);
+extern unsigned int asyn_ring_recv(asyn_ring_t *ring, asyn_udp_t *udp, void *arg);
+extern unsigned int asyn_ring_send(asyn_ring_t *ring, asyn_udp_t *udp, const asyn_msg_t *msg, void *arg);
+extern unsigned int asyn_ring_run_once(asyn_ring_t *ring, unsigned int wait);
+extern unsigned int asyn_ring_run(asyn_ring_t *ring);
+#define asyn_ring_stop(ring) ((ring)->stop = 1)
 
 
 
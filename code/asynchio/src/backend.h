@@ -0,0 +1,384 @@
+/*
+ * (COPYRIGHT) Copyright (C) 2008, 2009, The ONS Team.
+ * This file is part of ONS, see COPYING for details.
+ */
+
+/*
+ * File information:
+ * - Created: 17. October 2026
+ * - Lead-Dev: - David Herrmann
+ * - Contributors: /
+ * - Last-Change: 17. October 2026
+ */
+
+/* Backend header
+ * This header is private to asynchio and is not installed. It declares
+ * the platform wrappers which are implemented in "os_generic.c". All other
+ * source files use these wrappers instead of calling the system's API
+ * directly.
+ * Every wrapper returns one of the public asynchio return codes.
+ */
+
+
+#ifndef ASYNCHIO_INCLUDED_backend_h
+#define ASYNCHIO_INCLUDED_backend_h
+
+
+#include <stddef.h>
+#include "asynchio/asynchio.h"
+
+
+/* Socket creation.
+ * \asyn_os_socket creates a new socket and saves the file descriptor in \fd.
+ * \type is one of ASYN_OS_TCP or ASYN_OS_UDP, \domain one of ASYN_IPV4 or
+ * ASYN_IPV6. If \noinherit is not 0, the socket is not inherited by exec().
+ * IPv6 sockets are always created in V6ONLY mode.
+ *
+ * \asyn_os_setnblock sets the socket into nonblocking mode if \set is not 0,
+ * otherwise it resets the socket into blocking mode.
+ * \asyn_os_setgro enables (\set is not 0) or disables coalescing of received UDP
+ * datagrams (UDP_GRO). Returns ASYN_NOTSUPP if the system does not support it.
+ * \asyn_os_setreuse allows several sockets to be bound to the same address and port
+ * (SO_REUSEPORT). The kernel spreads the incoming flows across them. It must be set
+ * on every socket before it is bound.
+ * \asyn_os_setovfl enables (\set is not 0) or disables reporting of the kernel's drop
+ * counter with every received datagram (SO_RXQ_OVFL). See \asyn_msg_t.drops.
+ * \asyn_os_setstamp enables (\set is not 0) or disables kernel receive timestamps
+ * (SO_TIMESTAMPNS). See \asyn_msg_t.stamp.
+ * \asyn_os_stamp returns the current time on the clock of the kernel timestamps.
+ * \asyn_os_setpktinfo enables (\set is not 0) or disables reporting of the destination
+ * address and interface of every received datagram (IP_PKTINFO on IPv4 and
+ * IPV6_RECVPKTINFO on IPv6 sockets). See \asyn_msg_t.dst.
+ * \asyn_os_setbusypoll makes receive calls on \fd poll the device queue for up to
+ * \usecs microseconds when no data is queued (SO_BUSY_POLL) and asks the kernel to
+ * leave the device queue to them (SO_PREFER_BUSY_POLL). 0 disables both. Returns
+ * ASYN_DENIED if \usecs exceeds the system limit and the process is not privileged.
+ * \asyn_os_clock returns a monotonic time in nanoseconds.
+ * \asyn_os_setpacing limits the rate of \fd to \rate bytes per second
+ * (SO_MAX_PACING_RATE). 0 removes the limit.
+ * \asyn_os_setbuf sets the receive (\send is 0) or send buffer of \fd to \size bytes
+ * as reported by \asyn_os_meminfo, that is, including the kernel's bookkeeping. If
+ * \force is set, the system limit is ignored (SO_RCVBUFFORCE), which returns
+ * ASYN_DENIED if the process is not privileged. Otherwise the kernel silently caps
+ * \size at the system limit.
+ * \asyn_os_meminfo saves the sizes of the receive and send buffers of \fd in \rbuf
+ * and \sbuf and the bytes which are currently queued in them in \rused and \sused
+ * (SO_MEMINFO). If the system cannot report the queued bytes, they are set to 0 and
+ * ASYN_NOTSUPP is returned, but the sizes are valid nevertheless. Every other error
+ * is returned as ASYN_SYSCALL and all values are 0.
+ */
+#define ASYN_OS_TCP 0
+#define ASYN_OS_UDP 1
+extern unsigned int asyn_os_socket(signed int *fd, unsigned int type, unsigned int domain, unsigned int noinherit);
+extern unsigned int asyn_os_setnblock(signed int fd, unsigned int set);
+extern unsigned int asyn_os_setgro(signed int fd, unsigned int set);
+extern unsigned int asyn_os_setreuse(signed int fd);
+extern unsigned int asyn_os_setovfl(signed int fd, unsigned int set);
+extern unsigned int asyn_os_setstamp(signed int fd, unsigned int set);
+extern uint64_t asyn_os_stamp(void);
+extern unsigned int asyn_os_setpktinfo(signed int fd, unsigned int set);
+extern unsigned int asyn_os_setbusypoll(signed int fd, unsigned int usecs);
+extern uint64_t asyn_os_clock(void);
+extern unsigned int asyn_os_setpacing(signed int fd, uint64_t rate);
+extern unsigned int asyn_os_setbuf(signed int fd, unsigned int send, size_t size, unsigned int force);
+extern unsigned int asyn_os_meminfo(signed int fd, size_t *rbuf, size_t *rused, size_t *sbuf, size_t *sused);
+
+
+/* Socket IO.
+ * \asyn_os_bind binds \fd to \ip and \port (host byte order). \type is ASYN_IPV4 or
+ * ASYN_IPV6 and \ip is NULL to bind to the ANY address.
+ * \asyn_os_close closes \fd. This always succeeds.
+ * \asyn_os_shutdown shuts \fd down in both directions. Threads which are blocked in
+ * a call on \fd return and every further call fails. This always succeeds.
+ * \asyn_os_sockname saves the local address of \fd in \addr.
+ * \asyn_os_recv receives a single datagram into \msg. If \nowait is not 0 the call
+ * does not block even on blocking sockets (if the system supports it).
+ * \asyn_os_recv_batch receives up to \count datagrams into \msgs with a single syscall
+ * if the system supports it (ONS_SOCKET_MMSG). At most ASYN_OS_MMSG datagrams are
+ * received per call. The number of received datagrams is saved in \done. It returns
+ * ASYN_DONE if at least one datagram was received, otherwise the error code of the
+ * first datagram.
+ * \asyn_os_send and \asyn_os_send_batch are the counterparts for sending. Messages
+ * with ASYN_NOADDR as address type are sent to the connected peer. The \ret member of
+ * every message is set to ASYN_DONE if it was sent, to the error code if it failed and
+ * to ASYN_NONE if it was not tried.
+ * All four functions handle the \segsize member of the messages (see ONS_SOCKET_UDPSEG).
+ * The batch functions keep the headers, addresses and control buffers of ASYN_OS_MMSG
+ * datagrams on the stack, about 11KB, which must fit on a coroutine's stack, too (see
+ * ASYN_CORO_STACK).
+ */
+#define ASYN_OS_MMSG 32
+extern unsigned int asyn_os_bind(signed int fd, unsigned int type, const void *ip, unsigned int port);
+extern void asyn_os_close(signed int fd);
+extern void asyn_os_shutdown(signed int fd);
+extern unsigned int asyn_os_sockname(signed int fd, asyn_addr_t *addr);
+extern unsigned int asyn_os_recv(signed int fd, asyn_msg_t *msg, unsigned int nowait);
+extern unsigned int asyn_os_recv_batch(signed int fd, asyn_msg_t *msgs, unsigned int count, unsigned int *done);
+extern unsigned int asyn_os_send(signed int fd, const asyn_msg_t *msg, unsigned int nowait);
+extern unsigned int asyn_os_send_batch(signed int fd, asyn_msg_t *msgs, unsigned int count, unsigned int *done);
+
+
+/* Connected datagram sockets.
+ * A datagram socket which is connected with \asyn_os_connect talks to a single peer.
+ * The kernel resolves the route once on connect, so these calls skip the address
+ * conversion and the per-datagram route lookup. They carry no control messages.
+ *
+ * \asyn_os_disconnect dissolves the association of \fd with its peer.
+ * \asyn_os_peer_send sends the datagram \buf with \size bytes to the peer.
+ * \asyn_os_peer_recv receives a single datagram of the peer into \buf which can hold
+ * \*size bytes. The number of stored bytes is saved in \size and \trunc is set if
+ * the datagram did not fit (only on systems which report the real length).
+ */
+extern unsigned int asyn_os_disconnect(signed int fd);
+extern unsigned int asyn_os_peer_send(signed int fd, const void *buf, size_t size);
+extern unsigned int asyn_os_peer_recv(signed int fd, void *buf, size_t *size, unsigned int *trunc);
+
+
+/* Multicast.
+ * \asyn_os_mcast_member joins (\join is not 0) or leaves the multicast group \group on
+ * the interface with index \ifindex (0 lets the kernel choose). If \source is not NULL
+ * only datagrams of this sender are delivered (source-specific multicast). The socket
+ * must have the family of \group. Returns ASYN_INUSE if the group was already joined,
+ * ASYN_FAILED if it was not joined or the interface does not exist, ASYN_TOOMANY if
+ * the socket's limit of memberships is reached and ASYN_NOTSUPP if \group is not a
+ * multicast address.
+ * \asyn_os_setmcast_hops sets the TTL (hop limit) of sent multicast datagrams.
+ * \asyn_os_setmcast_loop enables (\set is not 0) or disables the delivery of sent
+ * multicast datagrams to local members.
+ */
+extern unsigned int asyn_os_mcast_member(signed int fd, unsigned int join, const asyn_addr_t *group, const asyn_addr_t *source, unsigned int ifindex);
+extern unsigned int asyn_os_setmcast_hops(signed int fd, unsigned int hops);
+extern unsigned int asyn_os_setmcast_loop(signed int fd, unsigned int set);
+
+
+/* Stream sockets.
+ * \asyn_os_setreuseaddr allows to bind a listening socket while connections of a
+ * previous listener on the same port are still in TIME_WAIT (SO_REUSEADDR).
+ * \asyn_os_setnodelay disables (\set is not 0) or enables Nagle's algorithm
+ * (TCP_NODELAY).
+ * \asyn_os_listen marks \fd as listening socket with a queue of \backlog connections.
+ * \asyn_os_accept accepts a single connection and saves the new descriptor in \nfd and
+ * the peer's address in \addr (if not NULL). If \nblock or \noinherit is not 0, the
+ * new socket is nonblocking or not inherited by exec(). With ONS_SOCKET_EXTSOCK this
+ * is set atomically by accept4(). It returns ASYN_FAILED if the connection was aborted
+ * before it could be accepted; the caller should simply try the next one.
+ * \asyn_os_connect starts connecting \fd to \ip and \port. It returns ASYN_BLOCKED if
+ * the connection is in progress. Then the socket becomes writable when it is done
+ * and \asyn_os_connerr returns the result.
+ * \asyn_os_read reads up to \*size bytes into \buf and saves the number of read bytes
+ * in \size. It returns ASYN_NONE if the peer closed the connection.
+ * \asyn_os_sendv writes the \count buffers of \iov (at most ASYN_OS_IOV are used)
+ * with a single gather call and saves the number of written bytes in \done. It never
+ * raises SIGPIPE. If \zerocopy is not 0, the pages are sent without copying them
+ * (MSG_ZEROCOPY). ASYN_MEMFAIL means that the kernel could not pin the pages; the call
+ * can be repeated without \zerocopy.
+ * \asyn_os_setzerocopy allows zero-copy transmission on \fd (SO_ZEROCOPY).
+ * \asyn_os_zcreap reads one notification from the error queue of \fd. Every successful
+ * zero-copy send call gets the next 32bit sequence number, starting at 0. The
+ * notification reports that the calls \lo to \hi (inclusive) are done and the pages
+ * can be reused. Returns ASYN_NONE if another error was read and ASYN_BLOCKED if the
+ * queue is empty.
+ * Broken connections are reported as ASYN_FAILED by all calls.
+ */
+#define ASYN_OS_IOV 64
+typedef struct asyn_os_iov_t {
+    const void *buf;
+    size_t size;
+} asyn_os_iov_t;
+extern unsigned int asyn_os_setreuseaddr(signed int fd);
+extern unsigned int asyn_os_setnodelay(signed int fd, unsigned int set);
+extern unsigned int asyn_os_listen(signed int fd, unsigned int backlog);
+extern unsigned int asyn_os_accept(signed int fd, signed int *nfd, asyn_addr_t *addr, unsigned int nblock, unsigned int noinherit);
+extern unsigned int asyn_os_connect(signed int fd, unsigned int type, const void *ip, unsigned int port);
+extern unsigned int asyn_os_connerr(signed int fd);
+extern unsigned int asyn_os_read(signed int fd, void *buf, size_t *size);
+extern unsigned int asyn_os_sendv(signed int fd, const asyn_os_iov_t *iov, unsigned int count, unsigned int zerocopy, size_t *done);
+extern unsigned int asyn_os_setzerocopy(signed int fd);
+extern unsigned int asyn_os_zcreap(signed int fd, uint32_t *lo, uint32_t *hi);
+
+
+/* File streaming.
+ * These move data from a file descriptor to a socket without passing it through a user
+ * buffer. All of them read the file at offset \off without changing the file's
+ * position and save the number of moved bytes in \done. ASYN_NOTSUPP means that the
+ * file or the system does not support this way, the caller has to try the next one.
+ *
+ * \asyn_os_sendfile moves up to \count bytes directly from \file to \sock.
+ * \asyn_os_pipe creates a nonblocking pipe which is not inherited by exec(). \fds[0]
+ * is the read end.
+ * \asyn_os_splice moves up to \count bytes from \in to \out where one of both is a
+ * pipe. \off is the offset in \in or NULL if \in is a pipe. If \more is not 0, the
+ * kernel expects more data (like MSG_MORE).
+ * \asyn_os_pread reads up to \count bytes of \file into \buf.
+ */
+extern unsigned int asyn_os_sendfile(signed int sock, signed int file, uint64_t off, size_t count, size_t *done);
+extern unsigned int asyn_os_pipe(signed int *fds);
+extern unsigned int asyn_os_splice(signed int in, const uint64_t *off, signed int out, size_t count, unsigned int more, size_t *done);
+extern unsigned int asyn_os_pread(signed int file, void *buf, size_t count, uint64_t off, size_t *done);
+
+
+/* Local sockets.
+ * AF_UNIX sockets which are addressed by a filesystem path. Stream sockets use
+ * \asyn_os_listen, \asyn_os_accept, \asyn_os_read and \asyn_os_sendv like TCP sockets.
+ *
+ * \asyn_os_uxsocket creates a new stream or (\dgram is not 0) datagram socket.
+ * \asyn_os_uxpair creates two connected sockets and saves them in \fds.
+ * \asyn_os_uxbind binds \fd to \path. Returns ASYN_INUSE if the file exists.
+ * \asyn_os_uxconnect connects \fd to the socket at \path. Returns ASYN_FAILED if
+ * nobody listens there and ASYN_BLOCKED if the listener's backlog is full.
+ * \asyn_os_uxsend writes up to \*size bytes of \buf and passes the \nfds descriptors of
+ * \fds with them (SCM_RIGHTS). At most ASYN_OS_UXFDS descriptors are passed.
+ * \asyn_os_uxrecv reads up to \*size bytes into \buf and saves the received descriptors
+ * in \fds which has room for \*nfds of them. Their number is saved in \nfds. If
+ * \noinherit is not 0, they are not inherited by exec(). Descriptors which do not fit
+ * are closed. The caller has to detect the end of a stream (0 bytes and no
+ * descriptors) because empty datagrams are valid.
+ */
+#define ASYN_OS_UXFDS 16
+extern unsigned int asyn_os_uxsocket(signed int *fd, unsigned int dgram, unsigned int noinherit);
+extern unsigned int asyn_os_uxpair(signed int *fds, unsigned int dgram, unsigned int noinherit);
+extern unsigned int asyn_os_uxbind(signed int fd, const char *path);
+extern unsigned int asyn_os_uxconnect(signed int fd, const char *path);
+extern unsigned int asyn_os_uxsend(signed int fd, const void *buf, size_t *size, const signed int *fds, unsigned int nfds);
+extern unsigned int asyn_os_uxrecv(signed int fd, void *buf, size_t *size, signed int *fds, unsigned int *nfds, unsigned int noinherit);
+
+
+/* Socket helpers.
+ * These are implemented in "os_generic.c" and shared with the other backends.
+ * \asyn_os_ioerr translates errno (WSAGetLastError() on windows) of a failed send or
+ * recv call into an asynchio return code. \call is the name of the syscall which is
+ * used in debug messages.
+ *
+ * \asyn_os_mksaddr converts an asynchio address into a BSD socket address and
+ * \asyn_os_readsaddr does the reverse. The BSD structure is always supplied by the
+ * caller (normally on the stack), hence, no memory is allocated here.
+ * \asyn_os_mksaddr writes the address into \saddr and returns its length. If \ip is
+ * NULL the ANY address of the related family is used.
+ * \asyn_os_readsaddr reads \saddr with length \size into \addr. Unknown families result
+ * in an all-zero IPv4 address.
+ *
+ * Control messages: Every message which is passed to recvmsg()/sendmsg() gets its own
+ * control buffer of ASYN_OS_CBUF bytes. The union aligns it like struct cmsghdr, which
+ * holds a size_t and two ints. The struct itself is no member because glibc ends it
+ * in a flexible array, which must not be an array element.
+ * \asyn_os_cmsg_read parses the received control messages of \hdr into \msg. \msg->size
+ * must already contain the size of the received payload.
+ * \asyn_os_cmsg_write writes the control messages which are required to send \msg into
+ * \cbuf and links them into \hdr. Returns ASYN_NOTSUPP if \msg requests a feature which
+ * is not available.
+ */
+extern unsigned int asyn_os_ioerr(const char *call);
+#ifdef ONS_SOCKET_BERKELEY_HEADERS
+    #include <sys/types.h>
+    #include <sys/socket.h>
+
+    #define ASYN_OS_CBUF 128
+    typedef union asyn_os_cbuf_t {
+        size_t align;
+        void *ptr;
+        unsigned char buf[ASYN_OS_CBUF];
+    } asyn_os_cbuf_t;
+    extern socklen_t asyn_os_mksaddr(struct sockaddr_storage *saddr, unsigned int type, const void *ip, unsigned int port);
+    extern void asyn_os_readsaddr(const struct sockaddr_storage *saddr, socklen_t size, asyn_addr_t *addr);
+    extern void asyn_os_cmsg_read(struct msghdr *hdr, asyn_msg_t *msg);
+    extern unsigned int asyn_os_cmsg_write(struct msghdr *hdr, asyn_os_cbuf_t *cbuf, const asyn_msg_t *msg);
+#endif
+
+
+/* Readiness notification.
+ * This wraps the system's fast readiness notification interface (epoll on linux).
+ * All file descriptors are registered edge-triggered, that is, an event is reported
+ * only once when the state changes from "not ready" to "ready". The user has to
+ * read/write until the call returns ASYN_BLOCKED before he can expect a new event.
+ *
+ * \asyn_os_poll_init: Creates a new poll object and saves its descriptor in \pfd.
+ * \asyn_os_poll_ctl: Adds (ASYN_OS_PADD), modifies (ASYN_OS_PMOD) or removes
+ *                    (ASYN_OS_PDEL) \fd on the poll object \pfd. \events is a set of
+ *                    ASYN_OS_PIN and ASYN_OS_POUT and \data is returned together with
+ *                    every event of \fd.
+ * \asyn_os_poll_wait: Waits at most \timeout milliseconds (-1 means infinite, 0 means
+ *                     do not block) for events and writes at most \max events into
+ *                     \evs. The number of written events is saved in \count.
+ *                     ASYN_OS_PERR is set in addition when an error or hangup occurred
+ *                     on the descriptor.
+ * \asyn_os_poll_close: Closes the poll object.
+ */
+typedef struct asyn_os_pev_t {
+    unsigned int events;
+    void *data;
+} asyn_os_pev_t;
+#define ASYN_OS_PADD 0
+#define ASYN_OS_PMOD 1
+#define ASYN_OS_PDEL 2
+#define ASYN_OS_PIN 0x0001
+#define ASYN_OS_POUT 0x0002
+#define ASYN_OS_PERR 0x0004
+#define ASYN_OS_PMAX 256
+extern unsigned int asyn_os_poll_init(signed int *pfd);
+extern unsigned int asyn_os_poll_ctl(signed int pfd, unsigned int op, signed int fd, unsigned int events, void *data);
+extern unsigned int asyn_os_poll_wait(signed int pfd, asyn_os_pev_t *evs, unsigned int max, signed int timeout, unsigned int *count);
+extern void asyn_os_poll_close(signed int pfd);
+
+
+/* Wakeup objects.
+ * A descriptor which becomes readable when another thread signals it. It is used to
+ * wake up a thread which sleeps in \asyn_os_poll_wait (eventfd on linux).
+ *
+ * \asyn_os_wake_init: Creates a new nonblocking wakeup object and saves it in \wfd.
+ * \asyn_os_wake_signal: Makes \wfd readable. Can be called from any thread.
+ * \asyn_os_wake_clear: Resets \wfd so it is not readable anymore.
+ * \asyn_os_wake_close: Closes the wakeup object.
+ */
+extern unsigned int asyn_os_wake_init(signed int *wfd);
+extern void asyn_os_wake_signal(signed int wfd);
+extern void asyn_os_wake_clear(signed int wfd);
+extern void asyn_os_wake_close(signed int wfd);
+
+
+/* Coroutine stacks.
+ * \asyn_os_stack_alloc returns the lowest address of a new stack of \size bytes which
+ * must be a multiple of \asyn_os_pagesize. If the system supports it (ONS_CORO_GUARD),
+ * the page below the stack is inaccessible, so an overflow crashes the process
+ * instead of silently overwriting other memory. Returns NULL if the memory is
+ * exhausted.
+ * \asyn_os_stack_free releases a stack of \asyn_os_stack_alloc.
+ * \asyn_os_pagesize returns the size of a memory page.
+ */
+extern void *asyn_os_stack_alloc(size_t size);
+extern void asyn_os_stack_free(void *stack, size_t size);
+extern size_t asyn_os_pagesize(void);
+
+
+
+/* Completion ring.
+ * This wraps the system's completion interface (io_uring on linux). It is implemented
+ * in "os_uring.c" and every function returns ASYN_NOTSUPP if ONS_SOCKET_URING is not
+ * defined.
+ *
+ * \asyn_os_ring_init: Creates a new ring with room for \entries queued operations and
+ *                     \entries attached descriptors. It registers \bufcount receive
+ *                     buffers with \bufsize bytes of payload each.
+ * \asyn_os_ring_free: Closes the ring and frees all buffers.
+ * \asyn_os_ring_attach: Registers \fd as fixed file and saves its index in \slot.
+ * \asyn_os_ring_detach: Cancels all operations on \slot and unregisters it.
+ * \asyn_os_ring_recv: Queues a multishot receive on \slot.
+ * \asyn_os_ring_send: Queues a send of \msg on \slot. \msg is copied, but not the
+ *                     payload.
+ * \asyn_os_ring_wait: Submits all queued operations and waits until at least \min
+ *                     completions are available. Then it writes at most \max
+ *                     completions into \evs and saves their number in \count.
+ *                     \data of the operation is saved in \arg of the event.
+ * \asyn_os_ring_recycle: Returns the receive buffer \bid to the kernel. Must be called
+ *                        for every event with \bid >= 0 after the payload was used.
+ */
+#define ASYN_OS_RMAX 128
+extern unsigned int asyn_os_ring_init(struct asyn_os_ring_t **ring, unsigned int entries, size_t bufsize, unsigned int bufcount);
+extern void asyn_os_ring_free(struct asyn_os_ring_t *ring);
+extern unsigned int asyn_os_ring_attach(struct asyn_os_ring_t *ring, signed int fd, signed int *slot);
+extern void asyn_os_ring_detach(struct asyn_os_ring_t *ring, signed int slot);
+extern unsigned int asyn_os_ring_recv(struct asyn_os_ring_t *ring, signed int slot, void *data);
+extern unsigned int asyn_os_ring_send(struct asyn_os_ring_t *ring, signed int slot, const asyn_msg_t *msg, void *data);
+extern unsigned int asyn_os_ring_wait(struct asyn_os_ring_t *ring, unsigned int min, asyn_ring_ev_t *evs, unsigned int max, unsigned int *count);
+extern void asyn_os_ring_recycle(struct asyn_os_ring_t *ring, signed int bid);
+
+#endif /* ASYNCHIO_INCLUDED_backend_h */
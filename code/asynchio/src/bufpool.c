@@ -0,0 +1,161 @@
+/*
+ * (COPYRIGHT) Copyright (C) 2008, 2009, The ONS Team.
+ * This file is part of ONS, see COPYING for details.
+ */
+
+/*
+ * File information:
+ * - Created: 17. October 2026
+ * - Lead-Dev: - David Herrmann
+ * - Contributors: /
+ * - Last-Change: 17. October 2026
+ */
+
+/* Buffer pools
+ * Reference counted packet buffers which are carved out of big aligned
+ * blocks. The owner thread allocates from a private list, other threads
+ * release into a lock-free list. The owner only ever takes the whole
+ * remote list at once, so a plain CAS push is free of the ABA problem.
+ */
+
+
+#include "config/machine.h"
+#include "sundry/sundry.h"
+#include "sundry/atomic.h"
+#include "asynchio/asynchio.h"
+#include "memoria/memoria.h"
+#include "backend.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+/* Rounds \x up to a multiple of ASYN_BUF_ALIGN. */
+#define ASYN_BUF_ROUND(x) (((x) + ASYN_BUF_ALIGN - 1) & ~(size_t)(ASYN_BUF_ALIGN - 1))
+
+/* The payload starts right after the buffer header. */
+#define ASYN_BUF_HDR ASYN_BUF_ROUND(sizeof(asyn_buf_t))
+
+/* Number of buffers per block if the user passes 0. */
+#define ASYN_BUF_COUNT 256
+
+
+void asyn_bufpool_init(asyn_bufpool_t *pool, size_t size, unsigned int count) {
+    SUNDRY_ASSERT(pool != NULL);
+    SUNDRY_ASSERT(size > 0);
+
+    memset(pool, 0, sizeof(*pool));
+    pool->size = size;
+    pool->count = count?count:ASYN_BUF_COUNT;
+    pool->stride = ASYN_BUF_HDR + ASYN_BUF_ROUND(size);
+}
+
+
+void asyn_bufpool_free(asyn_bufpool_t *pool) {
+    void *block, *next;
+
+    SUNDRY_ASSERT(pool != NULL);
+
+    /* Every block starts with a pointer to the next block. */
+    for(block = pool->blocks; block; block = next) {
+        memcpy(&next, block, sizeof(void*));
+        mem_block_free(block);
+    }
+    pool->blocks = NULL;
+    pool->local = NULL;
+    pool->remote = NULL;
+}
+
+
+/* Allocates a new block and links all its buffers into the local list. */
+static void asyn_bufpool_grow(asyn_bufpool_t *pool) {
+    unsigned char *block;
+    asyn_buf_t *buf;
+    unsigned int i;
+
+    block = mem_block_alloc(ASYN_BUF_ALIGN + pool->count * pool->stride, ASYN_BUF_ALIGN);
+    memcpy(block, &pool->blocks, sizeof(void*));
+    pool->blocks = block;
+
+    for(i = pool->count; i > 0; --i) {
+        buf = (asyn_buf_t*)(block + ASYN_BUF_ALIGN + (i - 1) * pool->stride);
+        buf->pool = pool;
+        buf->next = pool->local;
+        pool->local = buf;
+    }
+}
+
+
+asyn_buf_t *asyn_buf_alloc(asyn_bufpool_t *pool) {
+    asyn_buf_t *buf;
+
+    SUNDRY_ASSERT(pool != NULL);
+
+    if(!pool->local) {
+        pool->local = sundry_atomic_xchgptr(&pool->remote, NULL);
+        if(!pool->local) asyn_bufpool_grow(pool);
+    }
+
+    buf = pool->local;
+    pool->local = buf->next;
+    buf->next = NULL;
+    buf->refs = 1;
+    memset(&buf->msg, 0, sizeof(buf->msg));
+    buf->msg.buf = (unsigned char*)buf + ASYN_BUF_HDR;
+    buf->msg.size = pool->size;
+    return buf;
+}
+
+
+asyn_buf_t *asyn_buf_ref(asyn_buf_t *buf) {
+    SUNDRY_ASSERT(buf != NULL);
+
+    sundry_atomic_add(&buf->refs, 1);
+    return buf;
+}
+
+
+void asyn_buf_unref(asyn_buf_t *buf) {
+    asyn_bufpool_t *pool;
+    void *head;
+
+    SUNDRY_ASSERT(buf != NULL);
+
+    if(sundry_atomic_sub(&buf->refs, 1) != 0) return;
+
+    pool = buf->pool;
+    do {
+        head = sundry_atomic_loadptr(&pool->remote);
+        buf->next = head;
+    } while(!sundry_atomic_casptr(&pool->remote, head, buf));
+}
+
+
+unsigned int asyn_udp_recv_pool(asyn_udp_t *udp, asyn_bufpool_t *pool, asyn_buf_t **bufs, unsigned int count, unsigned int *done) {
+    asyn_msg_t msgs[ASYN_OS_MMSG];
+    unsigned int i, ret;
+
+    SUNDRY_ASSERT(udp != NULL);
+    SUNDRY_ASSERT(pool != NULL);
+    SUNDRY_ASSERT(bufs != NULL);
+    SUNDRY_ASSERT(done != NULL);
+
+    if(count > ASYN_OS_MMSG) count = ASYN_OS_MMSG;
+    for(i = 0; i < count; ++i) {
+        bufs[i] = asyn_buf_alloc(pool);
+        memcpy(&msgs[i], &bufs[i]->msg, sizeof(msgs[i]));
+    }
+
+    ret = asyn_udp_recv_batch(udp, msgs, count, done);
+    if(ret != ASYN_DONE) *done = 0;
+    for(i = 0; i < *done; ++i) memcpy(&bufs[i]->msg, &msgs[i], sizeof(msgs[i]));
+
+    /* We are the owner, so unused buffers go straight back to the local list. */
+    for(i = count; i > *done; --i) {
+        bufs[i - 1]->next = pool->local;
+        pool->local = bufs[i - 1];
+        bufs[i - 1] = NULL;
+    }
+
+    return ret;
+}
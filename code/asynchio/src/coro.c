@@ -0,0 +1,368 @@
+/*
+ * (COPYRIGHT) Copyright (C) 2008, 2009, The ONS Team.
+ * This file is part of ONS, see COPYING for details.
+ */
+
+/*
+ * File information:
+ * - Created: 17. October 2026
+ * - Lead-Dev: - David Herrmann
+ * - Contributors: /
+ * - Last-Change: 17. October 2026
+ */
+
+/* Coroutines
+ * Every coroutine has its own stack and the coroutine object itself lives on
+ * top of it, so a stack of the pool is all a new coroutine needs. Control is
+ * only passed between a coroutine and its resumer (the loop's callback or the
+ * spawning code), never between two parked coroutines.
+ * On x86-64 the switch pushes the callee-saved registers on the current stack,
+ * exchanges the stack pointers and pops them from the other stack. All other
+ * registers are saved by the caller anyway as the switch is a normal call.
+ */
+
+
+#include "config/machine.h"
+#include "sundry/sundry.h"
+#include "asynchio/asynchio.h"
+#include "memoria/memoria.h"
+#include "backend.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef ONS_CORO_UCONTEXT
+    #include <ucontext.h>
+#endif
+
+
+#define ASYN_CORO_ALIGN(addr) ((addr) & ~(uintptr_t)15)
+
+
+#if defined(ONS_CORO_X86_64)
+
+/* \asyn_coro_swap saves the current context on the current stack and its stack
+ * pointer in \save, then continues the context which was saved at \load.
+ * \asyn_coro_boot is the first "return address" of a new coroutine. It calls the
+ * function in r13 with the argument in r12, both taken from the initial frame, and
+ * continues the context it returns without saving anything.
+ */
+extern void asyn_coro_swap(void **save, void *load) __attribute__((visibility("hidden")));
+extern void asyn_coro_boot(void) __attribute__((visibility("hidden")));
+__asm__(
+    ".pushsection .text\n"
+    ".globl asyn_coro_swap\n"
+    ".hidden asyn_coro_swap\n"
+    ".type asyn_coro_swap, @function\n"
+    "asyn_coro_swap:\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    subq $8, %rsp\n"
+    "    stmxcsr (%rsp)\n"
+    "    fnstcw 4(%rsp)\n"
+    "    movq %rsp, (%rdi)\n"
+    ".Lasyn_coro_load:\n"
+    "    movq %rsi, %rsp\n"
+    "    ldmxcsr (%rsp)\n"
+    "    fldcw 4(%rsp)\n"
+    "    addq $8, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    ".size asyn_coro_swap, .-asyn_coro_swap\n"
+    ".globl asyn_coro_boot\n"
+    ".hidden asyn_coro_boot\n"
+    ".type asyn_coro_boot, @function\n"
+    "asyn_coro_boot:\n"
+    "    movq %r12, %rdi\n"
+    "    callq *%r13\n"
+    "    movq %rax, %rsi\n"
+    "    jmp .Lasyn_coro_load\n"
+    ".size asyn_coro_boot, .-asyn_coro_boot\n"
+    ".popsection\n"
+);
+
+#elif defined(ONS_CORO_UCONTEXT)
+
+/* The contexts are saved between the coroutine object and the top of its stack. */
+typedef struct asyn_coro_uctx_t {
+    ucontext_t self;
+    ucontext_t caller;
+} asyn_coro_uctx_t;
+
+#endif
+
+
+#if defined(ONS_CORO_X86_64) || defined(ONS_CORO_UCONTEXT)
+
+/* Switches from \coro back to the code which resumed it. */
+static void asyn_coro_suspend(asyn_coro_t *coro) {
+#ifdef ONS_CORO_X86_64
+    asyn_coro_swap(&coro->context, coro->caller);
+#else
+    asyn_coro_uctx_t *uctx = coro->context;
+
+    swapcontext(&uctx->self, &uctx->caller);
+#endif
+}
+
+
+/* Runs the body and returns the context of the resumer, which is continued without
+ * another call. The frames of the body are dead then, so objects it left registered
+ * cannot be removed anymore; the body has to remove them itself.
+ */
+static void *asyn_coro_main(asyn_coro_t *coro) {
+    coro->fn(coro, coro->arg);
+    SUNDRY_MASSERT(coro->evs == NULL, "asyn_coro_main(): Coroutine ended with registered objects.");
+    coro->ended = 1;
+    --coro->sched->live;
+    return coro->caller;
+}
+
+
+#ifdef ONS_CORO_UCONTEXT
+/* makecontext() only passes int arguments, so the pointer is split into two halves.
+ * Returning continues \uc_link, which is the context of the resumer.
+ */
+static void asyn_coro_ucmain(unsigned int high, unsigned int low) {
+    asyn_coro_main((asyn_coro_t*)(uintptr_t)(((uint64_t)high << 32) | low));
+}
+#endif
+
+
+/* Sets up the stack of \coro so the next resume enters \asyn_coro_main. */
+static void asyn_coro_prepare(asyn_coro_t *coro) {
+#ifdef ONS_CORO_X86_64
+    uint64_t *frame;
+
+    /* The frame is popped by \asyn_coro_swap. Afterwards the stack pointer is the
+     * 16 byte aligned address of \coro, as the ABI wants it before a call.
+     */
+    frame = (uint64_t*)coro - 8;
+    frame[0] = ((uint64_t)0x037f << 32) | 0x1f80;  /* Default x87 control word and MXCSR. */
+    frame[1] = 0;                                   /* r15 */
+    frame[2] = 0;                                   /* r14 */
+    frame[3] = (uintptr_t)asyn_coro_main;           /* r13 */
+    frame[4] = (uintptr_t)coro;                     /* r12 */
+    frame[5] = 0;                                   /* rbx */
+    frame[6] = 0;                                   /* rbp */
+    frame[7] = (uintptr_t)asyn_coro_boot;
+    coro->context = frame;
+#else
+    asyn_coro_uctx_t *uctx = coro->context;
+    uint64_t ptr = (uintptr_t)coro;
+
+    getcontext(&uctx->self);
+    uctx->self.uc_stack.ss_sp = coro->stack;
+    uctx->self.uc_stack.ss_size = (unsigned char*)coro - (unsigned char*)coro->stack;
+    uctx->self.uc_link = &uctx->caller;
+    makecontext(&uctx->self, (void (*)(void))asyn_coro_ucmain, 2, (unsigned int)(ptr >> 32), (unsigned int)ptr);
+#endif
+}
+
+
+/* Allocates a new stack and places the coroutine object on top of it. */
+static asyn_coro_t *asyn_coro_new(asyn_sched_t *sched) {
+    asyn_coro_t *coro;
+    unsigned char *stack;
+    uintptr_t top;
+
+    stack = asyn_os_stack_alloc(sched->stacksize);
+    if(!stack) return NULL;
+
+    top = (uintptr_t)stack + sched->stacksize;
+#ifdef ONS_CORO_UCONTEXT
+    top = ASYN_CORO_ALIGN(top - sizeof(asyn_coro_uctx_t));
+#endif
+    coro = (asyn_coro_t*)ASYN_CORO_ALIGN(top - sizeof(asyn_coro_t));
+    memset(coro, 0, sizeof(*coro));
+    coro->stack = stack;
+#ifdef ONS_CORO_UCONTEXT
+    coro->context = (void*)top;
+#endif
+    return coro;
+}
+
+
+/* Switches to \coro until it waits or ends. Returns 1 if it ended, then its stack
+ * was given back to the scheduler and \coro must not be used anymore.
+ */
+static unsigned int asyn_coro_resume(asyn_coro_t *coro) {
+    asyn_sched_t *sched = coro->sched;
+#ifdef ONS_CORO_UCONTEXT
+    asyn_coro_uctx_t *uctx = coro->context;
+
+    swapcontext(&uctx->caller, &uctx->self);
+#else
+    asyn_coro_swap(&coro->caller, coro->context);
+#endif
+
+    if(!coro->ended) return 0;
+
+    if(sched->pooled < sched->poolmax) {
+        coro->next = sched->pool;
+        sched->pool = coro;
+        ++sched->pooled;
+    }
+    else asyn_os_stack_free(coro->stack, sched->stacksize);
+    return 1;
+}
+
+
+/* Resumes the coroutine of \ev if it waits for \events. The readiness is always
+ * consumed: a coroutine which needs more waits again after its IO call blocked.
+ */
+static unsigned int asyn_coro_ready(asyn_ev_t *ev, unsigned int events) {
+    asyn_coro_t *coro = ev->arg;
+
+    if(coro->wait != ev || !(coro->events & events)) return ASYN_BLOCKED;
+
+    coro->wait = NULL;
+    coro->events = 0;
+
+    /* An ended coroutine removed \ev, which was gone with its stack. */
+    if(asyn_coro_resume(coro)) return ASYN_NONE;
+    return ASYN_BLOCKED;
+}
+
+
+static unsigned int asyn_coro_read(asyn_loop_t *loop, asyn_ev_t *ev) {
+    return asyn_coro_ready(ev, ASYN_EV_READ);
+}
+
+
+static unsigned int asyn_coro_write(asyn_loop_t *loop, asyn_ev_t *ev) {
+    return asyn_coro_ready(ev, ASYN_EV_WRITE);
+}
+
+#endif /* defined(ONS_CORO_X86_64) || defined(ONS_CORO_UCONTEXT) */
+
+
+void asyn_sched_init(asyn_sched_t *sched, asyn_loop_t *loop, size_t stacksize, unsigned int poolmax) {
+    size_t page;
+
+    SUNDRY_ASSERT(sched != NULL);
+    SUNDRY_ASSERT(loop != NULL);
+
+    if(stacksize == 0) stacksize = ASYN_CORO_STACK;
+    page = asyn_os_pagesize();
+
+    memset(sched, 0, sizeof(*sched));
+    sched->loop = loop;
+    sched->stacksize = (stacksize + page - 1) / page * page;
+    sched->poolmax = poolmax?poolmax:ASYN_CORO_POOL;
+}
+
+
+void asyn_sched_free(asyn_sched_t *sched) {
+    asyn_coro_t *coro;
+
+    SUNDRY_ASSERT(sched != NULL);
+    SUNDRY_MASSERT(sched->live == 0, "asyn_sched_free(): Coroutines are still running.");
+
+    while((coro = sched->pool)) {
+        sched->pool = coro->next;
+        asyn_os_stack_free(coro->stack, sched->stacksize);
+    }
+    sched->pooled = 0;
+}
+
+
+unsigned int asyn_coro_spawn(asyn_sched_t *sched, asyn_coro_fn_t fn, void *arg) {
+#if defined(ONS_CORO_X86_64) || defined(ONS_CORO_UCONTEXT)
+    asyn_coro_t *coro;
+
+    SUNDRY_ASSERT(sched != NULL);
+    SUNDRY_ASSERT(fn != NULL);
+
+    if(sched->pool) {
+        coro = sched->pool;
+        sched->pool = coro->next;
+        --sched->pooled;
+    }
+    else {
+        coro = asyn_coro_new(sched);
+        if(!coro) return ASYN_MEMFAIL;
+    }
+
+    coro->sched = sched;
+    coro->arg = arg;
+    coro->fn = fn;
+    coro->ended = 0;
+    coro->wait = NULL;
+    coro->events = 0;
+    coro->evs = NULL;
+    coro->next = NULL;
+    asyn_coro_prepare(coro);
+
+    ++sched->live;
+    asyn_coro_resume(coro);
+    return ASYN_DONE;
+#else
+    return ASYN_NOTSUPP;
+#endif
+}
+
+
+unsigned int asyn_coro_add(asyn_coro_t *coro, asyn_ev_t *ev, signed int fd) {
+#if defined(ONS_CORO_X86_64) || defined(ONS_CORO_UCONTEXT)
+    unsigned int ret;
+
+    SUNDRY_ASSERT(coro != NULL);
+    SUNDRY_ASSERT(ev != NULL);
+
+    asyn_ev_init(ev, fd, asyn_coro_read, asyn_coro_write, coro);
+    ret = asyn_loop_add(coro->sched->loop, ev, ASYN_EV_READ | ASYN_EV_WRITE);
+    if(ret != ASYN_DONE) return ret;
+
+    ev->onext = coro->evs;
+    coro->evs = ev;
+    return ASYN_DONE;
+#else
+    return ASYN_NOTSUPP;
+#endif
+}
+
+
+void asyn_coro_del(asyn_coro_t *coro, asyn_ev_t *ev) {
+    asyn_ev_t **iter;
+
+    SUNDRY_ASSERT(coro != NULL);
+    SUNDRY_ASSERT(ev != NULL);
+
+    for(iter = &coro->evs; *iter; iter = &(*iter)->onext) {
+        if(*iter == ev) {
+            *iter = ev->onext;
+            break;
+        }
+    }
+    ev->onext = NULL;
+    if(coro->wait == ev) coro->wait = NULL;
+    asyn_loop_del(ev);
+}
+
+
+unsigned int asyn_coro_await(asyn_coro_t *coro, asyn_ev_t *ev, unsigned int events) {
+#if defined(ONS_CORO_X86_64) || defined(ONS_CORO_UCONTEXT)
+    SUNDRY_ASSERT(coro != NULL);
+    SUNDRY_ASSERT(ev != NULL);
+
+    if(ev->arg != coro || ev->read != asyn_coro_read || ev->loop != coro->sched->loop) return ASYN_FAILED;
+
+    coro->wait = ev;
+    coro->events = events;
+    asyn_coro_suspend(coro);
+    return ASYN_DONE;
+#else
+    return ASYN_NOTSUPP;
+#endif
+}
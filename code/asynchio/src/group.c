@@ -0,0 +1,142 @@
+/*
+ * (COPYRIGHT) Copyright (C) 2008, 2009, The ONS Team.
+ * This file is part of ONS, see COPYING for details.
+ */
+
+/*
+ * File information:
+ * - Created: 17. October 2026
+ * - Lead-Dev: - David Herrmann
+ * - Contributors: /
+ * - Last-Change: 17. October 2026
+ */
+
+/* UDP groups
+ * Several UDP sockets which share one port with SO_REUSEPORT, each one
+ * served by its own sundry thread.
+ */
+
+
+#include "config/machine.h"
+#include "sundry/sundry.h"
+#include "sundry/thread.h"
+#include "asynchio/asynchio.h"
+#include "memoria/memoria.h"
+#include "backend.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+/* Per-thread data. \group->workers points to an array of these. */
+typedef struct asyn_udp_gworker_t {
+    sundry_thread_t thread;
+    asyn_udp_group_t *group;
+    unsigned int index;
+} asyn_udp_gworker_t;
+
+
+static void *asyn_udp_group_main(void *arg) {
+    asyn_udp_gworker_t *worker = arg;
+
+    worker->group->fn(worker->group, &worker->group->udps[worker->index], worker->index);
+    return NULL;
+}
+
+
+/* Stops and joins all running workers.
+ * Shutting the sockets down wakes up every worker which is blocked in a call
+ * or in a loop which waits for the socket. Then they see the stop flag.
+ */
+static void asyn_udp_group_stop(asyn_udp_group_t *group) {
+    asyn_udp_gworker_t *workers = group->workers;
+    unsigned int i;
+
+    group->stop = 1;
+    if(!workers) return;
+
+    for(i = 0; i < group->count; ++i) asyn_os_shutdown(group->udps[i].fd);
+    for(i = 0; i < group->running; ++i) sundry_thread_join(&workers[i].thread);
+    mem_free(workers);
+    group->workers = NULL;
+    group->running = 0;
+}
+
+
+unsigned int asyn_udp_group_init(asyn_udp_group_t *group, unsigned int count, unsigned int opts, unsigned int type, const void *addr, unsigned int port) {
+    asyn_addr_t local;
+    unsigned int i, ret;
+
+    SUNDRY_ASSERT(group != NULL);
+    SUNDRY_ASSERT(count > 0);
+
+    memset(group, 0, sizeof(*group));
+    group->udps = mem_zmalloc(count * sizeof(asyn_udp_t));
+    opts |= ASYN_UDP_REUSEPORT;
+
+    for(i = 0; i < count; ++i) {
+        ret = asyn_udp_init(&group->udps[i], opts, type, addr, port);
+        if(ret != ASYN_DONE) goto failed;
+
+        /* Bind all other sockets to the port which the kernel picked. */
+        if(i == 0 && port == 0) {
+            ret = asyn_udp_addr(&group->udps[0], &local);
+            if(ret != ASYN_DONE) {
+                ++i;
+                goto failed;
+            }
+            port = local.port;
+        }
+    }
+
+    group->count = count;
+    return ASYN_DONE;
+
+    failed:
+    while(i--) asyn_udp_close(&group->udps[i]);
+    mem_free(group->udps);
+    group->udps = NULL;
+    return ret;
+}
+
+
+unsigned int asyn_udp_group_start(asyn_udp_group_t *group, asyn_udp_worker_t fn, void *arg) {
+    asyn_udp_gworker_t *workers;
+    unsigned int i;
+
+    SUNDRY_ASSERT(group != NULL);
+    SUNDRY_ASSERT(fn != NULL);
+    SUNDRY_MASSERT(group->workers == NULL, "asyn_udp_group_start(): Group is already running.");
+
+    group->fn = fn;
+    group->arg = arg;
+    group->stop = 0;
+    workers = mem_zmalloc(group->count * sizeof(asyn_udp_gworker_t));
+    group->workers = workers;
+
+    for(i = 0; i < group->count; ++i) {
+        workers[i].group = group;
+        workers[i].index = i;
+        if(!sundry_thread_run(&workers[i].thread, asyn_udp_group_main, &workers[i])) {
+            asyn_udp_group_stop(group);
+            return ASYN_TOOMANY;
+        }
+        ++group->running;
+    }
+
+    return ASYN_DONE;
+}
+
+
+void asyn_udp_group_free(asyn_udp_group_t *group) {
+    unsigned int i;
+
+    SUNDRY_ASSERT(group != NULL);
+
+    asyn_udp_group_stop(group);
+
+    for(i = 0; i < group->count; ++i) asyn_udp_close(&group->udps[i]);
+    mem_free(group->udps);
+    group->udps = NULL;
+    group->count = 0;
+}
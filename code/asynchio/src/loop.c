@@ -0,0 +1,352 @@
+/*
+ * (COPYRIGHT) Copyright (C) 2008, 2009, The ONS Team.
+ * This file is part of ONS, see COPYING for details.
+ */
+
+/*
+ * File information:
+ * - Created: 17. October 2026
+ * - Lead-Dev: - David Herrmann
+ * - Contributors: /
+ * - Last-Change: 17. October 2026
+ */
+
+/* Event loop
+ * Dispatches readiness of asynchio objects to user callbacks. The
+ * platform specific readiness interface is hidden in the asyn_os_poll_*
+ * wrappers so this file does not depend on the system.
+ */
+
+
+#include "config/machine.h"
+#include "sundry/sundry.h"
+#include "asynchio/asynchio.h"
+#include "memoria/memoria.h"
+#include "backend.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+/* Number of events which are fetched from the kernel with one call. */
+#define ASYN_LOOP_EVENTS 128
+
+
+/* Translates ASYN_EV_* into ASYN_OS_P* flags. */
+static unsigned int asyn_loop_osev(unsigned int events) {
+    unsigned int ret = 0;
+
+    if(events & ASYN_EV_READ) ret |= ASYN_OS_PIN;
+    if(events & ASYN_EV_WRITE) ret |= ASYN_OS_POUT;
+    return ret;
+}
+
+
+/* Links \ev at the end of the ready queue if it is not queued, yet. */
+static void asyn_loop_queue(asyn_loop_t *loop, asyn_ev_t *ev) {
+    if(ev->queued) return;
+    mem_llist_nbn_push(loop, ev);
+    ev->queued = 1;
+    ++loop->nready;
+}
+
+
+/* Unlinks \ev from the ready queue. */
+static void asyn_loop_unqueue(asyn_loop_t *loop, asyn_ev_t *ev) {
+    if(!ev->queued) return;
+    mem_llist_nbn_remove(loop, ev);
+    ev->queued = 0;
+    --loop->nready;
+}
+
+
+void asyn_ev_init(asyn_ev_t *ev, signed int fd, asyn_ev_fn_t read, asyn_ev_fn_t write, void *arg) {
+    SUNDRY_ASSERT(ev != NULL);
+
+    memset(ev, 0, sizeof(*ev));
+    ev->fd = fd;
+    ev->read = read;
+    ev->write = write;
+    ev->arg = arg;
+}
+
+
+unsigned int asyn_loop_init(asyn_loop_t *loop, unsigned int budget) {
+    unsigned int ret;
+
+    SUNDRY_ASSERT(loop != NULL);
+
+    memset(loop, 0, sizeof(*loop));
+    loop->budget = budget?budget:ASYN_LOOP_BUDGET;
+    ret = asyn_os_poll_init(&loop->fd);
+    if(ret != ASYN_DONE) return ret;
+    return ASYN_DONE;
+}
+
+
+void asyn_loop_free(asyn_loop_t *loop) {
+    SUNDRY_ASSERT(loop != NULL);
+
+    /* Unlink all queued objects so they can be registered on another loop. */
+    while(loop->first) asyn_loop_unqueue(loop, loop->first);
+    asyn_os_poll_close(loop->fd);
+    loop->fd = -1;
+}
+
+
+unsigned int asyn_loop_add(asyn_loop_t *loop, asyn_ev_t *ev, unsigned int events) {
+    unsigned int ret;
+
+    SUNDRY_ASSERT(loop != NULL);
+    SUNDRY_ASSERT(ev != NULL);
+    SUNDRY_MASSERT(ev->loop == NULL, "asyn_loop_add(): Object is already registered.");
+
+    events &= ASYN_EV_READ | ASYN_EV_WRITE;
+    ret = asyn_os_poll_ctl(loop->fd, ASYN_OS_PADD, ev->fd, asyn_loop_osev(events), ev);
+    if(ret != ASYN_DONE) return ret;
+
+    ev->loop = loop;
+    ev->events = events;
+    ev->pending = 0;
+    ev->queued = 0;
+    ev->next = ev->prev = NULL;
+    if(ev->spin) {
+        ev->snext = loop->spinning;
+        loop->spinning = ev;
+    }
+    ++loop->count;
+    return ASYN_DONE;
+}
+
+
+unsigned int asyn_loop_mod(asyn_ev_t *ev, unsigned int events) {
+    unsigned int ret;
+
+    SUNDRY_ASSERT(ev != NULL);
+    SUNDRY_MASSERT(ev->loop != NULL, "asyn_loop_mod(): Object is not registered.");
+
+    events &= ASYN_EV_READ | ASYN_EV_WRITE;
+    ret = asyn_os_poll_ctl(ev->loop->fd, ASYN_OS_PMOD, ev->fd, asyn_loop_osev(events), ev);
+    if(ret != ASYN_DONE) return ret;
+
+    /* Modifying an edge-triggered watch rearms it. That is, the kernel reports the
+     * current readiness again, so we can safely drop readiness we remembered.
+     */
+    ev->events = events;
+    ev->pending &= events;
+    if(!ev->pending) asyn_loop_unqueue(ev->loop, ev);
+    return ASYN_DONE;
+}
+
+
+void asyn_loop_del(asyn_ev_t *ev) {
+    asyn_ev_t **iter;
+
+    SUNDRY_ASSERT(ev != NULL);
+
+    if(!ev->loop) return;
+
+    /* Errors are ignored. If \fd was already closed, the kernel already dropped it. */
+    asyn_os_poll_ctl(ev->loop->fd, ASYN_OS_PDEL, ev->fd, 0, NULL);
+    asyn_loop_unqueue(ev->loop, ev);
+    for(iter = &ev->loop->spinning; *iter; iter = &(*iter)->snext) {
+        if(*iter == ev) {
+            *iter = ev->snext;
+            break;
+        }
+    }
+    ev->snext = NULL;
+    --ev->loop->count;
+    ev->loop = NULL;
+    ev->events = 0;
+    ev->pending = 0;
+}
+
+
+/* Calls \fn until it does not return ASYN_DONE or the budget is exhausted.
+ * Returns ASYN_DONE if the budget was exhausted, ASYN_BLOCKED if the readiness
+ * was consumed and ASYN_NONE if \ev must not be touched anymore.
+ */
+static unsigned int asyn_loop_call(asyn_loop_t *loop, asyn_ev_t *ev, asyn_ev_fn_t fn) {
+    unsigned int i, budget, ret;
+
+    budget = ev->budget?ev->budget:loop->budget;
+    for(i = 0; i < budget; ++i) {
+        ret = fn(loop, ev);
+        if(ret == ASYN_BLOCKED) return ASYN_BLOCKED;
+        else if(ret != ASYN_DONE) return ASYN_NONE;
+    }
+    return ASYN_DONE;
+}
+
+
+/* Dispatches the pending readiness of \ev.
+ * Returns ASYN_NONE if \ev must not be touched anymore.
+ */
+static unsigned int asyn_loop_dispatch(asyn_loop_t *loop, asyn_ev_t *ev) {
+    unsigned int ret;
+
+    if(ev->pending & ASYN_EV_READ) {
+        if(!ev->read) ev->pending &= ~ASYN_EV_READ;
+        else {
+            ret = asyn_loop_call(loop, ev, ev->read);
+            if(ret == ASYN_NONE) return ASYN_NONE;
+            else if(ret == ASYN_BLOCKED) ev->pending &= ~ASYN_EV_READ;
+            /* The callback may have removed \ev without returning an error. */
+            if(ev->loop != loop) return ASYN_NONE;
+        }
+    }
+
+    if(ev->pending & ASYN_EV_WRITE) {
+        if(!ev->write) ev->pending &= ~ASYN_EV_WRITE;
+        else {
+            ret = asyn_loop_call(loop, ev, ev->write);
+            if(ret == ASYN_NONE) return ASYN_NONE;
+            else if(ret == ASYN_BLOCKED) ev->pending &= ~ASYN_EV_WRITE;
+            if(ev->loop != loop) return ASYN_NONE;
+        }
+    }
+
+    return ASYN_DONE;
+}
+
+
+/* Waits at most \timeout milliseconds for readiness and queues the ready objects. */
+static unsigned int asyn_loop_collect(asyn_loop_t *loop, signed int timeout) {
+    asyn_os_pev_t evs[ASYN_LOOP_EVENTS];
+    unsigned int ret, count, i, events;
+    asyn_ev_t *ev;
+
+    ret = asyn_os_poll_wait(loop->fd, evs, ASYN_LOOP_EVENTS, timeout, &count);
+    if(ret != ASYN_DONE) return ret;
+
+    /* First collect all events before calling any callback. This way callbacks
+     * can remove (and free) any object without leaving dangling pointers in \evs.
+     */
+    for(i = 0; i < count; ++i) {
+        ev = evs[i].data;
+        events = 0;
+        if(evs[i].events & ASYN_OS_PIN) events |= ASYN_EV_READ;
+        if(evs[i].events & ASYN_OS_POUT) events |= ASYN_EV_WRITE;
+        if(evs[i].events & ASYN_OS_PERR) events |= ASYN_EV_READ | ASYN_EV_WRITE;
+        ev->pending |= events & ev->events;
+        if(ev->pending) asyn_loop_queue(loop, ev);
+    }
+
+    return ASYN_DONE;
+}
+
+
+/* Polls the read callbacks of the spinning objects and the readiness interface
+ * without sleeping until an object is ready or \limit nanoseconds passed. Returns
+ * ASYN_DONE if objects are ready, ASYN_BLOCKED if the time passed.
+ */
+static unsigned int asyn_loop_busy(asyn_loop_t *loop, uint64_t start, uint64_t limit) {
+    asyn_ev_t *ev;
+    unsigned int ret;
+
+    do {
+        /* A callback which gets work queues its object like a readiness event would.
+         * It may remove any object, so \ev->snext is read after the call.
+         */
+        for(ev = loop->spinning; ev; ev = ev->snext) {
+            if(ev->queued || !ev->read || !(ev->events & ASYN_EV_READ)) continue;
+            ret = ev->read(loop, ev);
+            if(ret != ASYN_BLOCKED) {
+                if(ret == ASYN_DONE && ev->loop == loop) {
+                    ev->pending |= ASYN_EV_READ;
+                    asyn_loop_queue(loop, ev);
+                }
+                return ASYN_DONE;
+            }
+            if(ev->loop != loop) break;
+        }
+
+        ret = asyn_loop_collect(loop, 0);
+        if(ret != ASYN_DONE) return ret;
+        if(loop->first) return ASYN_DONE;
+    } while(asyn_os_clock() - start < limit);
+
+    return ASYN_BLOCKED;
+}
+
+
+unsigned int asyn_loop_run_once(asyn_loop_t *loop, signed int timeout) {
+    unsigned int ret;
+    signed long next;
+    uint64_t start, limit, now;
+    size_t round;
+    asyn_ev_t *ev;
+
+    SUNDRY_ASSERT(loop != NULL);
+
+    /* Objects which exhausted their budget in the last round are still ready,
+     * so we must not sleep. Otherwise we sleep at most until the next timer.
+     */
+    if(loop->first) timeout = 0;
+    else if(loop->wheel) {
+        next = asyn_wheel_next(loop->wheel);
+        if(next >= 0 && (timeout < 0 || next < timeout)) timeout = next;
+    }
+
+    if(!loop->spin || timeout == 0) ret = asyn_loop_collect(loop, timeout);
+    else {
+        /* Hybrid mode: spin for the budget (never beyond the timeout), then sleep. */
+        start = asyn_os_clock();
+        limit = (uint64_t)loop->spin * 1000;
+        if(timeout > 0 && (uint64_t)timeout * 1000000 < limit) limit = (uint64_t)timeout * 1000000;
+
+        ret = asyn_loop_busy(loop, start, limit);
+        now = asyn_os_clock();
+        loop->stats.spin_ns += now - start;
+        if(ret == ASYN_DONE) ++loop->stats.spin_hits;
+        else if(ret == ASYN_BLOCKED) {
+            ++loop->stats.spin_misses;
+            if(timeout > 0) {
+                timeout -= (now - start) / 1000000;
+                if(timeout < 0) timeout = 0;
+            }
+            ret = asyn_loop_collect(loop, timeout);
+            loop->stats.sleep_ns += asyn_os_clock() - now;
+        }
+    }
+    if(ret != ASYN_DONE) return ret;
+
+    /* Serve every queued object once. Objects which still have pending work
+     * after this round are requeued at the end, so they are served again after
+     * all other objects.
+     */
+    for(round = loop->nready; round > 0 && loop->first; --round) {
+        ev = loop->first;
+        asyn_loop_unqueue(loop, ev);
+        if(asyn_loop_dispatch(loop, ev) == ASYN_NONE) continue;
+        if(ev->pending) asyn_loop_queue(loop, ev);
+    }
+
+    if(loop->wheel) asyn_wheel_run(loop->wheel);
+    return ASYN_DONE;
+}
+
+
+void asyn_loop_stats(asyn_loop_t *loop, asyn_loop_stats_t *stats) {
+    SUNDRY_ASSERT(loop != NULL);
+    SUNDRY_ASSERT(stats != NULL);
+
+    memcpy(stats, &loop->stats, sizeof(*stats));
+    memset(&loop->stats, 0, sizeof(loop->stats));
+}
+
+
+unsigned int asyn_loop_run(asyn_loop_t *loop) {
+    unsigned int ret;
+
+    SUNDRY_ASSERT(loop != NULL);
+
+    loop->stop = 0;
+    while(!loop->stop) {
+        ret = asyn_loop_run_once(loop, -1);
+        if(ret != ASYN_DONE) return ret;
+    }
+    loop->stop = 0;
+    return ASYN_DONE;
+}
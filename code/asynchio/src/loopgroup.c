@@ -0,0 +1,311 @@
+/*
+ * (COPYRIGHT) Copyright (C) 2008, 2009, The ONS Team.
+ * This file is part of ONS, see COPYING for details.
+ */
+
+/*
+ * File information:
+ * - Created: 17. October 2026
+ * - Lead-Dev: - David Herrmann
+ * - Contributors: /
+ * - Last-Change: 17. October 2026
+ */
+
+/* Loop groups
+ * One event loop per sundry thread plus a Chase-Lev work-stealing deque of
+ * tasks per loop. The owner pushes and pops at the bottom without a CAS
+ * except for the last task, thieves take the oldest task from the top with
+ * a single CAS. The deque has a fixed size, so it never needs to grow.
+ */
+
+
+#include "config/machine.h"
+#include "sundry/sundry.h"
+#include "sundry/thread.h"
+#include "sundry/atomic.h"
+#include "asynchio/asynchio.h"
+#include "memoria/memoria.h"
+#include "backend.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+#define ASYN_TASK_MASK (ASYN_TASK_SLOTS - 1)
+
+
+/* Takes the newest task of the own deque. Returns NULL if it is empty. */
+static asyn_task_t *asyn_task_pop(asyn_worker_t *worker) {
+    asyn_task_t *task;
+    long top, bottom;
+
+    bottom = worker->bottom - 1;
+    sundry_atomic_store(&worker->bottom, bottom);
+    sundry_atomic_fence();
+    top = sundry_atomic_load(&worker->top);
+
+    if(top > bottom) {
+        sundry_atomic_store(&worker->bottom, bottom + 1);
+        return NULL;
+    }
+
+    task = sundry_atomic_loadptr(&worker->tasks[bottom & ASYN_TASK_MASK]);
+    if(top == bottom) {
+        /* This is the last task, so we race with the thieves for it. */
+        if(!sundry_atomic_cas(&worker->top, top, top + 1)) task = NULL;
+        sundry_atomic_store(&worker->bottom, bottom + 1);
+    }
+    return task;
+}
+
+
+/* Takes the oldest task of the deque of \victim. Returns NULL if it is empty or
+ * if another thread was faster.
+ */
+static asyn_task_t *asyn_task_steal(asyn_worker_t *victim) {
+    asyn_task_t *task;
+    long top, bottom;
+
+    top = sundry_atomic_load(&victim->top);
+    sundry_atomic_fence();
+    bottom = sundry_atomic_load(&victim->bottom);
+    if(top >= bottom) return NULL;
+
+    task = sundry_atomic_loadptr(&victim->tasks[top & ASYN_TASK_MASK]);
+    if(!sundry_atomic_cas(&victim->top, top, top + 1)) return NULL;
+    return task;
+}
+
+
+/* Tries to steal one task of any other worker. We start at the victim of the last
+ * successful steal because a loaded worker usually stays loaded for a while.
+ */
+static asyn_task_t *asyn_task_find(asyn_worker_t *worker) {
+    asyn_loopgroup_t *group = worker->group;
+    asyn_task_t *task;
+    unsigned int i, victim;
+
+    for(i = 0; i < group->count; ++i) {
+        victim = (worker->victim + i) % group->count;
+        if(victim == worker->index) continue;
+        task = asyn_task_steal(&group->workers[victim]);
+        if(task) {
+            worker->victim = victim;
+            ++worker->stolen;
+            return task;
+        }
+    }
+    return NULL;
+}
+
+
+/* Returns 1 if any worker of the group has queued tasks. */
+static unsigned int asyn_task_any(asyn_loopgroup_t *group) {
+    unsigned int i;
+
+    for(i = 0; i < group->count; ++i) {
+        if(sundry_atomic_load(&group->workers[i].top) < sundry_atomic_load(&group->workers[i].bottom)) return 1;
+    }
+    return 0;
+}
+
+
+/* Runs at most \group->budget tasks. Own tasks are preferred, others are only
+ * stolen if the own deque is empty. Returns the number of executed tasks.
+ */
+static unsigned int asyn_worker_tasks(asyn_worker_t *worker) {
+    asyn_task_t *task;
+    unsigned int num;
+
+    for(num = 0; num < worker->group->budget; ++num) {
+        task = asyn_task_pop(worker);
+        if(!task && worker->group->count > 1) task = asyn_task_find(worker);
+        if(!task) break;
+        ++worker->executed;
+        task->fn(worker, task);
+    }
+    return num;
+}
+
+
+static void *asyn_loopgroup_main(void *arg) {
+    asyn_worker_t *worker = arg;
+    asyn_loopgroup_t *group = worker->group;
+    signed int timeout;
+
+    if(group->setup) group->setup(worker);
+
+    while(!group->stop) {
+        /* While there are tasks we only poll the loop, so IO is served between
+         * two batches of tasks but we never sleep.
+         */
+        timeout = 0;
+        if(!asyn_worker_tasks(worker)) {
+            /* Announce that we go to sleep before checking the deques a last time.
+             * A pusher either sees us sleeping and wakes us up or we see its task.
+             */
+            sundry_atomic_store(&worker->sleeping, 1);
+            sundry_atomic_add(&group->sleepers, 1);
+            sundry_atomic_fence();
+            if(!asyn_task_any(group) && !group->stop) timeout = -1;
+        }
+
+        if(asyn_loop_run_once(&worker->loop, timeout) != ASYN_DONE) {
+            SUNDRY_DEBUG("asyn_loopgroup_main(): Loop %u failed.", worker->index);
+            group->stop = 1;
+        }
+
+        /* A pusher which woke us up already removed us from the sleepers. */
+        if(sundry_atomic_cas(&worker->sleeping, 1, 0)) sundry_atomic_sub(&group->sleepers, 1);
+    }
+
+    return NULL;
+}
+
+
+void asyn_loopgroup_stop(asyn_loopgroup_t *group) {
+    unsigned int i;
+
+    SUNDRY_ASSERT(group != NULL);
+
+    group->stop = 1;
+    sundry_atomic_fence();
+    for(i = 0; i < group->count; ++i) asyn_os_wake_signal(group->workers[i].queue.ev.fd);
+}
+
+
+unsigned int asyn_loopgroup_init(asyn_loopgroup_t *group, unsigned int count, unsigned int budget) {
+    asyn_worker_t *worker;
+    unsigned int i, ret;
+
+    SUNDRY_ASSERT(group != NULL);
+    SUNDRY_ASSERT(count > 0);
+
+    memset(group, 0, sizeof(*group));
+    group->workers = mem_zmalloc(count * sizeof(asyn_worker_t));
+    group->budget = budget?budget:ASYN_LOOP_BUDGET;
+
+    for(i = 0; i < count; ++i) {
+        worker = &group->workers[i];
+        worker->group = group;
+        worker->index = i;
+        worker->victim = i;
+        worker->tasks = mem_zmalloc(ASYN_TASK_SLOTS * sizeof(asyn_task_t*));
+
+        ret = asyn_loop_init(&worker->loop, budget);
+        if(ret != ASYN_DONE) {
+            mem_free(worker->tasks);
+            goto failed;
+        }
+        ret = asyn_queue_init(&worker->queue, &worker->loop);
+        if(ret != ASYN_DONE) {
+            asyn_loop_free(&worker->loop);
+            mem_free(worker->tasks);
+            goto failed;
+        }
+    }
+
+    group->count = count;
+    return ASYN_DONE;
+
+    failed:
+    while(i--) {
+        asyn_queue_free(&group->workers[i].queue);
+        asyn_loop_free(&group->workers[i].loop);
+        mem_free(group->workers[i].tasks);
+    }
+    mem_free(group->workers);
+    group->workers = NULL;
+    return ret;
+}
+
+
+unsigned int asyn_loopgroup_start(asyn_loopgroup_t *group, asyn_worker_setup_t setup, void *arg) {
+    sundry_thread_t *threads;
+    unsigned int i;
+
+    SUNDRY_ASSERT(group != NULL);
+    SUNDRY_MASSERT(group->threads == NULL, "asyn_loopgroup_start(): Group is already running.");
+
+    group->setup = setup;
+    group->arg = arg;
+    group->stop = 0;
+    threads = mem_zmalloc(group->count * sizeof(sundry_thread_t));
+    group->threads = threads;
+
+    for(i = 0; i < group->count; ++i) {
+        if(!sundry_thread_run(&threads[i], asyn_loopgroup_main, &group->workers[i])) {
+            asyn_loopgroup_stop(group);
+            while(i--) sundry_thread_join(&threads[i]);
+            mem_free(threads);
+            group->threads = NULL;
+            group->running = 0;
+            return ASYN_TOOMANY;
+        }
+        ++group->running;
+    }
+
+    return ASYN_DONE;
+}
+
+
+void asyn_loopgroup_free(asyn_loopgroup_t *group) {
+    sundry_thread_t *threads;
+    unsigned int i;
+
+    SUNDRY_ASSERT(group != NULL);
+
+    threads = group->threads;
+    if(threads) {
+        asyn_loopgroup_stop(group);
+        for(i = 0; i < group->running; ++i) sundry_thread_join(&threads[i]);
+        mem_free(threads);
+        group->threads = NULL;
+        group->running = 0;
+    }
+
+    for(i = 0; i < group->count; ++i) {
+        asyn_queue_free(&group->workers[i].queue);
+        asyn_loop_free(&group->workers[i].loop);
+        mem_free(group->workers[i].tasks);
+    }
+    mem_free(group->workers);
+    group->workers = NULL;
+    group->count = 0;
+}
+
+
+void asyn_task_push(asyn_worker_t *worker, asyn_task_t *task) {
+    asyn_loopgroup_t *group;
+    asyn_worker_t *sleeper;
+    long top, bottom;
+    unsigned int i;
+
+    SUNDRY_ASSERT(worker != NULL);
+    SUNDRY_ASSERT(task != NULL);
+    SUNDRY_MASSERT(task->fn != NULL, "asyn_task_push(): Task without callback.");
+
+    group = worker->group;
+    bottom = worker->bottom;
+    top = sundry_atomic_load(&worker->top);
+    if(bottom - top >= ASYN_TASK_SLOTS) {
+        ++worker->executed;
+        task->fn(worker, task);
+        return;
+    }
+
+    sundry_atomic_storeptr(&worker->tasks[bottom & ASYN_TASK_MASK], task);
+    sundry_atomic_store(&worker->bottom, bottom + 1);
+    sundry_atomic_fence();
+
+    /* Wake up a single sleeping worker so it can steal the task. */
+    if(sundry_atomic_load(&group->sleepers) <= 0) return;
+    for(i = 1; i < group->count; ++i) {
+        sleeper = &group->workers[(worker->index + i) % group->count];
+        if(sundry_atomic_load(&sleeper->sleeping) && sundry_atomic_cas(&sleeper->sleeping, 1, 0)) {
+            sundry_atomic_sub(&group->sleepers, 1);
+            asyn_os_wake_signal(sleeper->queue.ev.fd);
+            return;
+        }
+    }
+}
@@ -0,0 +1,188 @@
+/*
+ * (COPYRIGHT) Copyright (C) 2008, 2009, The ONS Team.
+ * This file is part of ONS, see COPYING for details.
+ */
+
+/*
+ * File information:
+ * - Created: 17. October 2026
+ * - Lead-Dev: - David Herrmann
+ * - Contributors: /
+ * - Last-Change: 17. October 2026
+ */
+
+/* Multicast demultiplexer
+ * Routes the datagrams of a single socket to per-group handlers. The groups
+ * are kept in a chained hash table keyed by the group address. Source-specific
+ * entries of a group and its entries on other interfaces share its bucket, so a
+ * lookup scans a single chain.
+ */
+
+
+#include "config/machine.h"
+#include "sundry/sundry.h"
+#include "asynchio/asynchio.h"
+#include "memoria/memoria.h"
+#include "backend.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+#define ASYN_MCAST_IPLEN(addr) (((addr)->type == ASYN_IPV4)?ASYN_V4SIZE:ASYN_V6SIZE)
+
+
+/* Compares the IP part of two addresses. */
+static unsigned int asyn_mcast_same(const asyn_addr_t *a, const asyn_addr_t *b) {
+    if(a->type != b->type) return 0;
+    if(a->type == ASYN_NOADDR) return 1;
+    return memcmp(a->ip, b->ip, ASYN_MCAST_IPLEN(a)) == 0;
+}
+
+
+static asyn_mgroup_t **asyn_mcast_bucket(asyn_mcast_t *mcast, const asyn_addr_t *addr) {
+    return &mcast->buckets[mem_hash((const char*)addr->ip, ASYN_MCAST_IPLEN(addr)) & mcast->mask];
+}
+
+
+/* Finds the group of a datagram to \dst from \src which arrived on the interface
+ * \ifindex. A group address is either joined for any source or for single sources
+ * per interface (see \asyn_mcast_add), so the first match on \ifindex is the only
+ * one. Groups which let the kernel choose the interface (\ifindex 0) only match if
+ * no group of the interface does.
+ */
+static asyn_mgroup_t *asyn_mcast_find(asyn_mcast_t *mcast, const asyn_addr_t *dst, const asyn_addr_t *src, unsigned int ifindex) {
+    asyn_mgroup_t *iter, *any = NULL;
+
+    for(iter = *asyn_mcast_bucket(mcast, dst); iter; iter = iter->next) {
+        if(!asyn_mcast_same(&iter->addr, dst)) continue;
+        if(iter->source.type != ASYN_NOADDR && !asyn_mcast_same(&iter->source, src)) continue;
+        if(iter->ifindex == ifindex) return iter;
+        if(iter->ifindex == 0 && !any) any = iter;
+    }
+    return any;
+}
+
+
+unsigned int asyn_mcast_init(asyn_mcast_t *mcast, asyn_udp_t *udp, unsigned int buckets) {
+    unsigned int ret, size;
+
+    SUNDRY_ASSERT(mcast != NULL);
+    SUNDRY_ASSERT(udp != NULL);
+
+    memset(mcast, 0, sizeof(*mcast));
+    ret = asyn_udp_ctl(udp, udp->opts | ASYN_UDP_PKTINFO);
+    if(ret != ASYN_DONE) return ret;
+
+    if(buckets == 0) buckets = ASYN_MCAST_BUCKETS;
+    for(size = 1; size < buckets; size <<= 1) /* empty */ ;
+
+    mcast->udp = udp;
+    mcast->mask = size - 1;
+    mcast->buckets = mem_zmalloc(size * sizeof(asyn_mgroup_t*));
+    return ASYN_DONE;
+}
+
+
+void asyn_mcast_free(asyn_mcast_t *mcast) {
+    asyn_mgroup_t *iter;
+    unsigned int i;
+
+    SUNDRY_ASSERT(mcast != NULL);
+
+    for(i = 0; i <= mcast->mask; ++i) {
+        for(iter = mcast->buckets[i]; iter; iter = iter->next) {
+            asyn_udp_leave(mcast->udp, &iter->addr, (iter->source.type == ASYN_NOADDR)?NULL:&iter->source, iter->ifindex);
+        }
+    }
+    mem_free(mcast->buckets);
+    mcast->buckets = NULL;
+    mcast->count = 0;
+}
+
+
+unsigned int asyn_mcast_add(asyn_mcast_t *mcast, asyn_mgroup_t *group) {
+    asyn_mgroup_t **bucket, *iter;
+    unsigned int ret;
+
+    SUNDRY_ASSERT(mcast != NULL);
+    SUNDRY_ASSERT(group != NULL);
+    SUNDRY_MASSERT(group->fn != NULL, "asyn_mcast_add(): Group without handler.");
+
+    /* The kernel keeps one membership per group and interface which is either
+     * any-source or a source list, so we refuse to mix them before it does. The
+     * error it would return differs between versions.
+     */
+    bucket = asyn_mcast_bucket(mcast, &group->addr);
+    for(iter = *bucket; iter; iter = iter->next) {
+        if(!asyn_mcast_same(&iter->addr, &group->addr) || iter->ifindex != group->ifindex) continue;
+        if((iter->source.type == ASYN_NOADDR) != (group->source.type == ASYN_NOADDR)) return ASYN_INUSE;
+    }
+
+    ret = asyn_udp_join(mcast->udp, &group->addr, (group->source.type == ASYN_NOADDR)?NULL:&group->source, group->ifindex);
+    if(ret != ASYN_DONE) return ret;
+
+    group->next = *bucket;
+    *bucket = group;
+    ++mcast->count;
+    return ASYN_DONE;
+}
+
+
+void asyn_mcast_del(asyn_mcast_t *mcast, asyn_mgroup_t *group) {
+    asyn_mgroup_t **iter;
+
+    SUNDRY_ASSERT(mcast != NULL);
+    SUNDRY_ASSERT(group != NULL);
+
+    for(iter = asyn_mcast_bucket(mcast, &group->addr); *iter; iter = &(*iter)->next) {
+        if(*iter != group) continue;
+        *iter = group->next;
+        group->next = NULL;
+        --mcast->count;
+        asyn_udp_leave(mcast->udp, &group->addr, (group->source.type == ASYN_NOADDR)?NULL:&group->source, group->ifindex);
+        return;
+    }
+}
+
+
+void asyn_mcast_dispatch(asyn_mcast_t *mcast, asyn_msg_t *msgs, unsigned int count) {
+    asyn_mgroup_t *group;
+    unsigned int i;
+
+    SUNDRY_ASSERT(mcast != NULL);
+    SUNDRY_ASSERT(msgs != NULL || count == 0);
+
+    for(i = 0; i < count; ++i) {
+        group = NULL;
+        if(msgs[i].flags & ASYN_MSG_PKTINFO) group = asyn_mcast_find(mcast, &msgs[i].dst, &msgs[i].addr, msgs[i].ifindex);
+
+        /* The handler may delete and free the group, so we count first. */
+        if(group) {
+            ++group->pkts;
+            group->fn(mcast, group, &msgs[i]);
+        }
+        else {
+            ++mcast->unknown;
+            if(mcast->fallback) mcast->fallback(mcast, NULL, &msgs[i]);
+        }
+    }
+}
+
+
+unsigned int asyn_mcast_recv(asyn_mcast_t *mcast, asyn_msg_t *msgs, unsigned int count) {
+    size_t sizes[ASYN_OS_MMSG];
+    unsigned int ret, done, i;
+
+    SUNDRY_ASSERT(mcast != NULL);
+    SUNDRY_ASSERT(msgs != NULL);
+
+    if(count > ASYN_OS_MMSG) count = ASYN_OS_MMSG;
+    for(i = 0; i < count; ++i) sizes[i] = msgs[i].size;
+
+    ret = asyn_udp_recv_batch(mcast->udp, msgs, count, &done);
+    if(ret == ASYN_DONE) asyn_mcast_dispatch(mcast, msgs, done);
+
+    for(i = 0; i < count; ++i) msgs[i].size = sizes[i];
+    return ret;
+}
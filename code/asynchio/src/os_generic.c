@@ -8,7 +8,7 @@
  * - Created: 26. May 2009
  * - Lead-Dev: - David Herrmann
  * - Contributors: /
- * - Last-Change: 30. May 2009
+ * - Last-Change: 17. October 2026
  */
 
 /* OS dependant code
@@ -19,6 +19,7 @@
 
 #include "config/machine.h"
 #include "sundry/sundry.h"
+#include "sundry/time.h"
 #include "asynchio/asynchio.h"
 #include "backend.h"
 #include "memoria/memoria.h"
@@ -27,6 +28,7 @@
 #include <string.h>
 #include <errno.h>
 #include <limits.h>
+#include <time.h>
 
 #ifdef ONS_SOCKET_WIN_HEADERS
     #include <windows.h>
@@ -37,7 +39,9 @@
     #include <sys/types.h>
     #include <sys/socket.h>
     #include <sys/un.h>
+    #include <sys/uio.h>
     #include <netinet/in.h>
+    #include <netinet/tcp.h>
 #endif
 #ifdef ONS_SOCKET_IOCTL
     #include <sys/ioctl.h>
@@ -45,6 +49,34 @@
 #ifdef ONS_SOCKET_FCNTL
     #include <fcntl.h>
 #endif
+#ifdef ONS_POLL_EPOLL
+    #include <sys/epoll.h>
+#endif
+#ifdef ONS_POLL_EVENTFD
+    #include <stdint.h>
+    #include <sys/eventfd.h>
+#endif
+#ifdef ONS_SOCKET_ZEROCOPY
+    #include <linux/errqueue.h>
+#endif
+#ifdef ONS_SOCKET_SENDFILE
+    #include <sys/sendfile.h>
+#endif
+#ifdef ONS_SOCKET_SPLICE
+    #include <fcntl.h>
+#endif
+#ifdef ONS_SOCKET_UDPSEG
+    #include <stdint.h>
+    #include <netinet/udp.h>
+#endif
+#ifdef ONS_SOCKET_MEMINFO
+    #include <stdint.h>
+    #include <linux/sock_diag.h>
+#endif
+#ifdef ONS_CORO_GUARD
+    #include <unistd.h>
+    #include <sys/mman.h>
+#endif
 
 #ifndef O_NONBLOCK
     #ifdef O_NDELAY
@@ -90,6 +122,15 @@
     #endif
 #endif
 
+#if defined(MAP_STACK)
+    #define ASYN_OS_MAP_STACK MAP_STACK
+#else
+    #define ASYN_OS_MAP_STACK 0
+#endif
+#if defined(MAP_ANON) && !defined(MAP_ANONYMOUS)
+    #define MAP_ANONYMOUS MAP_ANON
+#endif
+
 
 /* This defines to a "case EAGAIN" line and if EWOULDBLOCK
  * is also defined with another value it is also catched with this line.
@@ -122,79 +163,274 @@
 #endif
 
 
-#if 0
-/* Converts a raw address into the classic BSD socket structures and vice versa.
- * The result of the first function has later to be freed.
+#ifdef ONS_SOCKET_BERKELEY_HEADERS
+/* Converts the path of a local socket into a BSD socket address. Returns the length
+ * of the address or 0 if \path does not fit.
  */
-#define asyn_os_bsa_freesaddr(addr) mem_free(addr)
-static struct sockaddr *asyn_os_bsa_mksaddr(unsigned int atype, const asyn_addr_t *addr) {
-    struct sockaddr *saddr;
+static socklen_t asyn_os_mkuxaddr(struct sockaddr_un *saddr, const char *path) {
+    size_t len;
+
+    len = strlen(path);
+    if(len == 0 || len >= sizeof(saddr->sun_path)) return 0;
 
-    if(atype == ASYN_OS_UXADDR) {
-        saddr = mem_zmalloc(sizeof(struct sockaddr_un));
+    memset(saddr, 0, sizeof(*saddr));
 #ifdef ONS_SOCKET_ALEN
-        ((struct sockaddr_un*)saddr)->sun_len = sizeof(struct sockaddr_un);
+    saddr->sun_len = sizeof(*saddr);
 #endif
-        ((struct sockaddr_un*)saddr)->sun_family = AF_UNIX;
-        memcpy(((struct sockaddr_un*)saddr)->sun_path,
-                addr->addr.ux.path,
-                MEM_MIN(sizeof(addr->addr.ux.path), sizeof(((struct sockaddr_un*)saddr)->sun_path)));
-        ((struct sockaddr_un*)saddr)->sun_path[sizeof(((struct sockaddr_un*)saddr)->sun_path) - 1] = 0;
-    }
-    else if(atype == ASYN_OS_V4ADDR) {
-        saddr = mem_zmalloc(sizeof(struct sockaddr_in));
+    saddr->sun_family = AF_UNIX;
+    memcpy(saddr->sun_path, path, len + 1);
+    return offsetof(struct sockaddr_un, sun_path) + len + 1;
+}
+#endif
+
+
+/* Address conversion, see backend.h. */
+socklen_t asyn_os_mksaddr(struct sockaddr_storage *saddr, unsigned int type, const void *ip, unsigned int port) {
+    memset(saddr, 0, sizeof(*saddr));
+    if(type == ASYN_IPV4) {
 #ifdef ONS_SOCKET_ALEN
         ((struct sockaddr_in*)saddr)->sin_len = sizeof(struct sockaddr_in);
 #endif
         ((struct sockaddr_in*)saddr)->sin_family = AF_INET;
-        ((struct sockaddr_in*)saddr)->sin_port = addr->addr.v4.port;
-        ((struct sockaddr_in*)saddr)->sin_addr.s_addr = addr->addr.v4.ip;
+        ((struct sockaddr_in*)saddr)->sin_port = htons(port);
+        if(ip) memcpy(&((struct sockaddr_in*)saddr)->sin_addr.s_addr, ip, ASYN_V4SIZE);
+        else ((struct sockaddr_in*)saddr)->sin_addr.s_addr = htonl(INADDR_ANY);
+        return sizeof(struct sockaddr_in);
     }
-    else if(atype == ASYN_OS_V6ADDR) {
-        saddr = mem_zmalloc(sizeof(struct sockaddr_in6));
+    else {
 #ifdef ONS_SOCKET_ALEN
         ((struct sockaddr_in6*)saddr)->sin6_len = sizeof(struct sockaddr_in6);
 #endif
         /* flowinfo and scope_id are not set by us. */
         ((struct sockaddr_in6*)saddr)->sin6_family = AF_INET6;
-        ((struct sockaddr_in6*)saddr)->sin6_port = addr->addr.v6.port;
-        memcpy(((struct sockaddr_in6*)saddr)->sin6_addr.s6_addr,
-               addr->addr.v6.ip,
-               MEM_MIN(sizeof(((struct sockaddr_in6*)saddr)->sin6_addr.s6_addr), sizeof(addr->addr.v6.ip)));
-    }
-    else return NULL;
-    return saddr;
-}
-static void asyn_os_bsa_readsaddr(struct sockaddr *saddr, size_t size, unsigned int *atype, asyn_addr_t *addr) {
-    if(size == sizeof(struct sockaddr_un)) {
-        *atype = ASYN_OS_UXADDR;
-        memcpy(addr->addr.ux.path,
-               ((struct sockaddr_un*)saddr)->sun_path,
-               MEM_MIN(sizeof(addr->addr.ux.path), sizeof(((struct sockaddr_un*)saddr)->sun_path)));
-        addr->addr.ux.path[sizeof(addr->addr.ux.path) - 1] = 0;
-    }
-    else if(size == sizeof(struct sockaddr_in)) {
-        *atype = ASYN_OS_V4ADDR;
-        addr->addr.v4.port = ((struct sockaddr_in*)saddr)->sin_port;
-        addr->addr.v4.ip = ((struct sockaddr_in*)saddr)->sin_addr.s_addr;
-    }
-    else if(size == sizeof(struct sockaddr_in6)) {
-        *atype = ASYN_OS_V6ADDR;
-        addr->addr.v6.port = ((struct sockaddr_in6*)saddr)->sin6_port;
-        memcpy(addr->addr.v6.ip,
-               ((struct sockaddr_in6*)saddr)->sin6_addr.s6_addr,
-               MEM_MIN(sizeof(((struct sockaddr_in6*)saddr)->sin6_addr.s6_addr), sizeof(addr->addr.v6.ip)));
+        ((struct sockaddr_in6*)saddr)->sin6_port = htons(port);
+        if(ip) memcpy(((struct sockaddr_in6*)saddr)->sin6_addr.s6_addr, ip, ASYN_V6SIZE);
+        else ((struct sockaddr_in6*)saddr)->sin6_addr = in6addr_any;
+        return sizeof(struct sockaddr_in6);
     }
-    else {
-        *atype = -1;
-        memset(addr, 0, sizeof(asyn_addr_t));
+}
+void asyn_os_readsaddr(const struct sockaddr_storage *saddr, socklen_t size, asyn_addr_t *addr) {
+    if(saddr->ss_family == AF_INET && size >= sizeof(struct sockaddr_in)) {
+        addr->type = ASYN_IPV4;
+        addr->port = ntohs(((const struct sockaddr_in*)saddr)->sin_port);
+        memcpy(addr->ip, &((const struct sockaddr_in*)saddr)->sin_addr.s_addr, ASYN_V4SIZE);
+    }
+    else if(saddr->ss_family == AF_INET6 && size >= sizeof(struct sockaddr_in6)) {
+        addr->type = ASYN_IPV6;
+        addr->port = ntohs(((const struct sockaddr_in6*)saddr)->sin6_port);
+        memcpy(addr->ip, ((const struct sockaddr_in6*)saddr)->sin6_addr.s6_addr, ASYN_V6SIZE);
+    }
+    else memset(addr, 0, sizeof(*addr));
+}
+
+
+/* Error translation of send/recv calls, see backend.h. */
+unsigned int asyn_os_ioerr(const char *call) {
+#ifdef ONS_SOCKET_WIN_HEADERS
+    switch(WSAGetLastError()) {
+        case WSAEWOULDBLOCK:
+            return ASYN_BLOCKED;
+        case WSANOTINITIALISED:
+            return ASYN_NOTINIT;
+        case WSAENOBUFS:
+            return ASYN_MEMFAIL;
+        case WSAEACCES:
+            return ASYN_DENIED;
+        case WSAECONNRESET:
+        case WSAECONNABORTED:
+        case WSAETIMEDOUT:
+        case WSAENOTCONN:
+        case WSAENETRESET:
+        case WSAEMSGSIZE:
+        case WSAEHOSTUNREACH:
+        case WSAENETUNREACH:
+            return ASYN_FAILED;
+        case WSAENOTSOCK:
+        case WSAEINVAL:
+        case WSAEFAULT:
+        case WSAEOPNOTSUPP:
+        case WSAEAFNOSUPPORT:
+        case WSAEDESTADDRREQ:
+            return ASYN_NOTSUPP;
+        default:
+            SUNDRY_DEBUG("%s: Invalid ecode: %d", call, WSAGetLastError());
+            return ASYN_SYSCALL;
+    }
+#else
+    switch(errno) {
+        case ASYN_OS_EAGAIN:
+            return ASYN_BLOCKED;
+        case ENOBUFS:
+        case ENOMEM:
+            return ASYN_MEMFAIL;
+        case EPERM:
+        case EACCES:
+            return ASYN_DENIED;
+        case ECONNREFUSED:
+        case EHOSTUNREACH:
+        case EHOSTDOWN:
+        case ENETUNREACH:
+        case ENETDOWN:
+        case EMSGSIZE:
+            /* These errors affect only a single datagram (mostly they are delayed ICMP
+             * errors of a previous datagram). The socket is still usable.
+             */
+            return ASYN_FAILED;
+        case ECONNRESET:
+        case ECONNABORTED:
+        case ETIMEDOUT:
+        case EPIPE:
+        case ENOTCONN:
+            /* The connection of a stream socket broke. */
+            return ASYN_FAILED;
+        case EBADF:
+        case ENOTSOCK:
+        case EINVAL:
+        case EFAULT:
+        case EOPNOTSUPP:
+        case EAFNOSUPPORT:
+        case EDESTADDRREQ:
+            return ASYN_NOTSUPP;
+        default:
+            SUNDRY_DEBUG("%s: Invalid ecode: %d", call, errno);
+            return ASYN_SYSCALL;
+    }
+#endif
+}
+
+
+#ifndef ONS_SOCKET_WIN_HEADERS
+/* Control messages, see backend.h. */
+void asyn_os_cmsg_read(struct msghdr *hdr, asyn_msg_t *msg) {
+    struct cmsghdr *cmsg;
+#ifdef ONS_SOCKET_UDPSEG
+    signed int seg;
+#endif
+#ifdef ONS_SOCKET_RXQOVFL
+    uint32_t ovfl;
+#endif
+#ifdef ONS_SOCKET_TIMESTAMP
+    struct timespec ts;
+#endif
+#ifdef ONS_SOCKET_PKTINFO
+    struct in_pktinfo pi4;
+    struct in6_pktinfo pi6;
+#endif
+
+    /* Without GRO every buffer contains exactly one datagram. */
+    msg->segsize = msg->size;
+    msg->drops = 0;
+    msg->stamp = 0;
+    msg->flags &= ~ASYN_MSG_PKTINFO;
+    msg->dst.type = ASYN_NOADDR;
+    msg->ifindex = 0;
+    if(hdr->msg_controllen == 0) return;
+
+    for(cmsg = CMSG_FIRSTHDR(hdr); cmsg; cmsg = CMSG_NXTHDR(hdr, cmsg)) {
+#ifdef ONS_SOCKET_UDPSEG
+        if(cmsg->cmsg_level == IPPROTO_UDP && cmsg->cmsg_type == UDP_GRO) {
+            memcpy(&seg, CMSG_DATA(cmsg), sizeof(seg));
+            if(seg > 0) msg->segsize = seg;
+        }
+#endif
+#ifdef ONS_SOCKET_RXQOVFL
+        if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+            memcpy(&ovfl, CMSG_DATA(cmsg), sizeof(ovfl));
+            msg->drops = ovfl;
+        }
+#endif
+#ifdef ONS_SOCKET_TIMESTAMP
+        if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            msg->stamp = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+        }
+#endif
+#ifdef ONS_SOCKET_PKTINFO
+        if(cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_PKTINFO) {
+            memcpy(&pi4, CMSG_DATA(cmsg), sizeof(pi4));
+            msg->flags |= ASYN_MSG_PKTINFO;
+            msg->dst.type = ASYN_IPV4;
+            msg->dst.port = 0;
+            memcpy(msg->dst.ip, &pi4.ipi_addr, ASYN_V4SIZE);
+            msg->ifindex = pi4.ipi_ifindex;
+        }
+        if(cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_PKTINFO) {
+            memcpy(&pi6, CMSG_DATA(cmsg), sizeof(pi6));
+            msg->flags |= ASYN_MSG_PKTINFO;
+            msg->dst.type = ASYN_IPV6;
+            msg->dst.port = 0;
+            memcpy(msg->dst.ip, &pi6.ipi6_addr, ASYN_V6SIZE);
+            msg->ifindex = pi6.ipi6_ifindex;
+        }
+#endif
     }
 }
-static size_t asyn_os_bsa_asize(unsigned int atype) {
-    if(atype == ASYN_OS_V4ADDR) return sizeof(struct sockaddr_in);
-    else if(atype == ASYN_OS_V6ADDR) return sizeof(struct sockaddr_in6);
-    else if(atype == ASYN_OS_UXADDR) return sizeof(struct sockaddr_un);
-    else return 0;
+unsigned int asyn_os_cmsg_write(struct msghdr *hdr, asyn_os_cbuf_t *cbuf, const asyn_msg_t *msg) {
+    struct cmsghdr *cmsg;
+    size_t len = 0;
+#ifdef ONS_SOCKET_UDPSEG
+    uint16_t seg;
+#endif
+#ifdef ONS_SOCKET_PKTINFO
+    struct in_pktinfo pi4;
+    struct in6_pktinfo pi6;
+#endif
+
+    hdr->msg_control = cbuf->buf;
+    hdr->msg_controllen = sizeof(cbuf->buf);
+    memset(cbuf, 0, sizeof(*cbuf));
+    cmsg = CMSG_FIRSTHDR(hdr);
+
+    /* A segment size of 0 or bigger than the payload describes a single datagram. */
+    if(msg->segsize > 0 && msg->segsize < msg->size) {
+#ifdef ONS_SOCKET_UDPSEG
+        if(msg->segsize > UINT16_MAX) return ASYN_NOTSUPP;
+        seg = msg->segsize;
+        cmsg->cmsg_level = IPPROTO_UDP;
+        cmsg->cmsg_type = UDP_SEGMENT;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(seg));
+        memcpy(CMSG_DATA(cmsg), &seg, sizeof(seg));
+        len += CMSG_SPACE(sizeof(seg));
+#else
+        return ASYN_NOTSUPP;
+#endif
+    }
+
+    /* The source address and interface of a reply, normally taken over from the
+     * request. The kernel picks the source if the address is the ANY address.
+     */
+    if(msg->flags & ASYN_MSG_PKTINFO) {
+#ifdef ONS_SOCKET_PKTINFO
+        if(len > 0) cmsg = CMSG_NXTHDR(hdr, cmsg);
+        if(msg->dst.type == ASYN_IPV4) {
+            memset(&pi4, 0, sizeof(pi4));
+            memcpy(&pi4.ipi_spec_dst, msg->dst.ip, ASYN_V4SIZE);
+            pi4.ipi_ifindex = msg->ifindex;
+            cmsg->cmsg_level = IPPROTO_IP;
+            cmsg->cmsg_type = IP_PKTINFO;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(pi4));
+            memcpy(CMSG_DATA(cmsg), &pi4, sizeof(pi4));
+            len += CMSG_SPACE(sizeof(pi4));
+        }
+        else if(msg->dst.type == ASYN_IPV6) {
+            memset(&pi6, 0, sizeof(pi6));
+            memcpy(&pi6.ipi6_addr, msg->dst.ip, ASYN_V6SIZE);
+            pi6.ipi6_ifindex = msg->ifindex;
+            cmsg->cmsg_level = IPPROTO_IPV6;
+            cmsg->cmsg_type = IPV6_PKTINFO;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(pi6));
+            memcpy(CMSG_DATA(cmsg), &pi6, sizeof(pi6));
+            len += CMSG_SPACE(sizeof(pi6));
+        }
+#else
+        return ASYN_NOTSUPP;
+#endif
+    }
+
+    (void)cmsg;
+    hdr->msg_controllen = len;
+    if(len == 0) hdr->msg_control = NULL;
+    return ASYN_DONE;
 }
 #endif
 
@@ -230,12 +466,12 @@ unsigned int asyn_os_socket(signed int *fd, unsigned int type, unsigned int doma
     /* Execute syscall. */
 #ifdef ONS_SOCKET_WIN_HEADERS
     ASYN_OS_SYSCALL(((*fd = socket(dom, trans, proto)) != INVALID_SOCKET));
-    if(fd == INVALID_SOCKET) {
+    if(*fd == INVALID_SOCKET) {
         switch(WSAGetLastError()) {
             case WSANOTINITIALISED:
                 return ASYN_NOTINIT;
             case WSANETDOWN:
-                return ASYN_SYSCALL:
+                return ASYN_SYSCALL;
             case WSAEAFNOSUPPORT:
             case WSAESOCKTNOSUPPORT:
             case WSAEPROTOTYPE:
@@ -252,7 +488,7 @@ unsigned int asyn_os_socket(signed int *fd, unsigned int type, unsigned int doma
     }
 #else
     ASYN_OS_SYSCALL(((*fd = socket(dom, trans, proto)) >= 0));
-    if(fd < 0) {
+    if(*fd < 0) {
         switch(errno) {
             case EAFNOSUPPORT:
             case EPFNOSUPPORT:
@@ -286,17 +522,19 @@ unsigned int asyn_os_socket(signed int *fd, unsigned int type, unsigned int doma
 #ifdef ONS_SOCKET_EXTSOCK
     /* Do nothing; it was already set before. */
 #elif defined(ONS_SOCKET_FCNTL)
-    set = fcntl(*fd, F_GETFL, 0);
-    if(set == -1) {
-        SUNDRY_DEBUG("fcntl(F_GETFL): Failed directly after socket(): %d", errno);
-        close(*fd);
-        return ASYN_SYSCALL;
-    }
-    set |= FD_CLOEXEC;
-    if(fcntl(*fd, F_SETFL, set) != 0) {
-        SUNDRY_DEBUG("fcntl(F_SETFL | FD_CLOEXEC): Failed directly after socket(): %d", errno);
-        close(*fd);
-        return ASYN_SYSCALL;
+    if(noinherit) {
+        set = fcntl(*fd, F_GETFD, 0);
+        if(set == -1) {
+            SUNDRY_DEBUG("fcntl(F_GETFD): Failed directly after socket(): %d", errno);
+            close(*fd);
+            return ASYN_SYSCALL;
+        }
+        set |= FD_CLOEXEC;
+        if(fcntl(*fd, F_SETFD, set) != 0) {
+            SUNDRY_DEBUG("fcntl(F_SETFD | FD_CLOEXEC): Failed directly after socket(): %d", errno);
+            close(*fd);
+            return ASYN_SYSCALL;
+        }
     }
 #elif defined(ONS_SOCKET_IOCTL)
     if(noinherit && ioctl(*fd, FIOCLEX, NULL) == -1) {
@@ -313,12 +551,13 @@ unsigned int asyn_os_socket(signed int *fd, unsigned int type, unsigned int doma
     }
 #endif
 
-    /* Now disable the DualStack mode. */
+    /* Now disable the DualStack mode. This is only possible on IPv6 sockets. */
+    set = 1;
 #ifdef ONS_SOCKET_WIN_HEADERS
-    if(setsockopt(*fd, IPPROTO_IPV6, IPV6_V6ONLY, &set, sizeof(set)) == SOCKET_ERROR) {
+    if(domain == ASYN_IPV6 && setsockopt(*fd, IPPROTO_IPV6, IPV6_V6ONLY, (char*)&set, sizeof(set)) == SOCKET_ERROR) {
         SUNDRY_DEBUG("setsockopt(IPV6_V6ONLY): Invalid ecode: %d", WSAGetLastError());
 #else
-    if(setsockopt(*fd, IPPROTO_IPV6, IPV6_V6ONLY, &set, sizeof(set)) != 0) {
+    if(domain == ASYN_IPV6 && setsockopt(*fd, IPPROTO_IPV6, IPV6_V6ONLY, &set, sizeof(set)) != 0) {
         SUNDRY_DEBUG("setsockopt(IPV6_V6ONLY): Invalid ecode: %d", errno);
 #endif
         /* There is no suitable error. This should never happen. */
@@ -332,66 +571,2078 @@ unsigned int asyn_os_socket(signed int *fd, unsigned int type, unsigned int doma
 
 
 unsigned int asyn_os_setnblock(signed int fd, unsigned int set) {
-    unsigned int ret;
-
 #if defined(ONS_SOCKET_FCNTL)
-    signed int val = fcntl(fd, F_GETFL, 0);
+    signed int val;
+
+    val = fcntl(fd, F_GETFL, 0);
     if(val == -1) {
+        SUNDRY_DEBUG("fcntl(F_GETFL): Invalid ecode: %d", errno);
+        return ASYN_SYSCALL;
+    }
+    if(set) val |= O_NONBLOCK;
+    else val &= ~O_NONBLOCK;
+    if(fcntl(fd, F_SETFL, val) != 0) {
         switch(errno) {
             case EPERM:
             case EACCES:
             case ASYN_OS_EAGAIN:
                 /* Operation is prohibited by locks held by other processes. */
-                return ASYN_E_DENIED;
-            ASYN_OS_CASE(ENOTSOCK)
-            ASYN_OS_CASE(EBADF) /* FD is not an open file descriptor. */
-                return ASYN_E_BADFD;
-            ASYN_OS_CASE(EINVAL) /* Bad options. */
-                return ASYN_E_NOTSUPP;
+                return ASYN_DENIED;
+            case EINVAL:
+                return ASYN_NOTSUPP;
             default:
-                SUNDRY_DEBUG("fcntl(F_SETFL): Invalid ecode: %d", ASYN_OS_GETERR());
-                return ASYN_E_SYSCALL;
+                SUNDRY_DEBUG("fcntl(F_SETFL): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
         }
     }
-    set |= FD_CLOEXEC;
-    if(fcntl(*fd, F_SETFL, set) != 0) {
-        SUNDRY_DEBUG("fcntl(F_SETFL | FD_CLOEXEC): Failed directly after socket(): %d", errno);
-        close(*fd);
-        return ASYN_SYSCALL;
-    }
+    return ASYN_DONE;
 #elif defined(ONS_SOCKET_IOCTL)
     signed int val;
+
     val = !!set;
     if(ioctl(fd, FIONBIO, &val) == -1) {
-        switch(ASYN_OS_GETERR()) {
-            ASYN_OS_CASE(EBADF)
-            ASYN_OS_CASE(EINVAL)
-                return ASYN_E_NOTSUPP;
+        switch(errno) {
+            case EINVAL:
+                return ASYN_NOTSUPP;
             default:
-                SUNDRY_DEBUG("ioctl(FIONBIO): Invalid ecode: %d", ASYN_OS_GETERR());
-                return ASYN_E_SYSCALL;
+                SUNDRY_DEBUG("ioctl(FIONBIO): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
         }
     }
-    return ASYN_E_SUCCESS;
+    return ASYN_DONE;
 #elif defined(ONS_SOCKET_IOCTLSOCKET)
     unsigned long val;
+
     val = !!set;
     if(ioctlsocket(fd, FIONBIO, &val) != 0) {
-        switch(ASYN_OS_GETERR()) {
-            ASYN_OS_WCASE(WSANOTINITIALISED)
-                return ASYN_E_NOINIT;
-            ASYN_OS_WCASE(WSAENOTSOCK)
-                return ASYN_E_BADFD;
+        switch(WSAGetLastError()) {
+            case WSANOTINITIALISED:
+                return ASYN_NOTINIT;
             default:
-                SUNDRY_DEBUG("ioctl(FIONBIO): Invalid ecode: %d", ASYN_OS_GETERR());
-                return ASYN_E_SYSCALL;
+                SUNDRY_DEBUG("ioctlsocket(FIONBIO): Invalid ecode: %d", WSAGetLastError());
+                return ASYN_SYSCALL;
         }
     }
-    return ASYN_E_SUCCESS;
+    return ASYN_DONE;
+#else
+    #error "None of fcntl(), ioctl() or ioctlsocket() are available."
+#endif
+}
+
+
+unsigned int asyn_os_setgro(signed int fd, unsigned int set) {
+#ifdef ONS_SOCKET_UDPSEG
+    signed int val = set?1:0;
+
+    if(setsockopt(fd, IPPROTO_UDP, UDP_GRO, &val, sizeof(val)) != 0) {
+        switch(errno) {
+            case ENOPROTOOPT:
+                /* The kernel is older than 5.0. */
+            case EBADF:
+            case ENOTSOCK:
+            case EINVAL:
+                return ASYN_NOTSUPP;
+            case ENOMEM:
+            case ENOBUFS:
+                return ASYN_MEMFAIL;
+            default:
+                SUNDRY_DEBUG("setsockopt(UDP_GRO): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
+        }
+    }
+    return ASYN_DONE;
+#else
+    return set?ASYN_NOTSUPP:ASYN_DONE;
+#endif
+}
+
+
+unsigned int asyn_os_setovfl(signed int fd, unsigned int set) {
+#ifdef ONS_SOCKET_RXQOVFL
+    signed int val = set?1:0;
+
+    if(setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &val, sizeof(val)) != 0) {
+        switch(errno) {
+            case ENOPROTOOPT:
+            case EBADF:
+            case ENOTSOCK:
+            case EINVAL:
+                return ASYN_NOTSUPP;
+            case ENOMEM:
+            case ENOBUFS:
+                return ASYN_MEMFAIL;
+            default:
+                SUNDRY_DEBUG("setsockopt(SO_RXQ_OVFL): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
+        }
+    }
+    return ASYN_DONE;
+#else
+    return set?ASYN_NOTSUPP:ASYN_DONE;
+#endif
+}
+
+
+unsigned int asyn_os_setstamp(signed int fd, unsigned int set) {
+#ifdef ONS_SOCKET_TIMESTAMP
+    signed int val = set?1:0;
+
+    if(setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &val, sizeof(val)) != 0) {
+        switch(errno) {
+            case ENOPROTOOPT:
+            case EBADF:
+            case ENOTSOCK:
+            case EINVAL:
+                return ASYN_NOTSUPP;
+            case ENOMEM:
+            case ENOBUFS:
+                return ASYN_MEMFAIL;
+            default:
+                SUNDRY_DEBUG("setsockopt(SO_TIMESTAMPNS): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
+        }
+    }
+    return ASYN_DONE;
+#else
+    return set?ASYN_NOTSUPP:ASYN_DONE;
+#endif
+}
+
+
+unsigned int asyn_os_setpktinfo(signed int fd, unsigned int set) {
+#ifdef ONS_SOCKET_PKTINFO
+    signed int val = set?1:0;
+
+    /* IPv4 sockets do not know the IPv6 level, so we try that one first. */
+    if(setsockopt(fd, IPPROTO_IPV6, IPV6_RECVPKTINFO, &val, sizeof(val)) == 0) return ASYN_DONE;
+    if(errno == ENOPROTOOPT || errno == EOPNOTSUPP) {
+        if(setsockopt(fd, IPPROTO_IP, IP_PKTINFO, &val, sizeof(val)) == 0) return ASYN_DONE;
+    }
+
+    switch(errno) {
+        case ENOPROTOOPT:
+        case EOPNOTSUPP:
+        case EBADF:
+        case ENOTSOCK:
+        case EINVAL:
+            return ASYN_NOTSUPP;
+        case ENOMEM:
+        case ENOBUFS:
+            return ASYN_MEMFAIL;
+        default:
+            SUNDRY_DEBUG("setsockopt(IP_PKTINFO): Invalid ecode: %d", errno);
+            return ASYN_SYSCALL;
+    }
+#else
+    return set?ASYN_NOTSUPP:ASYN_DONE;
+#endif
+}
+
+
+uint64_t asyn_os_stamp(void) {
+#ifdef ONS_SOCKET_TIMESTAMP
+    struct timespec ts;
+
+    /* The kernel stamps datagrams with CLOCK_REALTIME. */
+    if(clock_gettime(CLOCK_REALTIME, &ts) != 0) {
+        SUNDRY_DEBUG("clock_gettime(): Invalid ecode: %d", errno);
+        return 0;
+    }
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+
+unsigned int asyn_os_setbusypoll(signed int fd, unsigned int usecs) {
+#ifdef ONS_SOCKET_BUSYPOLL
+    signed int val = usecs;
+
+    if(setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &val, sizeof(val)) != 0) {
+        switch(errno) {
+            case EPERM:
+            case EACCES:
+                /* Raising the value beyond net.core.busy_read needs CAP_NET_ADMIN. */
+                return ASYN_DENIED;
+            case ENOPROTOOPT:
+            case EBADF:
+            case ENOTSOCK:
+            case EINVAL:
+                return ASYN_NOTSUPP;
+            default:
+                SUNDRY_DEBUG("setsockopt(SO_BUSY_POLL): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
+        }
+    }
+
+    /* Only an optimization, older kernels do not know it. */
+    #ifdef SO_PREFER_BUSY_POLL
+        val = usecs?1:0;
+        setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &val, sizeof(val));
+    #endif
+    return ASYN_DONE;
+#else
+    return usecs?ASYN_NOTSUPP:ASYN_DONE;
+#endif
+}
+
+
+unsigned int asyn_os_setpacing(signed int fd, uint64_t rate) {
+#ifdef ONS_SOCKET_PACING
+    unsigned int val;
+
+    /* The 32bit variant is understood by every kernel, ~0 means unlimited. */
+    val = (rate == 0 || rate >= 0xffffffffUL)?~0U:(unsigned int)rate;
+    if(setsockopt(fd, SOL_SOCKET, SO_MAX_PACING_RATE, &val, sizeof(val)) != 0) {
+        switch(errno) {
+            case ENOPROTOOPT:
+            case EBADF:
+            case ENOTSOCK:
+            case EINVAL:
+                return ASYN_NOTSUPP;
+            default:
+                SUNDRY_DEBUG("setsockopt(SO_MAX_PACING_RATE): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
+        }
+    }
+    return ASYN_DONE;
+#else
+    return rate?ASYN_NOTSUPP:ASYN_DONE;
+#endif
+}
+
+
+unsigned int asyn_os_setbuf(signed int fd, unsigned int send, size_t size, unsigned int force) {
+    signed int val, opt;
+
+#ifdef ONS_SOCKET_MEMINFO
+    /* Linux doubles the value for its bookkeeping and reports the doubled value. */
+    size /= 2;
+    if(force) opt = send?SO_SNDBUFFORCE:SO_RCVBUFFORCE;
+    else opt = send?SO_SNDBUF:SO_RCVBUF;
+#else
+    if(force) return ASYN_DENIED;
+    opt = send?SO_SNDBUF:SO_RCVBUF;
 #endif
+
+    val = (size > INT_MAX)?INT_MAX:(signed int)size;
+    if(setsockopt(fd, SOL_SOCKET, opt, (const void*)&val, sizeof(val)) != 0) {
+        switch(errno) {
+            case EPERM:
+                return ASYN_DENIED;
+            case ENOPROTOOPT:
+            case EBADF:
+            case ENOTSOCK:
+            case EINVAL:
+                return ASYN_NOTSUPP;
+            case ENOMEM:
+            case ENOBUFS:
+                return ASYN_MEMFAIL;
+            default:
+                SUNDRY_DEBUG("setsockopt(SO_RCVBUF/SO_SNDBUF): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
+        }
+    }
+    return ASYN_DONE;
 }
 
 
+/* Reads the integer socket option \opt of \fd. */
+static unsigned int asyn_os_getbuf(signed int fd, signed int opt, size_t *size) {
+    signed int val = 0;
+    socklen_t len = sizeof(val);
+
+    if(getsockopt(fd, SOL_SOCKET, opt, (void*)&val, &len) != 0) {
+        switch(errno) {
+            case ENOPROTOOPT:
+            case EBADF:
+            case ENOTSOCK:
+                return ASYN_NOTSUPP;
+            default:
+                SUNDRY_DEBUG("getsockopt(SO_RCVBUF/SO_SNDBUF): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
+        }
+    }
+    *size = (val > 0)?val:0;
+    return ASYN_DONE;
+}
+
+
+unsigned int asyn_os_meminfo(signed int fd, size_t *rbuf, size_t *rused, size_t *sbuf, size_t *sused) {
+    unsigned int ret;
+#ifdef ONS_SOCKET_MEMINFO
+    uint32_t info[SK_MEMINFO_VARS];
+    socklen_t len = sizeof(info);
+
+    if(getsockopt(fd, SOL_SOCKET, SO_MEMINFO, info, &len) == 0 && len >= (SK_MEMINFO_SNDBUF + 1) * sizeof(uint32_t)) {
+        *rbuf = info[SK_MEMINFO_RCVBUF];
+        *rused = info[SK_MEMINFO_RMEM_ALLOC];
+        *sbuf = info[SK_MEMINFO_SNDBUF];
+        *sused = info[SK_MEMINFO_WMEM_ALLOC];
+        return ASYN_DONE;
+    }
+    /* Older kernels do not know SO_MEMINFO, so we fall back to the sizes only. */
+#endif
+
+    /* ASYN_NOTSUPP is reserved for valid sizes without fill level, so failures of
+     * the fallback are reported as ASYN_SYSCALL.
+     */
+    *rbuf = 0;
+    *rused = 0;
+    *sbuf = 0;
+    *sused = 0;
+    ret = asyn_os_getbuf(fd, SO_RCVBUF, rbuf);
+    if(ret == ASYN_DONE) ret = asyn_os_getbuf(fd, SO_SNDBUF, sbuf);
+    if(ret != ASYN_DONE) {
+        *rbuf = 0;
+        return ASYN_SYSCALL;
+    }
+    return ASYN_NOTSUPP;
+}
+
+
+uint64_t asyn_os_clock(void) {
+#ifdef CLOCK_MONOTONIC
+    struct timespec ts;
+
+    if(clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+        SUNDRY_DEBUG("clock_gettime(CLOCK_MONOTONIC): Invalid ecode: %d", errno);
+        return 0;
+    }
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+    sundry_time_t now;
+
+    sundry_time(&now);
+    return (uint64_t)now.secs * 1000000000 + (uint64_t)now.usecs * 1000;
+#endif
+}
+
+
+unsigned int asyn_os_setreuse(signed int fd) {
+#ifdef ONS_SOCKET_REUSEPORT
+    signed int val = 1;
+
+    if(setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &val, sizeof(val)) != 0) {
+        switch(errno) {
+            case ENOPROTOOPT:
+                /* The kernel is older than 3.9. */
+            case EBADF:
+            case ENOTSOCK:
+            case EINVAL:
+                return ASYN_NOTSUPP;
+            case ENOMEM:
+            case ENOBUFS:
+                return ASYN_MEMFAIL;
+            default:
+                SUNDRY_DEBUG("setsockopt(SO_REUSEPORT): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
+        }
+    }
+    return ASYN_DONE;
+#else
+    return ASYN_NOTSUPP;
+#endif
+}
+
+
+unsigned int asyn_os_bind(signed int fd, unsigned int type, const void *ip, unsigned int port) {
+    struct sockaddr_storage saddr;
+    socklen_t size;
+
+    size = asyn_os_mksaddr(&saddr, type, ip, port);
+#ifdef ONS_SOCKET_WIN_HEADERS
+    if(bind(fd, (struct sockaddr*)&saddr, size) == SOCKET_ERROR) {
+        switch(WSAGetLastError()) {
+            case WSANOTINITIALISED:
+                return ASYN_NOTINIT;
+            case WSAEACCES:
+                return ASYN_DENIED;
+            case WSAEADDRINUSE:
+                return ASYN_INUSE;
+            case WSAENOBUFS:
+                return ASYN_MEMFAIL;
+            case WSAEADDRNOTAVAIL:
+            case WSAEFAULT:
+            case WSAEINVAL:
+            case WSAENOTSOCK:
+                return ASYN_NOTSUPP;
+            default:
+                SUNDRY_DEBUG("bind(): Invalid ecode: %d", WSAGetLastError());
+                return ASYN_SYSCALL;
+        }
+    }
+#else
+    if(bind(fd, (struct sockaddr*)&saddr, size) != 0) {
+        switch(errno) {
+            case EPERM:
+            case EACCES:
+                /* The address is protected, and the user is not the superuser. */
+                return ASYN_DENIED;
+            case EADDRINUSE:
+                return ASYN_INUSE;
+            case ENOMEM:
+            case ENOBUFS:
+                return ASYN_MEMFAIL;
+            case EADDRNOTAVAIL:
+            case EBADF:
+            case ENOTSOCK:
+            case EINVAL:
+            case EFAULT:
+                /* Invalid address, invalid socket or socket is already bound. */
+                return ASYN_NOTSUPP;
+            default:
+                SUNDRY_DEBUG("bind(): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
+        }
+    }
+#endif
+    return ASYN_DONE;
+}
+
+
+void asyn_os_close(signed int fd) {
+    signed int ret;
+
+#ifdef ONS_SOCKET_WIN_HEADERS
+    ret = closesocket(fd);
+    if(ret == SOCKET_ERROR && WSAGetLastError() != WSAENOTSOCK) {
+        SUNDRY_DEBUG("closesocket(): Invalid ecode: %d", WSAGetLastError());
+    }
+#else
+    /* close() must not be restarted on EINTR. Linux always releases the
+     * descriptor and on other systems the state is unspecified.
+     * EBADF means that the descriptor is already closed.
+     */
+    ret = close(fd);
+    if(ret != 0 && errno != EINTR && errno != EBADF && errno != EIO) {
+        SUNDRY_DEBUG("close(): Invalid ecode: %d", errno);
+    }
+#endif
+}
+
+
+void asyn_os_shutdown(signed int fd) {
+#ifdef ONS_SOCKET_WIN_HEADERS
+    if(shutdown(fd, SD_BOTH) == SOCKET_ERROR && WSAGetLastError() != WSAENOTCONN) {
+        SUNDRY_DEBUG("shutdown(): Invalid ecode: %d", WSAGetLastError());
+    }
+#else
+    /* Unconnected datagram sockets report ENOTCONN but linux still shuts them
+     * down and wakes up all waiters.
+     */
+    if(shutdown(fd, SHUT_RDWR) != 0 && errno != ENOTCONN) {
+        SUNDRY_DEBUG("shutdown(): Invalid ecode: %d", errno);
+    }
+#endif
+}
+
+
+unsigned int asyn_os_sockname(signed int fd, asyn_addr_t *addr) {
+    struct sockaddr_storage saddr;
+#ifdef ONS_SOCKET_WIN_HEADERS
+    signed int size = sizeof(saddr);
+
+    if(getsockname(fd, (struct sockaddr*)&saddr, &size) == SOCKET_ERROR) {
+        switch(WSAGetLastError()) {
+            case WSANOTINITIALISED:
+                return ASYN_NOTINIT;
+            case WSAEINVAL:
+                /* Not bound, yet. */
+                return ASYN_NONE;
+            case WSAENOTSOCK:
+            case WSAEFAULT:
+                return ASYN_NOTSUPP;
+            default:
+                SUNDRY_DEBUG("getsockname(): Invalid ecode: %d", WSAGetLastError());
+                return ASYN_SYSCALL;
+        }
+    }
+#else
+    socklen_t size = sizeof(saddr);
+
+    if(getsockname(fd, (struct sockaddr*)&saddr, &size) != 0) {
+        switch(errno) {
+            case ENOBUFS:
+                return ASYN_MEMFAIL;
+            case EBADF:
+            case ENOTSOCK:
+            case EINVAL:
+            case EFAULT:
+                return ASYN_NOTSUPP;
+            default:
+                SUNDRY_DEBUG("getsockname(): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
+        }
+    }
+#endif
+    asyn_os_readsaddr(&saddr, size, addr);
+    return ASYN_DONE;
+}
+
+
+unsigned int asyn_os_recv(signed int fd, asyn_msg_t *msg, unsigned int nowait) {
+    struct sockaddr_storage saddr;
+    signed int res;
+#ifdef ONS_SOCKET_WIN_HEADERS
+    signed int size = sizeof(saddr);
+#else
+    struct msghdr hdr;
+    struct iovec iov;
+    asyn_os_cbuf_t cbuf;
+    socklen_t size;
+    signed int flags = 0;
+#endif
+
+    SUNDRY_ASSERT(msg != NULL);
+
+#ifdef ONS_SOCKET_WIN_HEADERS
+    /* Winsock sockets are switched into nonblocking mode, there is no per-call flag. */
+    ASYN_OS_SYSCALL(((res = recvfrom(fd, msg->buf, msg->size, 0, (struct sockaddr*)&saddr, &size)) != SOCKET_ERROR));
+    if(res == SOCKET_ERROR) return asyn_os_ioerr("recvfrom()");
+    msg->flags = 0;
+    msg->size = res;
+    msg->segsize = res;
+    msg->drops = 0;
+    msg->stamp = 0;
+    msg->dst.type = ASYN_NOADDR;
+    msg->ifindex = 0;
+#else
+    #ifdef MSG_DONTWAIT
+        if(nowait) flags |= MSG_DONTWAIT;
+    #endif
+    memset(&hdr, 0, sizeof(hdr));
+    iov.iov_base = msg->buf;
+    iov.iov_len = msg->size;
+    hdr.msg_name = &saddr;
+    hdr.msg_namelen = sizeof(saddr);
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = cbuf.buf;
+    hdr.msg_controllen = sizeof(cbuf.buf);
+    ASYN_OS_SYSCALL(((res = recvmsg(fd, &hdr, flags)) >= 0));
+    if(res < 0) return asyn_os_ioerr("recvmsg()");
+    msg->flags = (hdr.msg_flags & MSG_TRUNC)?ASYN_MSG_TRUNC:0;
+    msg->size = res;
+    asyn_os_cmsg_read(&hdr, msg);
+    size = hdr.msg_namelen;
+#endif
+
+    asyn_os_readsaddr(&saddr, size, &msg->addr);
+    return ASYN_DONE;
+}
+
+
+unsigned int asyn_os_recv_batch(signed int fd, asyn_msg_t *msgs, unsigned int count, unsigned int *done) {
+#ifdef ONS_SOCKET_MMSG
+    struct mmsghdr hdr[ASYN_OS_MMSG];
+    struct iovec iov[ASYN_OS_MMSG];
+    struct sockaddr_storage saddr[ASYN_OS_MMSG];
+    asyn_os_cbuf_t cbuf[ASYN_OS_MMSG];
+    signed int res;
+    unsigned int i;
+
+    SUNDRY_ASSERT(msgs != NULL);
+    SUNDRY_ASSERT(done != NULL);
+
+    *done = 0;
+    if(count > ASYN_OS_MMSG) count = ASYN_OS_MMSG;
+    if(count == 0) return ASYN_DONE;
+
+    memset(hdr, 0, count * sizeof(hdr[0]));
+    for(i = 0; i < count; ++i) {
+        iov[i].iov_base = msgs[i].buf;
+        iov[i].iov_len = msgs[i].size;
+        hdr[i].msg_hdr.msg_name = &saddr[i];
+        hdr[i].msg_hdr.msg_namelen = sizeof(saddr[i]);
+        hdr[i].msg_hdr.msg_iov = &iov[i];
+        hdr[i].msg_hdr.msg_iovlen = 1;
+        hdr[i].msg_hdr.msg_control = cbuf[i].buf;
+        hdr[i].msg_hdr.msg_controllen = sizeof(cbuf[i].buf);
+    }
+
+    /* MSG_WAITFORONE blocks (on blocking sockets) only for the first datagram and
+     * then returns everything which is queued, up to \count datagrams.
+     */
+    ASYN_OS_SYSCALL(((res = recvmmsg(fd, hdr, count, MSG_WAITFORONE, NULL)) >= 0));
+    if(res < 0) return asyn_os_ioerr("recvmmsg()");
+
+    for(i = 0; i < (unsigned int)res; ++i) {
+        msgs[i].size = hdr[i].msg_len;
+        msgs[i].flags = (hdr[i].msg_hdr.msg_flags & MSG_TRUNC)?ASYN_MSG_TRUNC:0;
+        asyn_os_cmsg_read(&hdr[i].msg_hdr, &msgs[i]);
+        asyn_os_readsaddr(&saddr[i], hdr[i].msg_hdr.msg_namelen, &msgs[i].addr);
+    }
+    *done = res;
+    return ASYN_DONE;
+#else
+    unsigned int i, ret;
+
+    SUNDRY_ASSERT(msgs != NULL);
+    SUNDRY_ASSERT(done != NULL);
+
+    /* Emulate recvmmsg() with single calls. Only the first call may block. An error
+     * after the first datagram ends the batch; it is reported on the next call.
+     */
+    *done = 0;
+    for(i = 0; i < count; ++i) {
+        ret = asyn_os_recv(fd, &msgs[i], i != 0);
+        if(ret != ASYN_DONE) {
+            if(i == 0) return ret;
+            break;
+        }
+    #ifndef MSG_DONTWAIT
+        /* We cannot avoid blocking on the next call. */
+        ++i;
+        break;
+    #endif
+    }
+    *done = i;
+    return ASYN_DONE;
+#endif
+}
+
+
+unsigned int asyn_os_send(signed int fd, const asyn_msg_t *msg, unsigned int nowait) {
+    struct sockaddr_storage saddr;
+    socklen_t asize = 0;
+    signed int res;
+#ifndef ONS_SOCKET_WIN_HEADERS
+    struct msghdr hdr;
+    struct iovec iov;
+    asyn_os_cbuf_t cbuf;
+    unsigned int ret;
+    signed int flags = 0;
+#endif
+
+    SUNDRY_ASSERT(msg != NULL);
+
+    if(msg->addr.type != ASYN_NOADDR) asize = asyn_os_mksaddr(&saddr, msg->addr.type, msg->addr.ip, msg->addr.port);
+
+#ifdef ONS_SOCKET_WIN_HEADERS
+    if(msg->segsize > 0 && msg->segsize < msg->size) return ASYN_NOTSUPP;
+    if(msg->flags & ASYN_MSG_PKTINFO) return ASYN_NOTSUPP;
+    ASYN_OS_SYSCALL(((res = sendto(fd, msg->buf, msg->size, 0, asize?(struct sockaddr*)&saddr:NULL, asize)) != SOCKET_ERROR));
+    if(res == SOCKET_ERROR) return asyn_os_ioerr("sendto()");
+#else
+    #ifdef MSG_DONTWAIT
+        if(nowait) flags |= MSG_DONTWAIT;
+    #endif
+    memset(&hdr, 0, sizeof(hdr));
+    iov.iov_base = msg->buf;
+    iov.iov_len = msg->size;
+    hdr.msg_name = asize?&saddr:NULL;
+    hdr.msg_namelen = asize;
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    ret = asyn_os_cmsg_write(&hdr, &cbuf, msg);
+    if(ret != ASYN_DONE) return ret;
+    ASYN_OS_SYSCALL(((res = sendmsg(fd, &hdr, flags)) >= 0));
+    if(res < 0) return asyn_os_ioerr("sendmsg()");
+#endif
+    return ASYN_DONE;
+}
+
+
+unsigned int asyn_os_send_batch(signed int fd, asyn_msg_t *msgs, unsigned int count, unsigned int *done) {
+    unsigned int i;
+#ifdef ONS_SOCKET_MMSG
+    struct mmsghdr hdr[ASYN_OS_MMSG];
+    struct iovec iov[ASYN_OS_MMSG];
+    struct sockaddr_storage saddr[ASYN_OS_MMSG];
+    asyn_os_cbuf_t cbuf[ASYN_OS_MMSG];
+    signed int res;
+    unsigned int num, ret;
+#else
+    unsigned int ret;
+#endif
+
+    SUNDRY_ASSERT(msgs != NULL);
+    SUNDRY_ASSERT(done != NULL);
+
+    *done = 0;
+    for(i = 0; i < count; ++i) msgs[i].ret = ASYN_NONE;
+
+#ifdef ONS_SOCKET_MMSG
+    num = (count > ASYN_OS_MMSG)?ASYN_OS_MMSG:count;
+    if(num == 0) return ASYN_DONE;
+
+    memset(hdr, 0, num * sizeof(hdr[0]));
+    for(i = 0; i < num; ++i) {
+        iov[i].iov_base = msgs[i].buf;
+        iov[i].iov_len = msgs[i].size;
+        if(msgs[i].addr.type != ASYN_NOADDR) {
+            hdr[i].msg_hdr.msg_name = &saddr[i];
+            hdr[i].msg_hdr.msg_namelen = asyn_os_mksaddr(&saddr[i], msgs[i].addr.type, msgs[i].addr.ip, msgs[i].addr.port);
+        }
+        hdr[i].msg_hdr.msg_iov = &iov[i];
+        hdr[i].msg_hdr.msg_iovlen = 1;
+        ret = asyn_os_cmsg_write(&hdr[i].msg_hdr, &cbuf[i], &msgs[i]);
+        if(ret != ASYN_DONE) {
+            /* Send everything before the invalid message. */
+            if(i == 0) {
+                msgs[0].ret = ret;
+                return ret;
+            }
+            num = i;
+            break;
+        }
+    }
+
+    /* sendmmsg() stops at the first datagram which fails. If nothing was sent the
+     * error is returned directly, otherwise it is returned on the next call which
+     * starts with the failed datagram.
+     */
+    ASYN_OS_SYSCALL(((res = sendmmsg(fd, hdr, num, 0)) >= 0));
+    if(res < 0) {
+        ret = asyn_os_ioerr("sendmmsg()");
+        msgs[0].ret = ret;
+        return ret;
+    }
+
+    for(i = 0; i < (unsigned int)res; ++i) msgs[i].ret = ASYN_DONE;
+    *done = res;
+    return ASYN_DONE;
+#else
+    /* Emulate sendmmsg() with single calls. Only the first call may block. */
+    for(i = 0; i < count; ++i) {
+        ret = asyn_os_send(fd, &msgs[i], i != 0);
+        if(ret != ASYN_DONE) {
+            if(i == 0) {
+                msgs[0].ret = ret;
+                return ret;
+            }
+            break;
+        }
+        msgs[i].ret = ASYN_DONE;
+    #ifndef MSG_DONTWAIT
+        /* We cannot avoid blocking on the next call. */
+        ++i;
+        break;
+    #endif
+    }
+    *done = i;
+    return ASYN_DONE;
+#endif
+}
+
+
+unsigned int asyn_os_disconnect(signed int fd) {
+    struct sockaddr_storage saddr;
+
+    memset(&saddr, 0, sizeof(saddr));
+    ((struct sockaddr*)&saddr)->sa_family = AF_UNSPEC;
+#ifdef ONS_SOCKET_WIN_HEADERS
+    if(connect(fd, (struct sockaddr*)&saddr, sizeof(saddr)) == SOCKET_ERROR) {
+        /* Winsock dissolves the association and still reports an error. */
+        if(WSAGetLastError() == WSAEADDRNOTAVAIL) return ASYN_DONE;
+        SUNDRY_DEBUG("connect(AF_UNSPEC): Invalid ecode: %d", WSAGetLastError());
+        return ASYN_NOTSUPP;
+    }
+#else
+    if(connect(fd, (struct sockaddr*)&saddr, sizeof(saddr)) != 0) {
+        switch(errno) {
+            case EAFNOSUPPORT:
+                /* BSD dissolves the association and still reports an error. */
+                return ASYN_DONE;
+            case EBADF:
+            case ENOTSOCK:
+            case EINVAL:
+                return ASYN_NOTSUPP;
+            default:
+                SUNDRY_DEBUG("connect(AF_UNSPEC): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
+        }
+    }
+#endif
+    return ASYN_DONE;
+}
+
+
+#ifdef ONS_SOCKET_MCAST
+/* Sets the integer option \v4 on IPv4 and \v6 on IPv6 sockets. IPv4 sockets do not
+ * know the IPv6 level, so we try that one first.
+ */
+static unsigned int asyn_os_setipopt(signed int fd, signed int v4, signed int v6, signed int val, const char *name) {
+    if(setsockopt(fd, IPPROTO_IPV6, v6, &val, sizeof(val)) == 0) return ASYN_DONE;
+    if(errno == ENOPROTOOPT || errno == EOPNOTSUPP) {
+        if(setsockopt(fd, IPPROTO_IP, v4, &val, sizeof(val)) == 0) return ASYN_DONE;
+    }
+
+    switch(errno) {
+        case ENOPROTOOPT:
+        case EOPNOTSUPP:
+        case EBADF:
+        case ENOTSOCK:
+        case EINVAL:
+            return ASYN_NOTSUPP;
+        default:
+            SUNDRY_DEBUG("setsockopt(%s): Invalid ecode: %d", name, errno);
+            return ASYN_SYSCALL;
+    }
+}
+#endif
+
+
+unsigned int asyn_os_mcast_member(signed int fd, unsigned int join, const asyn_addr_t *group, const asyn_addr_t *source, unsigned int ifindex) {
+#ifdef ONS_SOCKET_MCAST
+    struct group_req greq;
+    struct group_source_req sreq;
+    signed int level, res;
+
+    SUNDRY_ASSERT(group != NULL);
+
+    /* The protocol independent requests of RFC 3678 work for both families. */
+    level = (group->type == ASYN_IPV4)?IPPROTO_IP:IPPROTO_IPV6;
+    if(source) {
+        memset(&sreq, 0, sizeof(sreq));
+        sreq.gsr_interface = ifindex;
+        asyn_os_mksaddr(&sreq.gsr_group, group->type, group->ip, 0);
+        asyn_os_mksaddr(&sreq.gsr_source, source->type, source->ip, 0);
+        res = setsockopt(fd, level, join?MCAST_JOIN_SOURCE_GROUP:MCAST_LEAVE_SOURCE_GROUP, &sreq, sizeof(sreq));
+    }
+    else {
+        memset(&greq, 0, sizeof(greq));
+        greq.gr_interface = ifindex;
+        asyn_os_mksaddr(&greq.gr_group, group->type, group->ip, 0);
+        res = setsockopt(fd, level, join?MCAST_JOIN_GROUP:MCAST_LEAVE_GROUP, &greq, sizeof(greq));
+    }
+    if(res == 0) return ASYN_DONE;
+
+    switch(errno) {
+        case EADDRINUSE:
+            return ASYN_INUSE;
+        case EADDRNOTAVAIL:
+        case ENODEV:
+        case ESRCH:
+            return ASYN_FAILED;
+        case ENOBUFS:
+            /* The limit of memberships per socket (net.ipv4.igmp_max_memberships). */
+            return ASYN_TOOMANY;
+        case ENOMEM:
+            return ASYN_MEMFAIL;
+        case ENOPROTOOPT:
+        case EOPNOTSUPP:
+        case EBADF:
+        case ENOTSOCK:
+        case EINVAL:
+        case EAFNOSUPPORT:
+            return ASYN_NOTSUPP;
+        default:
+            SUNDRY_DEBUG("setsockopt(MCAST_JOIN_GROUP): Invalid ecode: %d", errno);
+            return ASYN_SYSCALL;
+    }
+#else
+    return ASYN_NOTSUPP;
+#endif
+}
+
+
+unsigned int asyn_os_setmcast_hops(signed int fd, unsigned int hops) {
+#ifdef ONS_SOCKET_MCAST
+    return asyn_os_setipopt(fd, IP_MULTICAST_TTL, IPV6_MULTICAST_HOPS, hops, "IP_MULTICAST_TTL");
+#else
+    return ASYN_NOTSUPP;
+#endif
+}
+
+
+unsigned int asyn_os_setmcast_loop(signed int fd, unsigned int set) {
+#ifdef ONS_SOCKET_MCAST
+    return asyn_os_setipopt(fd, IP_MULTICAST_LOOP, IPV6_MULTICAST_LOOP, set?1:0, "IP_MULTICAST_LOOP");
+#else
+    return ASYN_NOTSUPP;
+#endif
+}
+
+
+unsigned int asyn_os_peer_send(signed int fd, const void *buf, size_t size) {
+    signed int res;
+
+#ifdef ONS_SOCKET_WIN_HEADERS
+    ASYN_OS_SYSCALL(((res = send(fd, buf, size, 0)) != SOCKET_ERROR));
+    if(res == SOCKET_ERROR) return asyn_os_ioerr("send()");
+#else
+    ASYN_OS_SYSCALL(((res = send(fd, buf, size, 0)) >= 0));
+    if(res < 0) return asyn_os_ioerr("send()");
+#endif
+    return ASYN_DONE;
+}
+
+
+unsigned int asyn_os_peer_recv(signed int fd, void *buf, size_t *size, unsigned int *trunc) {
+    signed int res, flags = 0;
+
+    SUNDRY_ASSERT(size != NULL);
+    SUNDRY_ASSERT(trunc != NULL);
+
+    /* Linux returns the real length of truncated datagrams with MSG_TRUNC. */
+#if defined(MSG_TRUNC) && !defined(ONS_SOCKET_WIN_HEADERS)
+    flags |= MSG_TRUNC;
+#endif
+
+    *trunc = 0;
+#ifdef ONS_SOCKET_WIN_HEADERS
+    ASYN_OS_SYSCALL(((res = recv(fd, buf, *size, flags)) != SOCKET_ERROR));
+    if(res == SOCKET_ERROR) {
+        *size = 0;
+        return asyn_os_ioerr("recv()");
+    }
+#else
+    ASYN_OS_SYSCALL(((res = recv(fd, buf, *size, flags)) >= 0));
+    if(res < 0) {
+        *size = 0;
+        return asyn_os_ioerr("recv()");
+    }
+#endif
+
+    if((size_t)res > *size) *trunc = 1;
+    else *size = res;
+    return ASYN_DONE;
+}
+
+#ifndef ONS_SOCKET_WIN_HEADERS
+/* Translates the error \err of a connection attempt into an asynchio return code. */
+static unsigned int asyn_os_connres(signed int err) {
+    switch(err) {
+        case EINPROGRESS:
+        case EINTR:
+            return ASYN_BLOCKED;
+        case EPERM:
+        case EACCES:
+            /* Broadcast address or a local firewall rule. */
+            return ASYN_DENIED;
+        case EADDRINUSE:
+        case EADDRNOTAVAIL:
+            return ASYN_INUSE;
+        case EAGAIN:
+            /* No more free local ports. */
+            return ASYN_TOOMANY;
+        case ENOBUFS:
+        case ENOMEM:
+            return ASYN_MEMFAIL;
+        case ECONNREFUSED:
+        case ECONNRESET:
+        case ENETUNREACH:
+        case ENETDOWN:
+        case EHOSTUNREACH:
+        case EHOSTDOWN:
+        case ETIMEDOUT:
+            return ASYN_FAILED;
+        case EAFNOSUPPORT:
+        case EINVAL:
+        case EFAULT:
+        case EISCONN:
+        case EALREADY:
+        case EBADF:
+        case ENOTSOCK:
+            return ASYN_NOTSUPP;
+        default:
+            SUNDRY_DEBUG("connect(): Invalid ecode: %d", err);
+            return ASYN_SYSCALL;
+    }
+}
+#endif
+
+
+unsigned int asyn_os_setreuseaddr(signed int fd) {
+    signed int val = 1;
+
+#ifdef ONS_SOCKET_WIN_HEADERS
+    /* SO_REUSEADDR allows to steal ports on windows, SO_EXCLUSIVEADDRUSE is the
+     * safe default there. Listening sockets can be rebound anyway.
+     */
+    (void)fd;
+    (void)val;
+    return ASYN_DONE;
+#else
+    if(setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &val, sizeof(val)) != 0) {
+        switch(errno) {
+            case EBADF:
+            case ENOTSOCK:
+            case EINVAL:
+            case ENOPROTOOPT:
+                return ASYN_NOTSUPP;
+            case ENOMEM:
+            case ENOBUFS:
+                return ASYN_MEMFAIL;
+            default:
+                SUNDRY_DEBUG("setsockopt(SO_REUSEADDR): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
+        }
+    }
+    return ASYN_DONE;
+#endif
+}
+
+
+unsigned int asyn_os_setnodelay(signed int fd, unsigned int set) {
+    signed int val = set?1:0;
+
+#ifdef ONS_SOCKET_WIN_HEADERS
+    if(setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (char*)&val, sizeof(val)) == SOCKET_ERROR) {
+        SUNDRY_DEBUG("setsockopt(TCP_NODELAY): Invalid ecode: %d", WSAGetLastError());
+        return ASYN_NOTSUPP;
+    }
+#else
+    if(setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &val, sizeof(val)) != 0) {
+        switch(errno) {
+            case EBADF:
+            case ENOTSOCK:
+            case EINVAL:
+            case ENOPROTOOPT:
+            case EOPNOTSUPP:
+                return ASYN_NOTSUPP;
+            case ENOMEM:
+            case ENOBUFS:
+                return ASYN_MEMFAIL;
+            default:
+                SUNDRY_DEBUG("setsockopt(TCP_NODELAY): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
+        }
+    }
+#endif
+    return ASYN_DONE;
+}
+
+
+unsigned int asyn_os_listen(signed int fd, unsigned int backlog) {
+    /* Unix defines a signed integer here. The kernel truncates it to somaxconn. */
+    if(backlog > INT_MAX) backlog = INT_MAX;
+
+#ifdef ONS_SOCKET_WIN_HEADERS
+    if(listen(fd, (signed int)backlog) == SOCKET_ERROR) {
+        switch(WSAGetLastError()) {
+            case WSANOTINITIALISED:
+                return ASYN_NOTINIT;
+            case WSAEADDRINUSE:
+                return ASYN_INUSE;
+            case WSAEMFILE:
+            case WSAENOBUFS:
+                return ASYN_MEMFAIL;
+            case WSAENOTSOCK:
+            case WSAEINVAL:
+            case WSAEISCONN:
+            case WSAEOPNOTSUPP:
+                return ASYN_NOTSUPP;
+            default:
+                SUNDRY_DEBUG("listen(): Invalid ecode: %d", WSAGetLastError());
+                return ASYN_SYSCALL;
+        }
+    }
+#else
+    if(listen(fd, (signed int)backlog) != 0) {
+        switch(errno) {
+            case EADDRINUSE:
+                /* Another socket is already listening on the same port. */
+                return ASYN_INUSE;
+            case EBADF:
+            case ENOTSOCK:
+            case EINVAL:
+            case EISCONN:
+            case EOPNOTSUPP:
+                return ASYN_NOTSUPP;
+            default:
+                SUNDRY_DEBUG("listen(): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
+        }
+    }
+#endif
+    return ASYN_DONE;
+}
+
+
+unsigned int asyn_os_accept(signed int fd, signed int *nfd, asyn_addr_t *addr, unsigned int nblock, unsigned int noinherit) {
+    struct sockaddr_storage saddr;
+    unsigned int ret;
+#ifdef ONS_SOCKET_WIN_HEADERS
+    signed int size = sizeof(saddr);
+#else
+    socklen_t size = sizeof(saddr);
+    signed int flags = 0;
+#endif
+
+    SUNDRY_ASSERT(nfd != NULL);
+
+#ifdef ONS_SOCKET_WIN_HEADERS
+    ASYN_OS_SYSCALL(((*nfd = accept(fd, (struct sockaddr*)&saddr, &size)) != INVALID_SOCKET));
+    if(*nfd == INVALID_SOCKET) {
+        switch(WSAGetLastError()) {
+            case WSAEWOULDBLOCK:
+                return ASYN_BLOCKED;
+            case WSANOTINITIALISED:
+                return ASYN_NOTINIT;
+            case WSAECONNRESET:
+                return ASYN_FAILED;
+            case WSAEMFILE:
+                return ASYN_TOOMANY;
+            case WSAENOBUFS:
+                return ASYN_MEMFAIL;
+            case WSAEFAULT:
+            case WSAEINVAL:
+            case WSAENOTSOCK:
+            case WSAEOPNOTSUPP:
+                return ASYN_NOTSUPP;
+            default:
+                SUNDRY_DEBUG("accept(): Invalid ecode: %d", WSAGetLastError());
+                return ASYN_SYSCALL;
+        }
+    }
+    (void)noinherit;
+#else
+    #ifdef ONS_SOCKET_EXTSOCK
+        if(nblock) flags |= SOCK_NONBLOCK;
+        if(noinherit) flags |= SOCK_CLOEXEC;
+        ASYN_OS_SYSCALL(((*nfd = accept4(fd, (struct sockaddr*)&saddr, &size, flags)) >= 0));
+    #else
+        ASYN_OS_SYSCALL(((*nfd = accept(fd, (struct sockaddr*)&saddr, &size)) >= 0));
+    #endif
+    if(*nfd < 0) {
+        switch(errno) {
+            case ASYN_OS_EAGAIN:
+                return ASYN_BLOCKED;
+            case ECONNABORTED:
+            case EPROTO:
+            case ENETDOWN:
+            case ENETUNREACH:
+            case EHOSTDOWN:
+            case EHOSTUNREACH:
+            case ENOPROTOOPT:
+        #ifdef ENONET
+            case ENONET:
+        #endif
+                /* Linux passes pending network errors of the new connection to accept().
+                 * The connection is gone, but the listener is still usable.
+                 */
+                return ASYN_FAILED;
+            case EMFILE:
+            case ENFILE:
+                return ASYN_TOOMANY;
+            case ENOBUFS:
+            case ENOMEM:
+                return ASYN_MEMFAIL;
+            case EPERM:
+                /* Firewall rules forbid the connection. */
+                return ASYN_DENIED;
+            case EBADF:
+            case ENOTSOCK:
+            case EINVAL:
+            case EFAULT:
+            case EOPNOTSUPP:
+                /* \fd is not a listening stream socket. */
+                return ASYN_NOTSUPP;
+            default:
+                SUNDRY_DEBUG("accept(): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
+        }
+    }
+
+    #ifndef ONS_SOCKET_EXTSOCK
+        #ifdef ONS_SOCKET_FCNTL
+            if(noinherit && fcntl(*nfd, F_SETFD, FD_CLOEXEC) != 0) {
+                SUNDRY_DEBUG("fcntl(F_SETFD | FD_CLOEXEC): Failed directly after accept(): %d", errno);
+                close(*nfd);
+                return ASYN_SYSCALL;
+            }
+        #endif
+    #endif
+#endif
+
+#if defined(ONS_SOCKET_WIN_HEADERS) || !defined(ONS_SOCKET_EXTSOCK)
+    if(nblock) {
+        ret = asyn_os_setnblock(*nfd, 1);
+        if(ret != ASYN_DONE) {
+            asyn_os_close(*nfd);
+            return ret;
+        }
+    }
+#endif
+
+    (void)ret;
+    if(addr) asyn_os_readsaddr(&saddr, size, addr);
+    return ASYN_DONE;
+}
+
+
+unsigned int asyn_os_connect(signed int fd, unsigned int type, const void *ip, unsigned int port) {
+    struct sockaddr_storage saddr;
+    socklen_t size;
+
+    SUNDRY_ASSERT(ip != NULL);
+
+    size = asyn_os_mksaddr(&saddr, type, ip, port);
+
+    /* connect() is not restarted on EINTR. The connection continues in the background
+     * and a second call would fail with EALREADY.
+     */
+#ifdef ONS_SOCKET_WIN_HEADERS
+    if(connect(fd, (struct sockaddr*)&saddr, size) == SOCKET_ERROR) {
+        switch(WSAGetLastError()) {
+            case WSAEWOULDBLOCK:
+            case WSAEINPROGRESS:
+            case WSAEINTR:
+                return ASYN_BLOCKED;
+            case WSANOTINITIALISED:
+                return ASYN_NOTINIT;
+            case WSAEACCES:
+                return ASYN_DENIED;
+            case WSAEADDRINUSE:
+            case WSAEADDRNOTAVAIL:
+                return ASYN_INUSE;
+            case WSAENOBUFS:
+                return ASYN_MEMFAIL;
+            case WSAECONNREFUSED:
+            case WSAENETUNREACH:
+            case WSAEHOSTUNREACH:
+            case WSAETIMEDOUT:
+            case WSAENETDOWN:
+                return ASYN_FAILED;
+            case WSAEAFNOSUPPORT:
+            case WSAEFAULT:
+            case WSAEINVAL:
+            case WSAEISCONN:
+            case WSAEALREADY:
+            case WSAENOTSOCK:
+                return ASYN_NOTSUPP;
+            default:
+                SUNDRY_DEBUG("connect(): Invalid ecode: %d", WSAGetLastError());
+                return ASYN_SYSCALL;
+        }
+    }
+    return ASYN_DONE;
+#else
+    if(connect(fd, (struct sockaddr*)&saddr, size) != 0) return asyn_os_connres(errno);
+    return ASYN_DONE;
+#endif
+}
+
+
+unsigned int asyn_os_connerr(signed int fd) {
+    signed int err = 0;
+
+#ifdef ONS_SOCKET_WIN_HEADERS
+    signed int size = sizeof(err);
+
+    if(getsockopt(fd, SOL_SOCKET, SO_ERROR, (char*)&err, &size) == SOCKET_ERROR) {
+        SUNDRY_DEBUG("getsockopt(SO_ERROR): Invalid ecode: %d", WSAGetLastError());
+        return ASYN_NOTSUPP;
+    }
+    if(err == 0) return ASYN_DONE;
+    else if(err == WSAEWOULDBLOCK || err == WSAEINPROGRESS) return ASYN_BLOCKED;
+    else if(err == WSAEACCES) return ASYN_DENIED;
+    else return ASYN_FAILED;
+#else
+    socklen_t size = sizeof(err);
+
+    if(getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &size) != 0) {
+        switch(errno) {
+            case EBADF:
+            case ENOTSOCK:
+            case EINVAL:
+            case ENOPROTOOPT:
+                return ASYN_NOTSUPP;
+            default:
+                SUNDRY_DEBUG("getsockopt(SO_ERROR): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
+        }
+    }
+    if(err == 0) return ASYN_DONE;
+    return asyn_os_connres(err);
+#endif
+}
+
+
+unsigned int asyn_os_read(signed int fd, void *buf, size_t *size) {
+    signed int res;
+
+    SUNDRY_ASSERT(buf != NULL);
+    SUNDRY_ASSERT(size != NULL);
+
+#ifdef ONS_SOCKET_WIN_HEADERS
+    if(*size > INT_MAX) *size = INT_MAX;
+    ASYN_OS_SYSCALL(((res = recv(fd, buf, (signed int)*size, 0)) != SOCKET_ERROR));
+    if(res == SOCKET_ERROR) {
+        *size = 0;
+        return asyn_os_ioerr("recv()");
+    }
+#else
+    ASYN_OS_SYSCALL(((res = recv(fd, buf, *size, 0)) >= 0));
+    if(res < 0) {
+        *size = 0;
+        return asyn_os_ioerr("recv()");
+    }
+#endif
+
+    *size = res;
+    if(res == 0) return ASYN_NONE;
+    return ASYN_DONE;
+}
+
+
+unsigned int asyn_os_sendv(signed int fd, const asyn_os_iov_t *iov, unsigned int count, unsigned int zerocopy, size_t *done) {
+#ifdef ONS_SOCKET_WIN_HEADERS
+    WSABUF buf[ASYN_OS_IOV];
+    DWORD res;
+#else
+    struct iovec buf[ASYN_OS_IOV];
+    struct msghdr hdr;
+    ssize_t res;
+    signed int flags = 0;
+#endif
+    unsigned int i;
+
+    SUNDRY_ASSERT(iov != NULL);
+    SUNDRY_ASSERT(done != NULL);
+
+    *done = 0;
+    if(count > ASYN_OS_IOV) count = ASYN_OS_IOV;
+    if(count == 0) return ASYN_DONE;
+
+#ifdef ONS_SOCKET_WIN_HEADERS
+    for(i = 0; i < count; ++i) {
+        buf[i].buf = (char*)iov[i].buf;
+        buf[i].len = iov[i].size;
+    }
+    if(WSASend(fd, buf, count, &res, 0, NULL, NULL) == SOCKET_ERROR) return asyn_os_ioerr("WSASend()");
+#else
+    for(i = 0; i < count; ++i) {
+        buf[i].iov_base = (void*)iov[i].buf;
+        buf[i].iov_len = iov[i].size;
+    }
+
+    /* This is writev() but sendmsg() allows to suppress SIGPIPE on broken connections. */
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_iov = buf;
+    hdr.msg_iovlen = count;
+    #ifdef MSG_NOSIGNAL
+        flags |= MSG_NOSIGNAL;
+    #endif
+    #ifdef ONS_SOCKET_ZEROCOPY
+        if(zerocopy) flags |= MSG_ZEROCOPY;
+    #endif
+    ASYN_OS_SYSCALL(((res = sendmsg(fd, &hdr, flags)) >= 0));
+    if(res < 0) return asyn_os_ioerr("sendmsg()");
+#endif
+
+    (void)zerocopy;
+    *done = res;
+    return ASYN_DONE;
+}
+
+
+unsigned int asyn_os_setzerocopy(signed int fd) {
+#ifdef ONS_SOCKET_ZEROCOPY
+    signed int val = 1;
+
+    if(setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &val, sizeof(val)) != 0) {
+        switch(errno) {
+            case ENOPROTOOPT:
+                /* The kernel is older than 4.14. */
+            case EOPNOTSUPP:
+            case EBADF:
+            case ENOTSOCK:
+            case EINVAL:
+                return ASYN_NOTSUPP;
+            case ENOMEM:
+            case ENOBUFS:
+                return ASYN_MEMFAIL;
+            default:
+                SUNDRY_DEBUG("setsockopt(SO_ZEROCOPY): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
+        }
+    }
+    return ASYN_DONE;
+#else
+    return ASYN_NOTSUPP;
+#endif
+}
+
+
+unsigned int asyn_os_zcreap(signed int fd, uint32_t *lo, uint32_t *hi) {
+#ifdef ONS_SOCKET_ZEROCOPY
+    struct msghdr hdr;
+    struct cmsghdr *cmsg;
+    struct sock_extended_err err;
+    asyn_os_cbuf_t cbuf;
+    signed int res;
+
+    SUNDRY_ASSERT(lo != NULL);
+    SUNDRY_ASSERT(hi != NULL);
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_control = cbuf.buf;
+    hdr.msg_controllen = sizeof(cbuf.buf);
+    ASYN_OS_SYSCALL(((res = recvmsg(fd, &hdr, MSG_ERRQUEUE)) >= 0));
+    if(res < 0) return asyn_os_ioerr("recvmsg(MSG_ERRQUEUE)");
+
+    for(cmsg = CMSG_FIRSTHDR(&hdr); cmsg; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+        if(!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) &&
+           !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) continue;
+        memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+        if(err.ee_errno != 0 || err.ee_origin != SO_EE_ORIGIN_ZEROCOPY) continue;
+
+        /* SO_EE_CODE_ZEROCOPY_COPIED in \ee_code tells that the kernel copied the data
+         * anyway. The pages are free nevertheless.
+         */
+        *lo = err.ee_info;
+        *hi = err.ee_data;
+        return ASYN_DONE;
+    }
+    return ASYN_NONE;
+#else
+    return ASYN_BLOCKED;
+#endif
+}
+
+
+/* Translates errno of a failed streaming call. EINVAL and ENOSYS mean that the file
+ * or the system does not support the call.
+ */
+static unsigned int asyn_os_streamerr(const char *call) {
+#ifndef ONS_SOCKET_WIN_HEADERS
+    switch(errno) {
+        case EINVAL:
+        case ENOSYS:
+        case ESPIPE:
+        case EOVERFLOW:
+            return ASYN_NOTSUPP;
+        case EIO:
+            /* Reading the file failed. */
+            SUNDRY_DEBUG("%s: File IO failed", call);
+            return ASYN_SYSCALL;
+        default:
+            return asyn_os_ioerr(call);
+    }
+#else
+    return asyn_os_ioerr(call);
+#endif
+}
+
+
+unsigned int asyn_os_sendfile(signed int sock, signed int file, uint64_t off, size_t count, size_t *done) {
+#ifdef ONS_SOCKET_SENDFILE
+    off_t pos = off;
+    ssize_t res;
+
+    SUNDRY_ASSERT(done != NULL);
+
+    *done = 0;
+    ASYN_OS_SYSCALL(((res = sendfile(sock, file, &pos, count)) >= 0));
+    if(res < 0) return asyn_os_streamerr("sendfile()");
+    *done = res;
+    return ASYN_DONE;
+#else
+    *done = 0;
+    return ASYN_NOTSUPP;
+#endif
+}
+
+
+unsigned int asyn_os_pipe(signed int *fds) {
+#ifdef ONS_SOCKET_SPLICE
+    SUNDRY_ASSERT(fds != NULL);
+
+    if(pipe2(fds, O_NONBLOCK | O_CLOEXEC) != 0) {
+        switch(errno) {
+            case EMFILE:
+            case ENFILE:
+                return ASYN_TOOMANY;
+            case EINVAL:
+            case ENOSYS:
+                return ASYN_NOTSUPP;
+            default:
+                SUNDRY_DEBUG("pipe2(): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
+        }
+    }
+    return ASYN_DONE;
+#else
+    return ASYN_NOTSUPP;
+#endif
+}
+
+
+unsigned int asyn_os_splice(signed int in, const uint64_t *off, signed int out, size_t count, unsigned int more, size_t *done) {
+#ifdef ONS_SOCKET_SPLICE
+    loff_t pos;
+    ssize_t res;
+    unsigned int flags = SPLICE_F_MOVE | SPLICE_F_NONBLOCK;
+
+    SUNDRY_ASSERT(done != NULL);
+
+    *done = 0;
+    if(more) flags |= SPLICE_F_MORE;
+    if(off) pos = *off;
+    ASYN_OS_SYSCALL(((res = splice(in, off?&pos:NULL, out, NULL, count, flags)) >= 0));
+    if(res < 0) return asyn_os_streamerr("splice()");
+    *done = res;
+    return ASYN_DONE;
+#else
+    *done = 0;
+    return ASYN_NOTSUPP;
+#endif
+}
+
+
+unsigned int asyn_os_pread(signed int file, void *buf, size_t count, uint64_t off, size_t *done) {
+#ifdef ONS_SOCKET_BERKELEY_HEADERS
+    ssize_t res;
+
+    SUNDRY_ASSERT(done != NULL);
+
+    *done = 0;
+    ASYN_OS_SYSCALL(((res = pread(file, buf, count, off)) >= 0));
+    if(res < 0) return asyn_os_streamerr("pread()");
+    *done = res;
+    return ASYN_DONE;
+#else
+    *done = 0;
+    return ASYN_NOTSUPP;
+#endif
+}
+
+
+#ifdef ONS_SOCKET_BERKELEY_HEADERS
+/* Sets FD_CLOEXEC on the \count descriptors in \fds if the kernel did not already do
+ * it. Returns ASYN_SYSCALL on failure.
+ */
+static unsigned int asyn_os_uxcloexec(signed int *fds, unsigned int count) {
+#if defined(ONS_SOCKET_FCNTL) && !defined(ONS_SOCKET_EXTSOCK)
+    unsigned int i;
+
+    for(i = 0; i < count; ++i) {
+        if(fcntl(fds[i], F_SETFD, FD_CLOEXEC) != 0) {
+            SUNDRY_DEBUG("fcntl(F_SETFD | FD_CLOEXEC): Invalid ecode: %d", errno);
+            return ASYN_SYSCALL;
+        }
+    }
+#endif
+    (void)fds;
+    (void)count;
+    return ASYN_DONE;
+}
+#endif
+
+
+unsigned int asyn_os_uxsocket(signed int *fd, unsigned int dgram, unsigned int noinherit) {
+#ifdef ONS_SOCKET_BERKELEY_HEADERS
+    signed int trans;
+
+    SUNDRY_ASSERT(fd != NULL);
+
+    trans = dgram?SOCK_DGRAM:SOCK_STREAM;
+#ifdef ONS_SOCKET_EXTSOCK
+    if(noinherit) trans |= SOCK_CLOEXEC;
+#endif
+
+    ASYN_OS_SYSCALL(((*fd = socket(PF_UNIX, trans, 0)) >= 0));
+    if(*fd < 0) {
+        switch(errno) {
+            case EAFNOSUPPORT:
+            case EPROTONOSUPPORT:
+            case ESOCKTNOSUPPORT:
+            case EINVAL:
+                return ASYN_NOTSUPP;
+            case EPERM:
+            case EACCES:
+                return ASYN_DENIED;
+            case EMFILE:
+            case ENFILE:
+                return ASYN_TOOMANY;
+            case ENOBUFS:
+            case ENOMEM:
+                return ASYN_MEMFAIL;
+            default:
+                SUNDRY_DEBUG("socket(PF_UNIX): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
+        }
+    }
+
+    if(noinherit && asyn_os_uxcloexec(fd, 1) != ASYN_DONE) {
+        close(*fd);
+        return ASYN_SYSCALL;
+    }
+    return ASYN_DONE;
+#else
+    return ASYN_NOTSUPP;
+#endif
+}
+
+
+unsigned int asyn_os_uxpair(signed int *fds, unsigned int dgram, unsigned int noinherit) {
+#ifdef ONS_SOCKET_BERKELEY_HEADERS
+    signed int trans;
+
+    SUNDRY_ASSERT(fds != NULL);
+
+    trans = dgram?SOCK_DGRAM:SOCK_STREAM;
+#ifdef ONS_SOCKET_EXTSOCK
+    if(noinherit) trans |= SOCK_CLOEXEC;
+#endif
+
+    if(socketpair(PF_UNIX, trans, 0, fds) != 0) {
+        switch(errno) {
+            case EAFNOSUPPORT:
+            case EPROTONOSUPPORT:
+            case EOPNOTSUPP:
+            case EINVAL:
+                return ASYN_NOTSUPP;
+            case EMFILE:
+            case ENFILE:
+                return ASYN_TOOMANY;
+            case ENOBUFS:
+            case ENOMEM:
+                return ASYN_MEMFAIL;
+            default:
+                SUNDRY_DEBUG("socketpair(): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
+        }
+    }
+
+    if(noinherit && asyn_os_uxcloexec(fds, 2) != ASYN_DONE) {
+        close(fds[0]);
+        close(fds[1]);
+        return ASYN_SYSCALL;
+    }
+    return ASYN_DONE;
+#else
+    return ASYN_NOTSUPP;
+#endif
+}
+
+
+unsigned int asyn_os_uxbind(signed int fd, const char *path) {
+#ifdef ONS_SOCKET_BERKELEY_HEADERS
+    struct sockaddr_un saddr;
+    socklen_t size;
+
+    SUNDRY_ASSERT(path != NULL);
+
+    size = asyn_os_mkuxaddr(&saddr, path);
+    if(size == 0) return ASYN_NOTSUPP;
+
+    if(bind(fd, (struct sockaddr*)&saddr, size) != 0) {
+        switch(errno) {
+            case EACCES:
+            case EPERM:
+            case EROFS:
+                return ASYN_DENIED;
+            case EADDRINUSE:
+            case EEXIST:
+                /* A (maybe stale) socket file exists. */
+                return ASYN_INUSE;
+            case ENOMEM:
+            case ENOBUFS:
+            case ENOSPC:
+                return ASYN_MEMFAIL;
+            case ENOENT:
+            case ENOTDIR:
+            case ENAMETOOLONG:
+            case ELOOP:
+            case EADDRNOTAVAIL:
+            case EBADF:
+            case ENOTSOCK:
+            case EINVAL:
+            case EFAULT:
+                /* Invalid path, invalid socket or socket is already bound. */
+                return ASYN_NOTSUPP;
+            default:
+                SUNDRY_DEBUG("bind(): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
+        }
+    }
+    return ASYN_DONE;
+#else
+    return ASYN_NOTSUPP;
+#endif
+}
+
+
+unsigned int asyn_os_uxconnect(signed int fd, const char *path) {
+#ifdef ONS_SOCKET_BERKELEY_HEADERS
+    struct sockaddr_un saddr;
+    socklen_t size;
+
+    SUNDRY_ASSERT(path != NULL);
+
+    size = asyn_os_mkuxaddr(&saddr, path);
+    if(size == 0) return ASYN_NOTSUPP;
+
+    /* Local connections are established immediately or not at all. */
+    if(connect(fd, (struct sockaddr*)&saddr, size) != 0) {
+        switch(errno) {
+            case ASYN_OS_EAGAIN:
+                /* The listener's backlog is full. */
+                return ASYN_BLOCKED;
+            case ENOENT:
+            case ECONNREFUSED:
+                return ASYN_FAILED;
+            case ENOTDIR:
+            case ENAMETOOLONG:
+            case ELOOP:
+            case EPROTOTYPE:
+                return ASYN_NOTSUPP;
+            default:
+                return asyn_os_connres(errno);
+        }
+    }
+    return ASYN_DONE;
+#else
+    return ASYN_NOTSUPP;
+#endif
+}
+
+
+unsigned int asyn_os_uxsend(signed int fd, const void *buf, size_t *size, const signed int *fds, unsigned int nfds) {
+#ifdef ONS_SOCKET_BERKELEY_HEADERS
+    union {
+        struct cmsghdr align;
+        unsigned char buf[CMSG_SPACE(sizeof(signed int) * ASYN_OS_UXFDS)];
+    } cbuf;
+    struct cmsghdr *cmsg;
+    struct msghdr hdr;
+    struct iovec iov;
+    ssize_t res;
+    signed int flags = 0;
+
+    SUNDRY_ASSERT(size != NULL);
+    SUNDRY_ASSERT(nfds == 0 || fds != NULL);
+
+    if(nfds > ASYN_OS_UXFDS) nfds = ASYN_OS_UXFDS;
+
+    memset(&hdr, 0, sizeof(hdr));
+    iov.iov_base = (void*)buf;
+    iov.iov_len = *size;
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    if(nfds > 0) {
+        memset(&cbuf, 0, sizeof(cbuf));
+        hdr.msg_control = cbuf.buf;
+        hdr.msg_controllen = CMSG_SPACE(sizeof(signed int) * nfds);
+        cmsg = CMSG_FIRSTHDR(&hdr);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(signed int) * nfds);
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(signed int) * nfds);
+    }
+#ifdef MSG_NOSIGNAL
+    flags |= MSG_NOSIGNAL;
+#endif
+
+    *size = 0;
+    ASYN_OS_SYSCALL(((res = sendmsg(fd, &hdr, flags)) >= 0));
+    if(res < 0) {
+        /* Passing descriptors of closed files or too many of them. */
+        if(errno == EBADF && nfds > 0) return ASYN_NOTSUPP;
+        if(errno == ETOOMANYREFS) return ASYN_TOOMANY;
+        return asyn_os_ioerr("sendmsg()");
+    }
+    *size = res;
+    return ASYN_DONE;
+#else
+    *size = 0;
+    return ASYN_NOTSUPP;
+#endif
+}
+
+
+unsigned int asyn_os_uxrecv(signed int fd, void *buf, size_t *size, signed int *fds, unsigned int *nfds, unsigned int noinherit) {
+#ifdef ONS_SOCKET_BERKELEY_HEADERS
+    union {
+        struct cmsghdr align;
+        unsigned char buf[CMSG_SPACE(sizeof(signed int) * ASYN_OS_UXFDS)];
+    } cbuf;
+    struct cmsghdr *cmsg;
+    struct msghdr hdr;
+    struct iovec iov;
+    ssize_t res;
+    signed int flags = 0, rfd;
+    unsigned int max, i, num;
+
+    SUNDRY_ASSERT(size != NULL);
+    SUNDRY_ASSERT(nfds != NULL);
+
+    max = fds?*nfds:0;
+    *nfds = 0;
+
+    memset(&hdr, 0, sizeof(hdr));
+    iov.iov_base = buf;
+    iov.iov_len = *size;
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = cbuf.buf;
+    hdr.msg_controllen = sizeof(cbuf.buf);
+#ifdef MSG_CMSG_CLOEXEC
+    if(noinherit) flags |= MSG_CMSG_CLOEXEC;
+#endif
+
+    *size = 0;
+    ASYN_OS_SYSCALL(((res = recvmsg(fd, &hdr, flags)) >= 0));
+    if(res < 0) return asyn_os_ioerr("recvmsg()");
+    *size = res;
+
+    /* Every received descriptor is either handed to the caller or closed. Otherwise
+     * it would leak.
+     */
+    for(cmsg = CMSG_FIRSTHDR(&hdr); cmsg; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+        if(cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+        num = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(signed int);
+        for(i = 0; i < num; ++i) {
+            memcpy(&rfd, CMSG_DATA(cmsg) + i * sizeof(signed int), sizeof(rfd));
+#ifndef MSG_CMSG_CLOEXEC
+            if(noinherit) asyn_os_uxcloexec(&rfd, 1);
+#endif
+            if(*nfds < max) fds[(*nfds)++] = rfd;
+            else close(rfd);
+        }
+    }
+
+    return ASYN_DONE;
+#else
+    *size = 0;
+    *nfds = 0;
+    return ASYN_NOTSUPP;
+#endif
+}
+
+
+unsigned int asyn_os_poll_init(signed int *pfd) {
+    SUNDRY_ASSERT(pfd != NULL);
+
+#ifdef ONS_POLL_EPOLL
+    /* The poll object is never inherited. There is no reason why a subprocess
+     * should use our poll object.
+     */
+    *pfd = epoll_create1(EPOLL_CLOEXEC);
+    if(*pfd < 0) {
+        switch(errno) {
+            case EINVAL:
+            case ENOSYS:
+                return ASYN_NOTSUPP;
+            case EMFILE:
+            case ENFILE:
+                return ASYN_TOOMANY;
+            case ENOMEM:
+                return ASYN_MEMFAIL;
+            default:
+                SUNDRY_DEBUG("epoll_create1(): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
+        }
+    }
+    return ASYN_DONE;
+#else
+    *pfd = -1;
+    return ASYN_NOTSUPP;
+#endif
+}
+
+
+unsigned int asyn_os_poll_ctl(signed int pfd, unsigned int op, signed int fd, unsigned int events, void *data) {
+#ifdef ONS_POLL_EPOLL
+    struct epoll_event ev;
+    signed int eop;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLET;
+    if(events & ASYN_OS_PIN) ev.events |= EPOLLIN;
+    if(events & ASYN_OS_POUT) ev.events |= EPOLLOUT;
+    ev.data.ptr = data;
+
+    if(op == ASYN_OS_PADD) eop = EPOLL_CTL_ADD;
+    else if(op == ASYN_OS_PMOD) eop = EPOLL_CTL_MOD;
+    else eop = EPOLL_CTL_DEL;
+
+    if(epoll_ctl(pfd, eop, fd, &ev) != 0) {
+        switch(errno) {
+            case EBADF:
+            case EINVAL:
+            case EEXIST:
+            case ENOENT:
+            case EPERM:
+                /* \fd does not support polling or was (not) already registered. */
+                return ASYN_NOTSUPP;
+            case ENOMEM:
+                return ASYN_MEMFAIL;
+            case ENOSPC:
+                /* max_user_watches limit reached. */
+                return ASYN_TOOMANY;
+            default:
+                SUNDRY_DEBUG("epoll_ctl(): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
+        }
+    }
+    return ASYN_DONE;
+#else
+    return ASYN_NOTSUPP;
+#endif
+}
+
+
+unsigned int asyn_os_poll_wait(signed int pfd, asyn_os_pev_t *evs, unsigned int max, signed int timeout, unsigned int *count) {
+#ifdef ONS_POLL_EPOLL
+    struct epoll_event buf[ASYN_OS_PMAX];
+    signed int res, i;
+
+    SUNDRY_ASSERT(evs != NULL);
+    SUNDRY_ASSERT(count != NULL);
+
+    *count = 0;
+    if(max > ASYN_OS_PMAX) max = ASYN_OS_PMAX;
+    if(max == 0) return ASYN_DONE;
+
+    /* We do not restart epoll_wait() on EINTR because \timeout would not be
+     * correct anymore. An interrupted call simply reports no events.
+     */
+    res = epoll_wait(pfd, buf, max, timeout);
+    if(res < 0) {
+        switch(errno) {
+            case EINTR:
+                return ASYN_DONE;
+            case EBADF:
+            case EINVAL:
+                return ASYN_NOTSUPP;
+            default:
+                SUNDRY_DEBUG("epoll_wait(): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
+        }
+    }
+
+    for(i = 0; i < res; ++i) {
+        evs[i].events = 0;
+        if(buf[i].events & EPOLLIN) evs[i].events |= ASYN_OS_PIN;
+        if(buf[i].events & EPOLLOUT) evs[i].events |= ASYN_OS_POUT;
+        if(buf[i].events & (EPOLLERR | EPOLLHUP)) evs[i].events |= ASYN_OS_PERR;
+        evs[i].data = buf[i].data.ptr;
+    }
+    *count = res;
+    return ASYN_DONE;
+#else
+    *count = 0;
+    return ASYN_NOTSUPP;
+#endif
+}
+
+
+void asyn_os_poll_close(signed int pfd) {
+#ifdef ONS_POLL_EPOLL
+    /* Linux always releases the descriptor, even on EINTR. */
+    if(close(pfd) != 0 && errno != EINTR) {
+        SUNDRY_DEBUG("close(): Invalid ecode: %d", errno);
+    }
+#endif
+}
+
+
+unsigned int asyn_os_wake_init(signed int *wfd) {
+    SUNDRY_ASSERT(wfd != NULL);
+
+#ifdef ONS_POLL_EVENTFD
+    *wfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(*wfd < 0) {
+        switch(errno) {
+            case EINVAL:
+            case ENOSYS:
+            case ENODEV:
+                return ASYN_NOTSUPP;
+            case EMFILE:
+            case ENFILE:
+                return ASYN_TOOMANY;
+            case ENOMEM:
+                return ASYN_MEMFAIL;
+            default:
+                SUNDRY_DEBUG("eventfd(): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
+        }
+    }
+    return ASYN_DONE;
+#else
+    *wfd = -1;
+    return ASYN_NOTSUPP;
+#endif
+}
+
+
+void asyn_os_wake_signal(signed int wfd) {
+#ifdef ONS_POLL_EVENTFD
+    uint64_t val = 1;
+
+    /* EAGAIN means that the counter is saturated, so \wfd is readable anyway. */
+    ASYN_OS_SYSCALL((write(wfd, &val, sizeof(val)) >= 0));
+#endif
+}
+
+
+void asyn_os_wake_clear(signed int wfd) {
+#ifdef ONS_POLL_EVENTFD
+    uint64_t val;
+
+    /* Reading resets the counter to 0. EAGAIN means that it was already 0. */
+    ASYN_OS_SYSCALL((read(wfd, &val, sizeof(val)) >= 0));
+#endif
+}
+
+
+void asyn_os_wake_close(signed int wfd) {
+#ifdef ONS_POLL_EVENTFD
+    if(close(wfd) != 0 && errno != EINTR) {
+        SUNDRY_DEBUG("close(): Invalid ecode: %d", errno);
+    }
+#endif
+}
+
+
+size_t asyn_os_pagesize(void) {
+#ifdef ONS_CORO_GUARD
+    signed long size;
+
+    size = sysconf(_SC_PAGESIZE);
+    if(size > 0) return size;
+#endif
+    return 4096;
+}
+
+
+void *asyn_os_stack_alloc(size_t size) {
+#ifdef ONS_CORO_GUARD
+    unsigned char *base;
+    size_t page;
+
+    page = asyn_os_pagesize();
+    base = mmap(NULL, size + page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | ASYN_OS_MAP_STACK, -1, 0);
+    if(base == MAP_FAILED) {
+        if(errno != ENOMEM) SUNDRY_DEBUG("mmap(): Invalid ecode: %d", errno);
+        return NULL;
+    }
+
+    /* Stacks grow down on every supported architecture, so the guard is the lowest page. */
+    if(mprotect(base, page, PROT_NONE) != 0) {
+        SUNDRY_DEBUG("mprotect(): Invalid ecode: %d", errno);
+        munmap(base, size + page);
+        return NULL;
+    }
+    return base + page;
+#else
+    return malloc(size);
+#endif
+}
+
+
+void asyn_os_stack_free(void *stack, size_t size) {
+#ifdef ONS_CORO_GUARD
+    size_t page;
+
+    page = asyn_os_pagesize();
+    if(munmap((unsigned char*)stack - page, size + page) != 0) {
+        SUNDRY_DEBUG("munmap(): Invalid ecode: %d", errno);
+    }
+#else
+    free(stack);
+#endif
+}
+
+
+
 
 
 
@@ -0,0 +1,636 @@
+/*
+ * (COPYRIGHT) Copyright (C) 2008, 2009, The ONS Team.
+ * This file is part of ONS, see COPYING for details.
+ */
+
+/*
+ * File information:
+ * - Created: 17. October 2026
+ * - Lead-Dev: - David Herrmann
+ * - Contributors: /
+ * - Last-Change: 17. October 2026
+ */
+
+/* io_uring backend
+ * Implements the completion ring of backend.h with the linux io_uring interface.
+ * We do not depend on liburing but use the raw syscalls and map the rings
+ * ourself. The ring is only used by a single thread, so the only memory ordering
+ * we need is between us and the kernel.
+ * The following kernel features are used:
+ *  - fixed files (5.1, sparse updates 5.5)
+ *  - provided buffer rings (5.19)
+ *  - multishot recvmsg (6.0)
+ * If the kernel is too old, \asyn_os_ring_init fails with ASYN_NOTSUPP.
+ */
+
+
+#include "config/machine.h"
+#include "sundry/sundry.h"
+#include "asynchio/asynchio.h"
+#include "memoria/memoria.h"
+#include "backend.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef ONS_SOCKET_URING
+    #include <stdint.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <sys/uio.h>
+    #include <linux/io_uring.h>
+#endif
+
+
+#ifdef ONS_SOCKET_URING
+
+
+/* The kernel reads and writes the ring indices concurrently. */
+#define ASYN_OS_RLOAD(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define ASYN_OS_RSTORE(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+
+
+/* Every receive buffer starts with the header of the multishot recvmsg() which is
+ * followed by the source address and the control messages. The payload follows
+ * after them. The stride is rounded up so every buffer is well aligned.
+ */
+#define ASYN_OS_RHDR (sizeof(struct io_uring_recvmsg_out) + sizeof(struct sockaddr_storage) + ASYN_OS_CBUF)
+#define ASYN_OS_RALIGN 64
+
+
+/* An operation which is in flight. The kernel may access \hdr and everything it
+ * points to until the last completion of the operation is reported, therefore,
+ * they are stored here and not on the stack of the caller.
+ */
+typedef struct asyn_os_rreq_t {
+    unsigned int op;
+    void *data;
+    asyn_msg_t msg;
+    struct msghdr hdr;
+    struct iovec iov;
+    struct sockaddr_storage saddr;
+    asyn_os_cbuf_t cbuf;
+    struct asyn_os_rreq_t *next;
+} asyn_os_rreq_t;
+
+
+struct asyn_os_ring_t {
+    signed int fd;
+
+    /* Submission queue. \sqtail is our private tail which is published to the
+     * kernel when we enter it. \nsubmit is the number of entries which were not
+     * consumed by the kernel, yet.
+     */
+    void *sqmap;
+    size_t sqmap_size;
+    unsigned int *sq_head;
+    unsigned int *sq_tail;
+    unsigned int *sq_array;
+    unsigned int sq_mask;
+    unsigned int sq_entries;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned int sqtail;
+    unsigned int nsubmit;
+
+    /* Completion queue. \cqmap equals \sqmap if the kernel maps both rings together. */
+    void *cqmap;
+    size_t cqmap_size;
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int cq_mask;
+    struct io_uring_cqe *cqes;
+
+    /* Fixed file table. Free slots are -1. */
+    signed int *files;
+    unsigned int nfiles;
+
+    /* Provided buffer ring of buffer group 0. */
+    struct io_uring_buf_ring *br;
+    size_t br_size;
+    unsigned int br_mask;
+    unsigned short br_tail;
+    unsigned char *bufs;
+    size_t bufstride;
+
+    /* Pool of operations. */
+    asyn_os_rreq_t *reqs;
+    asyn_os_rreq_t *free;
+};
+
+
+/* Translates the errno of io_uring_setup() and io_uring_register() into an asynchio
+ * return code.
+ */
+static unsigned int asyn_os_ring_err(const char *call) {
+    switch(errno) {
+        case ENOSYS:
+        case EINVAL:
+        case EOPNOTSUPP:
+        case EFAULT:
+        case EBADF:
+        case EEXIST:
+            /* The kernel is too old or does not support the requested feature. */
+            return ASYN_NOTSUPP;
+        case EPERM:
+        case EACCES:
+            /* io_uring may be disabled by the admin (kernel.io_uring_disabled). */
+            return ASYN_DENIED;
+        case EMFILE:
+        case ENFILE:
+            return ASYN_TOOMANY;
+        case ENOMEM:
+        case ENOBUFS:
+            return ASYN_MEMFAIL;
+        default:
+            SUNDRY_DEBUG("%s: Invalid ecode: %d", call, errno);
+            return ASYN_SYSCALL;
+    }
+}
+
+
+/* Translates the negative errno \res of a completion into an asynchio return code. */
+static unsigned int asyn_os_ring_ioerr(signed int res) {
+    if(res == -ECANCELED) return ASYN_NONE;
+    errno = -res;
+    return asyn_os_ioerr("io_uring");
+}
+
+
+/* Passes all queued operations to the kernel and waits for \min completions. */
+static unsigned int asyn_os_ring_enter(struct asyn_os_ring_t *ring, unsigned int min) {
+    signed int res;
+    unsigned int flags = 0;
+
+    if(ring->nsubmit == 0 && min == 0) return ASYN_DONE;
+
+    ASYN_OS_RSTORE(ring->sq_tail, ring->sqtail);
+    if(min > 0) flags |= IORING_ENTER_GETEVENTS;
+    res = syscall(__NR_io_uring_enter, ring->fd, ring->nsubmit, min, flags, NULL, 0);
+    if(res < 0) {
+        switch(errno) {
+            case EINTR:
+                /* Nothing was submitted, the caller simply tries again later. */
+            case EAGAIN:
+            case EBUSY:
+                /* The completion queue is full; the caller has to reap it first. */
+                return ASYN_DONE;
+            case ENOMEM:
+                return ASYN_MEMFAIL;
+            default:
+                SUNDRY_DEBUG("io_uring_enter(): Invalid ecode: %d", errno);
+                return ASYN_SYSCALL;
+        }
+    }
+
+    /* The kernel stops at the first entry which it cannot consume. The other
+     * entries stay in the queue and are submitted with the next call.
+     */
+    ring->nsubmit -= ((unsigned int)res > ring->nsubmit)?ring->nsubmit:(unsigned int)res;
+    return ASYN_DONE;
+}
+
+
+/* Returns the next free submission entry or NULL if the queue is full. */
+static struct io_uring_sqe *asyn_os_ring_sqe(struct asyn_os_ring_t *ring) {
+    struct io_uring_sqe *sqe;
+    unsigned int idx;
+
+    if(ring->sqtail - ASYN_OS_RLOAD(ring->sq_head) >= ring->sq_entries) {
+        if(asyn_os_ring_enter(ring, 0) != ASYN_DONE) return NULL;
+        if(ring->sqtail - ASYN_OS_RLOAD(ring->sq_head) >= ring->sq_entries) return NULL;
+    }
+
+    idx = ring->sqtail & ring->sq_mask;
+    sqe = &ring->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[idx] = idx;
+    ++ring->sqtail;
+    ++ring->nsubmit;
+    return sqe;
+}
+
+
+unsigned int asyn_os_ring_init(struct asyn_os_ring_t **ring, unsigned int entries, size_t bufsize, unsigned int bufcount) {
+    struct asyn_os_ring_t *r;
+    struct io_uring_params params;
+    struct io_uring_buf_reg reg;
+    unsigned int i, nreqs, ret;
+    signed int res;
+
+    SUNDRY_ASSERT(ring != NULL);
+
+    if(entries == 0 || bufsize == 0 || bufcount == 0 || bufcount > 32768 || (bufcount & (bufcount - 1))) return ASYN_NOTSUPP;
+
+    r = mem_zmalloc(sizeof(*r));
+    r->fd = -1;
+
+    memset(&params, 0, sizeof(params));
+    r->fd = syscall(__NR_io_uring_setup, entries, &params);
+    if(r->fd < 0) {
+        ret = asyn_os_ring_err("io_uring_setup()");
+        goto failed;
+    }
+
+    /* Map the rings. Since 5.4 both rings are mapped with a single mmap(). */
+    r->sqmap_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    r->cqmap_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if(params.features & IORING_FEAT_SINGLE_MMAP) {
+        if(r->cqmap_size > r->sqmap_size) r->sqmap_size = r->cqmap_size;
+        r->cqmap_size = r->sqmap_size;
+    }
+    r->sqmap = mmap(NULL, r->sqmap_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    if(r->sqmap == MAP_FAILED) {
+        r->sqmap = NULL;
+        ret = asyn_os_ring_err("mmap()");
+        goto failed;
+    }
+    if(params.features & IORING_FEAT_SINGLE_MMAP) r->cqmap = r->sqmap;
+    else {
+        r->cqmap = mmap(NULL, r->cqmap_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+        if(r->cqmap == MAP_FAILED) {
+            r->cqmap = NULL;
+            ret = asyn_os_ring_err("mmap()");
+            goto failed;
+        }
+    }
+    r->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if(r->sqes == MAP_FAILED) {
+        r->sqes = NULL;
+        ret = asyn_os_ring_err("mmap()");
+        goto failed;
+    }
+
+    r->sq_head = (unsigned int*)((char*)r->sqmap + params.sq_off.head);
+    r->sq_tail = (unsigned int*)((char*)r->sqmap + params.sq_off.tail);
+    r->sq_array = (unsigned int*)((char*)r->sqmap + params.sq_off.array);
+    r->sq_mask = *(unsigned int*)((char*)r->sqmap + params.sq_off.ring_mask);
+    r->sq_entries = params.sq_entries;
+    r->sqtail = *r->sq_tail;
+    r->cq_head = (unsigned int*)((char*)r->cqmap + params.cq_off.head);
+    r->cq_tail = (unsigned int*)((char*)r->cqmap + params.cq_off.tail);
+    r->cq_mask = *(unsigned int*)((char*)r->cqmap + params.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe*)((char*)r->cqmap + params.cq_off.cqes);
+
+    /* Register an empty fixed file table which is filled by \asyn_os_ring_attach. */
+    r->nfiles = params.sq_entries;
+    r->files = mem_malloc(r->nfiles * sizeof(signed int));
+    for(i = 0; i < r->nfiles; ++i) r->files[i] = -1;
+    res = syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_FILES, r->files, r->nfiles);
+    if(res < 0) {
+        ret = asyn_os_ring_err("io_uring_register(FILES)");
+        goto failed;
+    }
+
+    /* Register the provided buffer ring. The ring itself must be page aligned. */
+    r->br_size = bufcount * sizeof(struct io_uring_buf);
+    r->br = mmap(NULL, r->br_size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if(r->br == MAP_FAILED) {
+        r->br = NULL;
+        ret = asyn_os_ring_err("mmap()");
+        goto failed;
+    }
+    r->br_mask = bufcount - 1;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uintptr_t)r->br;
+    reg.ring_entries = bufcount;
+    reg.bgid = 0;
+    res = syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_PBUF_RING, &reg, 1);
+    if(res < 0) {
+        ret = asyn_os_ring_err("io_uring_register(PBUF_RING)");
+        goto failed;
+    }
+
+    r->bufstride = (ASYN_OS_RHDR + bufsize + ASYN_OS_RALIGN - 1) & ~(size_t)(ASYN_OS_RALIGN - 1);
+    r->bufs = mem_malloc(bufcount * r->bufstride);
+    for(i = 0; i < bufcount; ++i) asyn_os_ring_recycle(r, i);
+
+    /* The completion queue is twice as big as the submission queue, so this is the
+     * maximum number of operations which can be in flight without overflowing it.
+     */
+    nreqs = params.cq_entries;
+    r->reqs = mem_malloc(nreqs * sizeof(asyn_os_rreq_t));
+    for(i = 0; i < nreqs; ++i) r->reqs[i].next = (i + 1 < nreqs)?&r->reqs[i + 1]:NULL;
+    r->free = r->reqs;
+
+    *ring = r;
+    return ASYN_DONE;
+
+    failed:
+    asyn_os_ring_free(r);
+    return ret;
+}
+
+
+void asyn_os_ring_free(struct asyn_os_ring_t *ring) {
+    SUNDRY_ASSERT(ring != NULL);
+
+    /* Closing the ring cancels all operations and drops all registrations. */
+    if(ring->fd >= 0) close(ring->fd);
+    if(ring->br) munmap(ring->br, ring->br_size);
+    if(ring->sqes) munmap(ring->sqes, ring->sqes_size);
+    if(ring->cqmap && ring->cqmap != ring->sqmap) munmap(ring->cqmap, ring->cqmap_size);
+    if(ring->sqmap) munmap(ring->sqmap, ring->sqmap_size);
+    mem_free(ring->reqs);
+    mem_free(ring->bufs);
+    mem_free(ring->files);
+    mem_free(ring);
+}
+
+
+unsigned int asyn_os_ring_attach(struct asyn_os_ring_t *ring, signed int fd, signed int *slot) {
+    struct io_uring_files_update up;
+    unsigned int i;
+    signed int res;
+
+    SUNDRY_ASSERT(ring != NULL);
+    SUNDRY_ASSERT(slot != NULL);
+
+    for(i = 0; i < ring->nfiles; ++i) {
+        if(ring->files[i] == -1) break;
+    }
+    if(i == ring->nfiles) return ASYN_TOOMANY;
+
+    memset(&up, 0, sizeof(up));
+    up.offset = i;
+    up.fds = (uintptr_t)&fd;
+    res = syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_FILES_UPDATE, &up, 1);
+    if(res < 0) return asyn_os_ring_err("io_uring_register(FILES_UPDATE)");
+
+    ring->files[i] = fd;
+    *slot = i;
+    return ASYN_DONE;
+}
+
+
+void asyn_os_ring_detach(struct asyn_os_ring_t *ring, signed int slot) {
+    struct io_uring_files_update up;
+    struct io_uring_sqe *sqe;
+    signed int res, fd = -1;
+
+    SUNDRY_ASSERT(ring != NULL);
+    SUNDRY_ASSERT(slot >= 0 && (unsigned int)slot < ring->nfiles);
+
+    /* Cancel everything on the slot. The operations hold their own reference to
+     * the file, so a multishot receive would never end without this.
+     * The cancel request itself has no data and its completion is ignored.
+     */
+    sqe = asyn_os_ring_sqe(ring);
+    if(sqe) {
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = slot;
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_FD_FIXED | IORING_ASYNC_CANCEL_ALL;
+        sqe->user_data = 0;
+        asyn_os_ring_enter(ring, 0);
+    }
+    else SUNDRY_DEBUG("asyn_os_ring_detach(): Submission queue is full, cannot cancel slot %d", slot);
+
+    memset(&up, 0, sizeof(up));
+    up.offset = slot;
+    up.fds = (uintptr_t)&fd;
+    res = syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_FILES_UPDATE, &up, 1);
+    if(res < 0) SUNDRY_DEBUG("io_uring_register(FILES_UPDATE): Invalid ecode: %d", errno);
+    ring->files[slot] = -1;
+}
+
+
+unsigned int asyn_os_ring_recv(struct asyn_os_ring_t *ring, signed int slot, void *data) {
+    struct io_uring_sqe *sqe;
+    asyn_os_rreq_t *req;
+
+    SUNDRY_ASSERT(ring != NULL);
+
+    if(!ring->free) return ASYN_TOOMANY;
+    sqe = asyn_os_ring_sqe(ring);
+    if(!sqe) return ASYN_TOOMANY;
+    req = ring->free;
+    ring->free = req->next;
+
+    /* With multishot receives the kernel only reads the sizes of the address and
+     * control buffers. It reserves this space in front of the payload of every
+     * provided buffer.
+     */
+    req->op = ASYN_RING_RECV;
+    req->data = data;
+    memset(&req->hdr, 0, sizeof(req->hdr));
+    req->hdr.msg_namelen = sizeof(struct sockaddr_storage);
+    req->hdr.msg_controllen = ASYN_OS_CBUF;
+
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = slot;
+    sqe->flags = IOSQE_FIXED_FILE | IOSQE_BUFFER_SELECT;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->addr = (uintptr_t)&req->hdr;
+    sqe->len = 1;
+    sqe->buf_group = 0;
+    sqe->user_data = (uintptr_t)req;
+    return ASYN_DONE;
+}
+
+
+unsigned int asyn_os_ring_send(struct asyn_os_ring_t *ring, signed int slot, const asyn_msg_t *msg, void *data) {
+    struct io_uring_sqe *sqe;
+    asyn_os_rreq_t *req;
+    unsigned int ret;
+
+    SUNDRY_ASSERT(ring != NULL);
+    SUNDRY_ASSERT(msg != NULL);
+
+    if(!ring->free) return ASYN_TOOMANY;
+    req = ring->free;
+
+    memset(&req->hdr, 0, sizeof(req->hdr));
+    req->iov.iov_base = msg->buf;
+    req->iov.iov_len = msg->size;
+    if(msg->addr.type != ASYN_NOADDR) {
+        req->hdr.msg_name = &req->saddr;
+        req->hdr.msg_namelen = asyn_os_mksaddr(&req->saddr, msg->addr.type, msg->addr.ip, msg->addr.port);
+    }
+    req->hdr.msg_iov = &req->iov;
+    req->hdr.msg_iovlen = 1;
+    ret = asyn_os_cmsg_write(&req->hdr, &req->cbuf, msg);
+    if(ret != ASYN_DONE) return ret;
+
+    sqe = asyn_os_ring_sqe(ring);
+    if(!sqe) return ASYN_TOOMANY;
+    ring->free = req->next;
+    req->op = ASYN_RING_SEND;
+    req->data = data;
+    memcpy(&req->msg, msg, sizeof(*msg));
+
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = slot;
+    sqe->flags = IOSQE_FIXED_FILE;
+    sqe->addr = (uintptr_t)&req->hdr;
+    sqe->len = 1;
+    sqe->user_data = (uintptr_t)req;
+    return ASYN_DONE;
+}
+
+
+/* Fills \ev with the completion \cqe of the receive operation \req. */
+static void asyn_os_ring_rdone(struct asyn_os_ring_t *ring, asyn_os_rreq_t *req, struct io_uring_cqe *cqe, asyn_ring_ev_t *ev) {
+    struct io_uring_recvmsg_out out;
+    struct sockaddr_storage saddr;
+    struct msghdr hdr;
+    unsigned char *buf;
+    size_t off, avail;
+
+    ev->msg.buf = NULL;
+    ev->msg.size = 0;
+    ev->msg.segsize = 0;
+    ev->msg.flags = 0;
+    ev->msg.addr.type = ASYN_NOADDR;
+
+    if(cqe->res < 0) {
+        ev->ret = asyn_os_ring_ioerr(cqe->res);
+        return;
+    }
+    if(!(cqe->flags & IORING_CQE_F_BUFFER)) {
+        SUNDRY_DEBUG("io_uring: Receive completion without buffer");
+        ev->ret = ASYN_SYSCALL;
+        return;
+    }
+
+    ev->bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+    buf = ring->bufs + ev->bid * ring->bufstride;
+
+    /* The buffer layout is: header, address, control messages, payload. The
+     * address area is copied, because it is not aligned for struct sockaddr.
+     */
+    memcpy(&out, buf, sizeof(out));
+    off = sizeof(out);
+    memset(&saddr, 0, sizeof(saddr));
+    memcpy(&saddr, buf + off, (out.namelen > sizeof(saddr))?sizeof(saddr):out.namelen);
+    asyn_os_readsaddr(&saddr, out.namelen, &ev->msg.addr);
+    off += req->hdr.msg_namelen;
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_control = buf + off;
+    hdr.msg_controllen = out.controllen;
+    off += req->hdr.msg_controllen;
+
+    avail = ((size_t)cqe->res > off)?(size_t)cqe->res - off:0;
+    ev->msg.buf = buf + off;
+    ev->msg.size = (out.payloadlen > avail)?avail:out.payloadlen;
+    if((out.flags & MSG_TRUNC) || out.payloadlen > avail) ev->msg.flags |= ASYN_MSG_TRUNC;
+    asyn_os_cmsg_read(&hdr, &ev->msg);
+    ev->ret = ASYN_DONE;
+}
+
+
+unsigned int asyn_os_ring_wait(struct asyn_os_ring_t *ring, unsigned int min, asyn_ring_ev_t *evs, unsigned int max, unsigned int *count) {
+    struct io_uring_cqe *cqe;
+    asyn_os_rreq_t *req;
+    asyn_ring_ev_t *ev;
+    unsigned int head, tail, ret;
+
+    SUNDRY_ASSERT(ring != NULL);
+    SUNDRY_ASSERT(evs != NULL);
+    SUNDRY_ASSERT(count != NULL);
+
+    *count = 0;
+
+    /* Never sleep if there are completions left from the last call. */
+    head = *ring->cq_head;
+    tail = ASYN_OS_RLOAD(ring->cq_tail);
+    ret = asyn_os_ring_enter(ring, (head == tail)?min:0);
+    if(ret != ASYN_DONE) return ret;
+    tail = ASYN_OS_RLOAD(ring->cq_tail);
+
+    while(head != tail && *count < max) {
+        cqe = &ring->cqes[head & ring->cq_mask];
+        ++head;
+
+        /* Cancel requests have no data. */
+        req = (asyn_os_rreq_t*)(uintptr_t)cqe->user_data;
+        if(!req) continue;
+
+        ev = &evs[(*count)++];
+        ev->op = req->op;
+        ev->arg = req->data;
+        ev->more = (cqe->flags & IORING_CQE_F_MORE)?1:0;
+        ev->bid = -1;
+        if(req->op == ASYN_RING_RECV) asyn_os_ring_rdone(ring, req, cqe, ev);
+        else {
+            memcpy(&ev->msg, &req->msg, sizeof(ev->msg));
+            if(cqe->res < 0) {
+                ev->ret = asyn_os_ring_ioerr(cqe->res);
+                ev->msg.size = 0;
+            }
+            else {
+                ev->ret = ASYN_DONE;
+                ev->msg.size = cqe->res;
+            }
+        }
+
+        if(!ev->more) {
+            req->next = ring->free;
+            ring->free = req;
+        }
+    }
+
+    ASYN_OS_RSTORE(ring->cq_head, head);
+    return ASYN_DONE;
+}
+
+
+void asyn_os_ring_recycle(struct asyn_os_ring_t *ring, signed int bid) {
+    struct io_uring_buf *buf;
+
+    SUNDRY_ASSERT(ring != NULL);
+    SUNDRY_ASSERT(bid >= 0 && (unsigned int)bid <= ring->br_mask);
+
+    buf = &ring->br->bufs[ring->br_tail & ring->br_mask];
+    buf->addr = (uintptr_t)(ring->bufs + bid * ring->bufstride);
+    buf->len = ring->bufstride;
+    buf->bid = bid;
+    ++ring->br_tail;
+    ASYN_OS_RSTORE(&ring->br->tail, ring->br_tail);
+}
+
+
+#else /* !ONS_SOCKET_URING */
+
+
+unsigned int asyn_os_ring_init(struct asyn_os_ring_t **ring, unsigned int entries, size_t bufsize, unsigned int bufcount) {
+    return ASYN_NOTSUPP;
+}
+
+
+void asyn_os_ring_free(struct asyn_os_ring_t *ring) {
+}
+
+
+unsigned int asyn_os_ring_attach(struct asyn_os_ring_t *ring, signed int fd, signed int *slot) {
+    return ASYN_NOTSUPP;
+}
+
+
+void asyn_os_ring_detach(struct asyn_os_ring_t *ring, signed int slot) {
+}
+
+
+unsigned int asyn_os_ring_recv(struct asyn_os_ring_t *ring, signed int slot, void *data) {
+    return ASYN_NOTSUPP;
+}
+
+
+unsigned int asyn_os_ring_send(struct asyn_os_ring_t *ring, signed int slot, const asyn_msg_t *msg, void *data) {
+    return ASYN_NOTSUPP;
+}
+
+
+unsigned int asyn_os_ring_wait(struct asyn_os_ring_t *ring, unsigned int min, asyn_ring_ev_t *evs, unsigned int max, unsigned int *count) {
+    return ASYN_NOTSUPP;
+}
+
+
+void asyn_os_ring_recycle(struct asyn_os_ring_t *ring, signed int bid) {
+}
+
+
+#endif /* ONS_SOCKET_URING */
@@ -0,0 +1,332 @@
+/*
+ * (COPYRIGHT) Copyright (C) 2008, 2009, The ONS Team.
+ * This file is part of ONS, see COPYING for details.
+ */
+
+/*
+ * File information:
+ * - Created: 17. October 2026
+ * - Lead-Dev: - David Herrmann
+ * - Contributors: /
+ * - Last-Change: 17. October 2026
+ */
+
+/* UDP send queues
+ * Bounded ring of datagrams which a blocked UDP socket could not take. The
+ * slots are allocated once with their buffers, so queuing only copies the
+ * payload. The ring is flushed with the batch send function.
+ * Pacers put a token bucket in front of the ring and release the datagrams
+ * with a timer of the loop's timing wheel.
+ */
+
+
+#include "config/machine.h"
+#include "sundry/sundry.h"
+#include "asynchio/asynchio.h"
+#include "memoria/memoria.h"
+#include "backend.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+/* Removes the oldest datagram and calls the low watermark callback if the queue
+ * drained far enough.
+ */
+static void asyn_outq_pop(asyn_outq_t *outq, unsigned int num) {
+    outq->head = (outq->head + num) % outq->count;
+    outq->queued -= num;
+
+    if(outq->pressure && outq->queued <= outq->low) {
+        outq->pressure = 0;
+        if(outq->fn) outq->fn(outq, ASYN_OUTQ_LOW);
+    }
+}
+
+
+/* Copies the datagram into the next free slot. The ring must not be full. */
+static void asyn_outq_push(asyn_outq_t *outq, const void *buf, size_t size, const asyn_addr_t *addr) {
+    asyn_msg_t *msg;
+
+    msg = &outq->msgs[(outq->head + outq->queued) % outq->count];
+    memcpy(msg->buf, buf, size);
+    msg->size = size;
+    msg->segsize = 0;
+    msg->flags = 0;
+    if(addr) memcpy(&msg->addr, addr, sizeof(*addr));
+    else msg->addr.type = ASYN_NOADDR;
+    ++outq->queued;
+
+    if(!outq->pressure && outq->queued >= outq->high) {
+        outq->pressure = 1;
+        if(outq->fn) outq->fn(outq, ASYN_OUTQ_HIGH);
+    }
+}
+
+
+void asyn_outq_init(asyn_outq_t *outq, asyn_udp_t *udp, unsigned int count, size_t bufsize) {
+    unsigned int i;
+
+    SUNDRY_ASSERT(outq != NULL);
+    SUNDRY_ASSERT(udp != NULL);
+    SUNDRY_ASSERT(count > 0);
+    SUNDRY_ASSERT(bufsize > 0);
+
+    memset(outq, 0, sizeof(*outq));
+    outq->udp = udp;
+    outq->count = count;
+    outq->bufsize = bufsize;
+    outq->policy = ASYN_OUTQ_REPORT;
+    outq->high = count - count / 4;
+    outq->low = count / 4;
+
+    outq->msgs = mem_zmalloc(count * sizeof(asyn_msg_t));
+    outq->bufs = mem_malloc(count * bufsize);
+    for(i = 0; i < count; ++i) outq->msgs[i].buf = &outq->bufs[i * bufsize];
+}
+
+
+void asyn_outq_free(asyn_outq_t *outq) {
+    SUNDRY_ASSERT(outq != NULL);
+
+    mem_free(outq->msgs);
+    mem_free(outq->bufs);
+    outq->msgs = NULL;
+    outq->bufs = NULL;
+    outq->queued = 0;
+    outq->count = 0;
+}
+
+
+/* Queues the datagram without trying the socket and applies the overflow policy.
+ * A datagram which does not fit into a slot can never be queued, so retrying would
+ * not help; it is refused like the kernel refuses an oversized datagram.
+ */
+static unsigned int asyn_outq_hold(asyn_outq_t *outq, const void *buf, size_t size, const asyn_addr_t *addr) {
+    if(size > outq->bufsize) return ASYN_FAILED;
+
+    if(outq->queued == outq->count) {
+        switch(outq->policy) {
+            case ASYN_OUTQ_DROPNEW:
+                ++outq->dropped;
+                return ASYN_DONE;
+            case ASYN_OUTQ_DROPOLD:
+                ++outq->dropped;
+                asyn_outq_pop(outq, 1);
+                break;
+            default:
+                return ASYN_BLOCKED;
+        }
+    }
+
+    asyn_outq_push(outq, buf, size, addr);
+    return ASYN_DONE;
+}
+
+
+/* Sends the \num oldest datagrams, which must not wrap around the end of the ring,
+ * with a single call. The number of sent bytes is saved in \bytes. Returns ASYN_DONE
+ * if datagrams were sent or dropped, otherwise the error of the call.
+ */
+static unsigned int asyn_outq_batch(asyn_outq_t *outq, unsigned int num, size_t *bytes) {
+    unsigned int ret, done, i;
+
+    *bytes = 0;
+    ret = asyn_udp_send_batch(outq->udp, &outq->msgs[outq->head], num, &done);
+    if(done > 0) {
+        for(i = 0; i < done; ++i) *bytes += outq->msgs[outq->head + i].size;
+        asyn_outq_pop(outq, done);
+        return ASYN_DONE;
+    }
+
+    switch(ret) {
+        case ASYN_BLOCKED:
+        case ASYN_SYSCALL:
+            return ret;
+        default:
+            /* The kernel refused the oldest datagram, retrying would not help. */
+            ++outq->failed;
+            asyn_outq_pop(outq, 1);
+            return ASYN_DONE;
+    }
+}
+
+
+unsigned int asyn_outq_send(asyn_outq_t *outq, const void *buf, size_t size, const asyn_addr_t *addr) {
+    unsigned int ret;
+    size_t sent;
+
+    SUNDRY_ASSERT(outq != NULL);
+    SUNDRY_ASSERT(buf != NULL);
+
+    /* Queued datagrams go first, so we do not even try the socket. */
+    if(outq->queued == 0) {
+        sent = size;
+        ret = asyn_udp_send(outq->udp, buf, &sent, addr);
+        if(ret != ASYN_BLOCKED) return ret;
+    }
+
+    return asyn_outq_hold(outq, buf, size, addr);
+}
+
+
+unsigned int asyn_outq_flush(asyn_outq_t *outq) {
+    unsigned int ret, num;
+    size_t bytes;
+
+    SUNDRY_ASSERT(outq != NULL);
+
+    if(outq->queued == 0) return ASYN_BLOCKED;
+
+    /* Only the part up to the end of the ring is contiguous. The rest is sent with
+     * the next call.
+     */
+    num = outq->count - outq->head;
+    if(num > outq->queued) num = outq->queued;
+    if(num > ASYN_OUTQ_BATCH) num = ASYN_OUTQ_BATCH;
+
+    ret = asyn_outq_batch(outq, num, &bytes);
+    if(ret != ASYN_DONE) return ret;
+    return outq->queued?ASYN_DONE:ASYN_BLOCKED;
+}
+
+
+/* Adds the tokens which accumulated since the last refill. Only whole tokens are
+ * credited, so the stamp only advances by the time they cover. Otherwise frequent
+ * calls at low rates would throw the fractions away and never earn a token.
+ */
+static void asyn_pacer_refill(asyn_pacer_t *pacer) {
+    uint64_t now, elapsed, added;
+
+    now = asyn_os_clock();
+    elapsed = now - pacer->stamp;
+
+    /* Split into seconds and the rest, so high rates cannot overflow. */
+    added = (elapsed / 1000000000) * pacer->rate;
+    added += (elapsed % 1000000000) * pacer->rate / 1000000000;
+    if(pacer->tokens + added >= pacer->burst) {
+        pacer->tokens = pacer->burst;
+        pacer->stamp = now;
+        return;
+    }
+
+    pacer->tokens += added;
+    pacer->stamp += (added * 1000000000 + pacer->rate - 1) / pacer->rate;
+}
+
+
+/* Arms the timer for the time until the oldest waiting datagram can be sent. */
+static void asyn_pacer_arm(asyn_pacer_t *pacer) {
+    uint64_t missing, ms;
+
+    missing = pacer->queue.msgs[pacer->queue.head].size;
+    missing = (missing > pacer->tokens)?missing - pacer->tokens:0;
+    ms = (missing * 1000 + pacer->rate - 1) / pacer->rate;
+    asyn_timer_arm(pacer->wheel, &pacer->timer, ms?ms:1);
+}
+
+
+static void asyn_pacer_expire(asyn_wheel_t *wheel, asyn_timer_t *timer) {
+    asyn_pacer_t *pacer = timer->arg;
+
+    /* A blocked socket is left to the write callback. */
+    while(asyn_pacer_flush(pacer) == ASYN_DONE) /* empty */ ;
+}
+
+
+void asyn_pacer_init(asyn_pacer_t *pacer, asyn_udp_t *udp, asyn_wheel_t *wheel, uint64_t rate, size_t burst, unsigned int count, size_t bufsize, unsigned int opts) {
+    SUNDRY_ASSERT(pacer != NULL);
+    SUNDRY_ASSERT(wheel != NULL);
+
+    memset(pacer, 0, sizeof(*pacer));
+    asyn_outq_init(&pacer->queue, udp, count, bufsize);
+    asyn_timer_init(&pacer->timer, asyn_pacer_expire, pacer);
+    pacer->wheel = wheel;
+    asyn_pacer_rate(pacer, rate, burst);
+    pacer->tokens = pacer->burst;
+    pacer->stamp = asyn_os_clock();
+
+    if(opts & ASYN_PACER_KERNEL) pacer->kernel = (asyn_os_setpacing(udp->fd, pacer->rate) == ASYN_DONE);
+}
+
+
+void asyn_pacer_free(asyn_pacer_t *pacer) {
+    SUNDRY_ASSERT(pacer != NULL);
+
+    asyn_timer_cancel(&pacer->timer);
+    if(pacer->kernel) asyn_os_setpacing(pacer->queue.udp->fd, 0);
+    asyn_outq_free(&pacer->queue);
+}
+
+
+void asyn_pacer_rate(asyn_pacer_t *pacer, uint64_t rate, size_t burst) {
+    SUNDRY_ASSERT(pacer != NULL);
+    SUNDRY_ASSERT(rate > 0);
+
+    if(burst == 0) burst = (rate / 1000 > 65536)?rate / 1000:65536;
+
+    /* The bucket never holds more than \burst tokens, so a queued datagram which is
+     * bigger would wait forever.
+     */
+    if(burst < pacer->queue.bufsize) burst = pacer->queue.bufsize;
+    pacer->rate = rate;
+    pacer->burst = burst;
+    if(pacer->tokens > burst) pacer->tokens = burst;
+    if(pacer->kernel) asyn_os_setpacing(pacer->queue.udp->fd, rate);
+}
+
+
+unsigned int asyn_pacer_send(asyn_pacer_t *pacer, const void *buf, size_t size, const asyn_addr_t *addr) {
+    unsigned int ret;
+    size_t sent;
+
+    SUNDRY_ASSERT(pacer != NULL);
+    SUNDRY_ASSERT(buf != NULL);
+
+    if(pacer->kernel) return asyn_outq_send(&pacer->queue, buf, size, addr);
+
+    asyn_pacer_refill(pacer);
+    if(pacer->queue.queued == 0 && pacer->tokens >= size) {
+        sent = size;
+        ret = asyn_udp_send(pacer->queue.udp, buf, &sent, addr);
+        if(ret == ASYN_DONE) pacer->tokens -= size;
+        if(ret != ASYN_BLOCKED) return ret;
+    }
+    else ++pacer->delays;
+
+    ret = asyn_outq_hold(&pacer->queue, buf, size, addr);
+    if(pacer->queue.queued > 0 && !asyn_timer_armed(&pacer->timer)) asyn_pacer_arm(pacer);
+    return ret;
+}
+
+
+unsigned int asyn_pacer_flush(asyn_pacer_t *pacer) {
+    asyn_outq_t *outq = &pacer->queue;
+    unsigned int ret, num, max;
+    uint64_t bytes;
+    size_t sent;
+
+    SUNDRY_ASSERT(pacer != NULL);
+
+    if(pacer->kernel) return asyn_outq_flush(outq);
+    if(outq->queued == 0) return ASYN_BLOCKED;
+
+    /* Take as many datagrams as the bucket allows. */
+    asyn_pacer_refill(pacer);
+    max = outq->count - outq->head;
+    if(max > outq->queued) max = outq->queued;
+    if(max > ASYN_OUTQ_BATCH) max = ASYN_OUTQ_BATCH;
+    for(num = 0, bytes = 0; num < max; ++num) {
+        if(bytes + outq->msgs[outq->head + num].size > pacer->tokens) break;
+        bytes += outq->msgs[outq->head + num].size;
+    }
+    if(num == 0) {
+        asyn_pacer_arm(pacer);
+        return ASYN_BLOCKED;
+    }
+
+    ret = asyn_outq_batch(outq, num, &sent);
+    pacer->tokens -= sent;
+    if(ret != ASYN_DONE) return ret;
+    return outq->queued?ASYN_DONE:ASYN_BLOCKED;
+}
@@ -0,0 +1,152 @@
+/*
+ * (COPYRIGHT) Copyright (C) 2008, 2009, The ONS Team.
+ * This file is part of ONS, see COPYING for details.
+ */
+
+/*
+ * File information:
+ * - Created: 17. October 2026
+ * - Lead-Dev: - David Herrmann
+ * - Contributors: /
+ * - Last-Change: 17. October 2026
+ */
+
+/* Submission queues
+ * Multi-producer/single-consumer queue which hands requests to the thread
+ * owning an event loop. Producers push onto a lock-free list, the consumer
+ * takes the whole list at once, so a plain CAS push is free of the ABA
+ * problem. The loop is only woken up on the empty to non-empty transition.
+ */
+
+
+#include "config/machine.h"
+#include "sundry/sundry.h"
+#include "sundry/atomic.h"
+#include "asynchio/asynchio.h"
+#include "memoria/memoria.h"
+#include "backend.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+/* Sends the \count posts in \posts which all share the same socket and calls
+ * their callbacks.
+ */
+static void asyn_queue_send(asyn_queue_t *queue, asyn_post_t **posts, unsigned int count) {
+    asyn_msg_t msgs[ASYN_OS_MMSG];
+    unsigned int i, off, done, ret;
+
+    for(i = 0; i < count; ++i) memcpy(&msgs[i], &posts[i]->msg, sizeof(msgs[i]));
+
+    /* A failed datagram is reported in its \ret member and skipped. */
+    for(off = 0; off < count; off += done) {
+        ret = asyn_udp_send_batch(posts[0]->udp, &msgs[off], count - off, &done);
+        if(done == 0) {
+            msgs[off].ret = ret;
+            done = 1;
+        }
+    }
+
+    for(i = 0; i < count; ++i) {
+        posts[i]->msg.ret = msgs[i].ret;
+        if(posts[i]->fn) posts[i]->fn(queue, posts[i]);
+    }
+}
+
+
+size_t asyn_queue_run(asyn_queue_t *queue) {
+    asyn_post_t *list, *post, *next, *batch[ASYN_OS_MMSG];
+    unsigned int count = 0;
+    size_t num = 0;
+
+    SUNDRY_ASSERT(queue != NULL);
+
+    /* The list is in reverse posting order, so we reverse it first. */
+    list = NULL;
+    post = sundry_atomic_xchgptr(&queue->head, NULL);
+    for(; post; post = next) {
+        next = post->next;
+        post->next = list;
+        list = post;
+    }
+
+    /* The callbacks may free or repost a post, so \next is saved before. */
+    for(post = list; post; post = next) {
+        next = post->next;
+        post->next = NULL;
+        ++num;
+
+        if(count > 0 && (count == ASYN_OS_MMSG || batch[0]->udp != post->udp)) {
+            asyn_queue_send(queue, batch, count);
+            count = 0;
+        }
+
+        if(post->udp) batch[count++] = post;
+        else post->fn(queue, post);
+    }
+    if(count > 0) asyn_queue_send(queue, batch, count);
+
+    return num;
+}
+
+
+/* Read callback of the wakeup descriptor. */
+static unsigned int asyn_queue_wakeup(asyn_loop_t *loop, asyn_ev_t *ev) {
+    asyn_queue_t *queue = ev->arg;
+
+    /* The descriptor must be cleared before the list is taken. Otherwise, a producer
+     * could signal it in between and we would drop its wakeup.
+     */
+    asyn_os_wake_clear(ev->fd);
+    asyn_queue_run(queue);
+    return ASYN_BLOCKED;
+}
+
+
+unsigned int asyn_queue_init(asyn_queue_t *queue, asyn_loop_t *loop) {
+    signed int fd;
+    unsigned int ret;
+
+    SUNDRY_ASSERT(queue != NULL);
+    SUNDRY_ASSERT(loop != NULL);
+
+    memset(queue, 0, sizeof(*queue));
+    ret = asyn_os_wake_init(&fd);
+    if(ret != ASYN_DONE) return ret;
+
+    asyn_ev_init(&queue->ev, fd, asyn_queue_wakeup, NULL, queue);
+    ret = asyn_loop_add(loop, &queue->ev, ASYN_EV_READ);
+    if(ret != ASYN_DONE) {
+        asyn_os_wake_close(fd);
+        return ret;
+    }
+
+    return ASYN_DONE;
+}
+
+
+void asyn_queue_free(asyn_queue_t *queue) {
+    SUNDRY_ASSERT(queue != NULL);
+
+    asyn_loop_del(&queue->ev);
+    asyn_queue_run(queue);
+    asyn_os_wake_close(queue->ev.fd);
+    queue->ev.fd = -1;
+}
+
+
+void asyn_queue_post(asyn_queue_t *queue, asyn_post_t *post) {
+    void *head;
+
+    SUNDRY_ASSERT(queue != NULL);
+    SUNDRY_ASSERT(post != NULL);
+    SUNDRY_MASSERT(post->udp != NULL || post->fn != NULL, "asyn_queue_post(): Closure without callback.");
+
+    do {
+        head = sundry_atomic_loadptr(&queue->head);
+        post->next = head;
+    } while(!sundry_atomic_casptr(&queue->head, head, post));
+
+    if(!head) asyn_os_wake_signal(queue->ev.fd);
+}
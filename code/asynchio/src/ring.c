@@ -0,0 +1,117 @@
+/*
+ * (COPYRIGHT) Copyright (C) 2008, 2009, The ONS Team.
+ * This file is part of ONS, see COPYING for details.
+ */
+
+/*
+ * File information:
+ * - Created: 17. October 2026
+ * - Lead-Dev: - David Herrmann
+ * - Contributors: /
+ * - Last-Change: 17. October 2026
+ */
+
+/* Completion ring
+ * Dispatches the completions of the asyn_os_ring_* backend to the user's
+ * callback. The platform specific parts live in "os_uring.c".
+ */
+
+
+#include "config/machine.h"
+#include "sundry/sundry.h"
+#include "asynchio/asynchio.h"
+#include "backend.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+unsigned int asyn_ring_init(asyn_ring_t *ring, unsigned int entries, size_t bufsize, unsigned int bufcount, asyn_ring_fn_t fn) {
+    SUNDRY_ASSERT(ring != NULL);
+    SUNDRY_ASSERT(fn != NULL);
+
+    memset(ring, 0, sizeof(*ring));
+    ring->fn = fn;
+    return asyn_os_ring_init(&ring->os, entries, bufsize, bufcount);
+}
+
+
+void asyn_ring_free(asyn_ring_t *ring) {
+    SUNDRY_ASSERT(ring != NULL);
+
+    if(ring->os) asyn_os_ring_free(ring->os);
+    ring->os = NULL;
+}
+
+
+unsigned int asyn_ring_attach(asyn_ring_t *ring, asyn_udp_t *udp) {
+    SUNDRY_ASSERT(ring != NULL);
+    SUNDRY_ASSERT(udp != NULL);
+    SUNDRY_MASSERT(udp->slot < 0, "asyn_ring_attach(): Object is already attached.");
+
+    return asyn_os_ring_attach(ring->os, udp->fd, &udp->slot);
+}
+
+
+void asyn_ring_detach(asyn_ring_t *ring, asyn_udp_t *udp) {
+    SUNDRY_ASSERT(ring != NULL);
+    SUNDRY_ASSERT(udp != NULL);
+
+    if(udp->slot < 0) return;
+    asyn_os_ring_detach(ring->os, udp->slot);
+    udp->slot = -1;
+}
+
+
+unsigned int asyn_ring_recv(asyn_ring_t *ring, asyn_udp_t *udp, void *arg) {
+    SUNDRY_ASSERT(ring != NULL);
+    SUNDRY_ASSERT(udp != NULL);
+    SUNDRY_MASSERT(udp->slot >= 0, "asyn_ring_recv(): Object is not attached.");
+
+    return asyn_os_ring_recv(ring->os, udp->slot, arg);
+}
+
+
+unsigned int asyn_ring_send(asyn_ring_t *ring, asyn_udp_t *udp, const asyn_msg_t *msg, void *arg) {
+    SUNDRY_ASSERT(ring != NULL);
+    SUNDRY_ASSERT(udp != NULL);
+    SUNDRY_MASSERT(udp->slot >= 0, "asyn_ring_send(): Object is not attached.");
+
+    return asyn_os_ring_send(ring->os, udp->slot, msg, arg);
+}
+
+
+unsigned int asyn_ring_run_once(asyn_ring_t *ring, unsigned int wait) {
+    asyn_ring_ev_t evs[ASYN_OS_RMAX];
+    unsigned int ret, count, i;
+
+    SUNDRY_ASSERT(ring != NULL);
+
+    ret = asyn_os_ring_wait(ring->os, wait?1:0, evs, ASYN_OS_RMAX, &count);
+    if(ret != ASYN_DONE) return ret;
+
+    /* The completions are already removed from the kernel's queue, so the callback
+     * may queue new operations. The receive buffer is handed back after the callback.
+     */
+    for(i = 0; i < count; ++i) {
+        ring->fn(ring, &evs[i]);
+        if(evs[i].bid >= 0) asyn_os_ring_recycle(ring->os, evs[i].bid);
+    }
+
+    return ASYN_DONE;
+}
+
+
+unsigned int asyn_ring_run(asyn_ring_t *ring) {
+    unsigned int ret;
+
+    SUNDRY_ASSERT(ring != NULL);
+
+    ring->stop = 0;
+    while(!ring->stop) {
+        ret = asyn_ring_run_once(ring, 1);
+        if(ret != ASYN_DONE) return ret;
+    }
+    ring->stop = 0;
+    return ASYN_DONE;
+}
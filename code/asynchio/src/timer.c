@@ -0,0 +1,223 @@
+/*
+ * (COPYRIGHT) Copyright (C) 2008, 2009, The ONS Team.
+ * This file is part of ONS, see COPYING for details.
+ */
+
+/*
+ * File information:
+ * - Created: 17. October 2026
+ * - Lead-Dev: - David Herrmann
+ * - Contributors: /
+ * - Last-Change: 17. October 2026
+ */
+
+/* Timing wheel
+ * Hierarchical timing wheel with ASYN_WHEEL_LEVELS levels. Every slot is
+ * a double linked list of timers, so a timer is armed and cancelled without
+ * searching. Level \l holds the timers which expire within
+ * ASYN_WHEEL_SLOTS^(l+1) ticks; their slot is picked with the \l-th byte of
+ * the expiry tick. Whenever level \l wraps around, the current slot of level
+ * \l+1 is cascaded into the lower levels.
+ */
+
+
+#include "config/machine.h"
+#include "sundry/sundry.h"
+#include "asynchio/asynchio.h"
+#include "memoria/memoria.h"
+#include "backend.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+#define ASYN_WHEEL_BITS 8
+#define ASYN_WHEEL_MASK (ASYN_WHEEL_SLOTS - 1)
+#define ASYN_WHEEL_MAX ((((uint64_t)1) << (ASYN_WHEEL_BITS * ASYN_WHEEL_LEVELS)) - 1)
+
+
+/* Returns the monotonic clock in milliseconds. The wall clock may be stepped in
+ * both directions which would fire timers early or stall the wheel.
+ */
+static uint64_t asyn_wheel_clock(void) {
+    return asyn_os_clock() / 1000000;
+}
+
+
+/* Links \timer into the slot of its expiry tick. */
+static void asyn_wheel_insert(asyn_wheel_t *wheel, asyn_timer_t *timer) {
+    uint64_t delta;
+    unsigned int level;
+
+    delta = timer->expire - wheel->now;
+    for(level = 0; level < ASYN_WHEEL_LEVELS - 1; ++level) {
+        if(delta < ((uint64_t)1 << (ASYN_WHEEL_BITS * (level + 1)))) break;
+    }
+
+    timer->level = level;
+    timer->slot = &wheel->slots[level][(timer->expire >> (ASYN_WHEEL_BITS * level)) & ASYN_WHEEL_MASK];
+    mem_llist_nbn_push(timer->slot, timer);
+    ++wheel->count[level];
+}
+
+
+/* Moves all timers of slot \idx of level \level into the lower levels. */
+static void asyn_wheel_cascade(asyn_wheel_t *wheel, unsigned int level, unsigned int idx) {
+    asyn_wslot_t *slot = &wheel->slots[level][idx];
+    asyn_timer_t *timer;
+
+    while((timer = slot->first)) {
+        mem_llist_nbn_remove(slot, timer);
+        --wheel->count[level];
+        asyn_wheel_insert(wheel, timer);
+    }
+}
+
+
+void asyn_wheel_init(asyn_wheel_t *wheel, unsigned int resolution) {
+    SUNDRY_ASSERT(wheel != NULL);
+
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->resolution = resolution?resolution:1;
+    wheel->origin = asyn_wheel_clock();
+    wheel->now = 0;
+}
+
+
+void asyn_timer_init(asyn_timer_t *timer, asyn_timer_fn_t fn, void *arg) {
+    SUNDRY_ASSERT(timer != NULL);
+
+    memset(timer, 0, sizeof(*timer));
+    timer->fn = fn;
+    timer->arg = arg;
+}
+
+
+void asyn_timer_arm(asyn_wheel_t *wheel, asyn_timer_t *timer, unsigned long ms) {
+    uint64_t ticks, elapsed;
+
+    SUNDRY_ASSERT(wheel != NULL);
+    SUNDRY_ASSERT(timer != NULL);
+
+    asyn_timer_cancel(timer);
+
+    /* The timeout is measured from now and not from the last tick of the wheel,
+     * hence, we add the time which elapsed since the wheel's last tick. Rounding
+     * up guarantees that the timer never fires early.
+     */
+    elapsed = asyn_wheel_clock() - wheel->origin;
+    ticks = (elapsed + ms + wheel->resolution - 1) / wheel->resolution;
+    if(ticks <= wheel->now) ticks = wheel->now + 1;
+    if(ticks - wheel->now > ASYN_WHEEL_MAX) ticks = wheel->now + ASYN_WHEEL_MAX;
+
+    timer->wheel = wheel;
+    timer->expire = ticks;
+    asyn_wheel_insert(wheel, timer);
+}
+
+
+void asyn_timer_cancel(asyn_timer_t *timer) {
+    SUNDRY_ASSERT(timer != NULL);
+
+    if(!timer->slot) return;
+
+    mem_llist_nbn_remove(timer->slot, timer);
+    --timer->wheel->count[timer->level];
+    timer->slot = NULL;
+}
+
+
+/* Returns the number of armed timers. */
+static unsigned long asyn_wheel_armed(asyn_wheel_t *wheel) {
+    unsigned long armed = 0;
+    unsigned int i;
+
+    for(i = 0; i < ASYN_WHEEL_LEVELS; ++i) armed += wheel->count[i];
+    return armed;
+}
+
+
+unsigned long asyn_wheel_run(asyn_wheel_t *wheel) {
+    asyn_wslot_t *slot;
+    asyn_timer_t *timer;
+    uint64_t target, skip;
+    unsigned long expired = 0;
+    unsigned int level;
+
+    SUNDRY_ASSERT(wheel != NULL);
+
+    target = (asyn_wheel_clock() - wheel->origin) / wheel->resolution;
+    while(wheel->now < target) {
+        /* Nothing happens before the next cascade of the lowest non-empty level, so
+         * we jump right in front of it. Empty wheels skip the idle ticks at once. A
+         * long gap therefore costs one step per cascade and not one per tick.
+         */
+        for(level = 0; level < ASYN_WHEEL_LEVELS; ++level) {
+            if(wheel->count[level]) break;
+        }
+        if(level == ASYN_WHEEL_LEVELS) {
+            wheel->now = target;
+            break;
+        }
+        if(level > 0) {
+            skip = wheel->now | ((((uint64_t)1) << (ASYN_WHEEL_BITS * level)) - 1);
+            if(skip >= target) {
+                wheel->now = target;
+                break;
+            }
+            wheel->now = skip;
+        }
+
+        ++wheel->now;
+
+        /* When level \level-1 wraps around, the next slot of \level is moved down. */
+        for(level = 1; level < ASYN_WHEEL_LEVELS; ++level) {
+            if(wheel->now & ((((uint64_t)1) << (ASYN_WHEEL_BITS * level)) - 1)) break;
+            asyn_wheel_cascade(wheel, level, (wheel->now >> (ASYN_WHEEL_BITS * level)) & ASYN_WHEEL_MASK);
+        }
+
+        /* The timer is unlinked before its callback runs, so the callback may rearm it. */
+        slot = &wheel->slots[0][wheel->now & ASYN_WHEEL_MASK];
+        while((timer = slot->first)) {
+            mem_llist_nbn_remove(slot, timer);
+            --wheel->count[0];
+            timer->slot = NULL;
+            ++expired;
+            timer->fn(wheel, timer);
+        }
+    }
+
+    return expired;
+}
+
+
+signed long asyn_wheel_next(asyn_wheel_t *wheel) {
+    uint64_t tick, clock;
+    unsigned int i;
+
+    SUNDRY_ASSERT(wheel != NULL);
+
+    if(!asyn_wheel_armed(wheel)) return -1;
+
+    /* Level 0 covers the next ASYN_WHEEL_SLOTS ticks. If it is empty, we wake up when
+     * the next cascade is due, which is at the latest when level 0 wraps around.
+     */
+    tick = wheel->now + ASYN_WHEEL_SLOTS - (wheel->now & ASYN_WHEEL_MASK);
+    if(wheel->count[0]) {
+        for(i = 1; i < ASYN_WHEEL_SLOTS; ++i) {
+            if(wheel->slots[0][(wheel->now + i) & ASYN_WHEEL_MASK].first) break;
+        }
+        if(wheel->now + i < tick) tick = wheel->now + i;
+    }
+
+    clock = asyn_wheel_clock();
+    tick = wheel->origin + tick * wheel->resolution;
+    if(tick <= clock) return 0;
+    if(tick - clock > 0x7fffffff) return 0x7fffffff;
+    return tick - clock;
+}
+
+
+uint64_t asyn_clock_now(void) {
+    return asyn_os_clock();
+}
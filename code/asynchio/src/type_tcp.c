@@ -0,0 +1,501 @@
+/*
+ * (COPYRIGHT) Copyright (C) 2008, 2009, The ONS Team.
+ * This file is part of ONS, see COPYING for details.
+ */
+
+/*
+ * File information:
+ * - Created: 17. October 2026
+ * - Lead-Dev: - David Herrmann
+ * - Contributors: /
+ * - Last-Change: 17. October 2026
+ */
+
+/* TCP backend
+ * TCP backend for the asynchio interface.
+ */
+
+
+#include "config/machine.h"
+#include "sundry/sundry.h"
+#include "asynchio/asynchio.h"
+#include "backend.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+#define ASYN_TCP_OPTS (ASYN_TCP_NBLOCK | ASYN_TCP_CLOEXEC | ASYN_TCP_NODELAY | ASYN_TCP_ZEROCOPY)
+
+/* Ways of sending a file chunk, tried in this order. */
+#define ASYN_TCP_FSENDFILE 0
+#define ASYN_TCP_FSPLICE 1
+#define ASYN_TCP_FCOPY 2
+
+/* Size of the stack buffer which file chunks are copied through. */
+#define ASYN_TCP_FBUF 16384
+
+
+/* Initializes \tcp with the new socket \fd and sets the options which were not set
+ * when \fd was created. \fd is closed on failure.
+ */
+static unsigned int asyn_tcp_setup(asyn_tcp_t *tcp, signed int fd, unsigned int opts, unsigned int nblock) {
+    unsigned int ret;
+
+    tcp->fd = fd;
+    tcp->error = ASYN_NONE;
+    tcp->opts = opts;
+    tcp->first = NULL;
+    tcp->last = NULL;
+    tcp->queued = 0;
+    tcp->zfirst = NULL;
+    tcp->zlast = NULL;
+    tcp->zseq = 0;
+    tcp->pipe[0] = -1;
+    tcp->pipe[1] = -1;
+    tcp->piped = 0;
+
+    if(nblock && (opts & ASYN_TCP_NBLOCK)) {
+        ret = asyn_os_setnblock(fd, 1);
+        if(ret != ASYN_DONE) goto failed;
+    }
+    if(opts & ASYN_TCP_NODELAY) {
+        ret = asyn_os_setnodelay(fd, 1);
+        if(ret != ASYN_DONE) goto failed;
+    }
+    if(opts & ASYN_TCP_ZEROCOPY) {
+        /* Without kernel support we simply copy. */
+        ret = asyn_os_setzerocopy(fd);
+        if(ret == ASYN_NOTSUPP) tcp->opts &= ~ASYN_TCP_ZEROCOPY;
+        else if(ret != ASYN_DONE) goto failed;
+    }
+    return ASYN_DONE;
+
+    failed:
+    asyn_os_close(fd);
+    tcp->fd = -1;
+    return ret;
+}
+
+
+unsigned int asyn_tcp_listen(asyn_tcp_t *tcp, unsigned int opts, unsigned int type, const void *addr, unsigned int port, unsigned int backlog) {
+    signed int fd;
+    unsigned int ret;
+
+    SUNDRY_ASSERT(tcp != NULL);
+
+    opts &= ASYN_TCP_OPTS;
+    if(type != ASYN_IPV4) type = ASYN_IPV6;
+
+    ret = asyn_os_socket(&fd, ASYN_OS_TCP, type, opts & ASYN_TCP_CLOEXEC);
+    if(ret != ASYN_DONE) return ret;
+    ret = asyn_tcp_setup(tcp, fd, opts, 1);
+    if(ret != ASYN_DONE) return ret;
+
+    ret = asyn_os_setreuseaddr(fd);
+    if(ret == ASYN_DONE) ret = asyn_os_bind(fd, type, addr, port);
+    if(ret == ASYN_DONE) ret = asyn_os_listen(fd, backlog?backlog:ASYN_TCP_BACKLOG);
+    if(ret != ASYN_DONE) {
+        asyn_os_close(fd);
+        tcp->fd = -1;
+        return ret;
+    }
+
+    return ASYN_DONE;
+}
+
+
+unsigned int asyn_tcp_accept(asyn_tcp_t *listener, asyn_tcp_t *tcp, unsigned int opts, asyn_addr_t *addr) {
+    signed int fd;
+    unsigned int ret;
+
+    SUNDRY_ASSERT(listener != NULL);
+    SUNDRY_ASSERT(tcp != NULL);
+
+    opts &= ASYN_TCP_OPTS;
+    ret = asyn_os_accept(listener->fd, &fd, addr, opts & ASYN_TCP_NBLOCK, opts & ASYN_TCP_CLOEXEC);
+    if(ret != ASYN_DONE) {
+        if(ret != ASYN_BLOCKED && ret != ASYN_FAILED) listener->error = ret;
+        return ret;
+    }
+
+    /* asyn_os_accept() already applied NBLOCK and CLOEXEC. */
+    return asyn_tcp_setup(tcp, fd, opts, 0);
+}
+
+
+unsigned int asyn_tcp_accept_batch(asyn_tcp_t *listener, asyn_tcp_t *tcps, asyn_addr_t *addrs, unsigned int count, unsigned int opts, unsigned int *done) {
+    unsigned int ret = ASYN_DONE;
+
+    SUNDRY_ASSERT(listener != NULL);
+    SUNDRY_ASSERT(tcps != NULL);
+    SUNDRY_ASSERT(done != NULL);
+
+    /* Drain the backlog. Connections which were aborted in the queue are skipped. */
+    *done = 0;
+    while(*done < count) {
+        ret = asyn_tcp_accept(listener, &tcps[*done], opts, addrs?&addrs[*done]:NULL);
+        if(ret == ASYN_FAILED) continue;
+        else if(ret != ASYN_DONE) break;
+        ++*done;
+    }
+
+    return (*done > 0)?ASYN_DONE:ret;
+}
+
+
+unsigned int asyn_tcp_connect(asyn_tcp_t *tcp, unsigned int opts, unsigned int type, const void *addr, unsigned int port) {
+    signed int fd;
+    unsigned int ret;
+
+    SUNDRY_ASSERT(tcp != NULL);
+    SUNDRY_ASSERT(addr != NULL);
+
+    opts &= ASYN_TCP_OPTS;
+    if(type != ASYN_IPV4) type = ASYN_IPV6;
+
+    ret = asyn_os_socket(&fd, ASYN_OS_TCP, type, opts & ASYN_TCP_CLOEXEC);
+    if(ret != ASYN_DONE) return ret;
+    ret = asyn_tcp_setup(tcp, fd, opts, 1);
+    if(ret != ASYN_DONE) return ret;
+
+    ret = asyn_os_connect(fd, type, addr, port);
+    if(ret != ASYN_DONE && ret != ASYN_BLOCKED) {
+        asyn_os_close(fd);
+        tcp->fd = -1;
+    }
+    return ret;
+}
+
+
+unsigned int asyn_tcp_connected(asyn_tcp_t *tcp) {
+    unsigned int ret;
+
+    SUNDRY_ASSERT(tcp != NULL);
+
+    ret = asyn_os_connerr(tcp->fd);
+    if(ret != ASYN_DONE && ret != ASYN_BLOCKED) tcp->error = ret;
+    return ret;
+}
+
+
+unsigned int asyn_tcp_adopt(asyn_tcp_t *tcp, signed int fd, unsigned int opts) {
+    SUNDRY_ASSERT(tcp != NULL);
+
+    /* CLOEXEC was decided by whoever created or received \fd. */
+    opts &= ASYN_TCP_OPTS & ~ASYN_TCP_CLOEXEC;
+    return asyn_tcp_setup(tcp, fd, opts, 1);
+}
+
+
+void asyn_tcp_close(asyn_tcp_t *tcp) {
+    asyn_chunk_t *chunk;
+
+    SUNDRY_ASSERT(tcp != NULL);
+
+    /* Release what the kernel is done with while the error queue is still readable. */
+    asyn_tcp_reap(tcp);
+    asyn_os_close(tcp->fd);
+    tcp->fd = -1;
+    if(tcp->pipe[0] != -1) {
+        asyn_os_close(tcp->pipe[0]);
+        asyn_os_close(tcp->pipe[1]);
+        tcp->pipe[0] = -1;
+        tcp->pipe[1] = -1;
+    }
+    tcp->piped = 0;
+
+    /* Release the chunks which were not written completely. Zero-copy chunks whose
+     * notifications did not arrive, yet, may still be read by the kernel after this,
+     * see ASYN_TCP_ZEROCOPY.
+     */
+    while((chunk = tcp->zfirst)) {
+        tcp->zfirst = chunk->next;
+        chunk->next = NULL;
+        if(chunk->fn) chunk->fn(tcp, chunk, chunk->size);
+    }
+    tcp->zlast = NULL;
+    while((chunk = tcp->first)) {
+        tcp->first = chunk->next;
+        chunk->next = NULL;
+        if(chunk->fn) chunk->fn(tcp, chunk, chunk->off);
+    }
+    tcp->last = NULL;
+    tcp->queued = 0;
+}
+
+
+unsigned int asyn_tcp_addr(asyn_tcp_t *tcp, asyn_addr_t *addr) {
+    SUNDRY_ASSERT(tcp != NULL);
+    SUNDRY_ASSERT(addr != NULL);
+
+    return asyn_os_sockname(tcp->fd, addr);
+}
+
+
+unsigned int asyn_tcp_recv(asyn_tcp_t *tcp, void *buf, size_t *size) {
+    unsigned int ret;
+
+    SUNDRY_ASSERT(tcp != NULL);
+    SUNDRY_ASSERT(buf != NULL);
+    SUNDRY_ASSERT(size != NULL);
+
+    ret = asyn_os_read(tcp->fd, buf, size);
+    if(ret != ASYN_DONE && ret != ASYN_BLOCKED && ret != ASYN_NONE) tcp->error = ret;
+    return ret;
+}
+
+
+unsigned int asyn_tcp_send(asyn_tcp_t *tcp, const void *buf, size_t *size) {
+    asyn_os_iov_t iov;
+    unsigned int ret;
+
+    SUNDRY_ASSERT(tcp != NULL);
+    SUNDRY_ASSERT(buf != NULL);
+    SUNDRY_ASSERT(size != NULL);
+
+    iov.buf = buf;
+    iov.size = *size;
+    ret = asyn_os_sendv(tcp->fd, &iov, 1, 0, size);
+    if(ret != ASYN_DONE && ret != ASYN_BLOCKED) tcp->error = ret;
+    return ret;
+}
+
+
+void asyn_tcp_queue(asyn_tcp_t *tcp, asyn_chunk_t *chunk) {
+    SUNDRY_ASSERT(tcp != NULL);
+    SUNDRY_ASSERT(chunk != NULL);
+
+    chunk->off = 0;
+    chunk->zc = 0;
+    chunk->fmode = ASYN_TCP_FSENDFILE;
+    chunk->next = NULL;
+    if(tcp->last) tcp->last->next = chunk;
+    else tcp->first = chunk;
+    tcp->last = chunk;
+    tcp->queued += chunk->size;
+}
+
+
+/* Subtracts the zero-copy calls \lo to \hi which sent a part of \chunk from the calls
+ * that \chunk still waits for.
+ */
+static void asyn_tcp_zcdone(asyn_chunk_t *chunk, uint32_t lo, uint32_t hi) {
+    if((int32_t)(chunk->zlo - lo) > 0) lo = chunk->zlo;
+    if((int32_t)(chunk->zhi - hi) < 0) hi = chunk->zhi;
+    if((int32_t)(hi - lo) >= 0) chunk->zpend -= hi - lo + 1;
+}
+
+
+void asyn_tcp_reap(asyn_tcp_t *tcp) {
+    asyn_chunk_t *chunk;
+    uint32_t lo, hi;
+    unsigned int ret;
+
+    SUNDRY_ASSERT(tcp != NULL);
+
+    if(!tcp->zfirst && !(tcp->first && tcp->first->zc)) return;
+
+    /* The notifications may arrive out of order (for instance, after retransmits), so
+     * every chunk counts the calls which it still waits for. The calls of one chunk
+     * are consecutive and every call is reported exactly once. A partly sent chunk is
+     * still the head of the output queue.
+     */
+    do {
+        ret = asyn_os_zcreap(tcp->fd, &lo, &hi);
+        if(ret != ASYN_DONE) continue;
+        for(chunk = tcp->zfirst; chunk; chunk = chunk->next) asyn_tcp_zcdone(chunk, lo, hi);
+        if(tcp->first && tcp->first->zc) asyn_tcp_zcdone(tcp->first, lo, hi);
+    } while(ret == ASYN_DONE || ret == ASYN_NONE);
+
+    /* Only the completed prefix is released, so chunks are still released in order. */
+    while((chunk = tcp->zfirst) && chunk->zpend == 0) {
+        tcp->zfirst = chunk->next;
+        if(!tcp->zfirst) tcp->zlast = NULL;
+        chunk->next = NULL;
+        if(chunk->fn) chunk->fn(tcp, chunk, chunk->size);
+    }
+}
+
+
+/* Sends one step of the file chunk \chunk with splice() through the connection's
+ * pipe. The pipe is only refilled when it is empty, so everything in it belongs to
+ * the first \tcp->piped bytes behind \chunk->off.
+ */
+static unsigned int asyn_tcp_splice(asyn_tcp_t *tcp, asyn_chunk_t *chunk, size_t *done) {
+    uint64_t pos;
+    size_t left, n;
+    unsigned int ret;
+
+    *done = 0;
+    left = chunk->size - chunk->off;
+    if(!tcp->piped) {
+        if(tcp->pipe[0] == -1) {
+            ret = asyn_os_pipe(tcp->pipe);
+            if(ret != ASYN_DONE) {
+                /* Without a pipe we fall back to copying. */
+                tcp->pipe[0] = -1;
+                tcp->pipe[1] = -1;
+                return (ret == ASYN_TOOMANY)?ASYN_NOTSUPP:ret;
+            }
+        }
+
+        pos = chunk->foff + chunk->off;
+        ret = asyn_os_splice(chunk->file, &pos, tcp->pipe[1], left, 0, &n);
+        if(ret != ASYN_DONE) return ret;
+        if(n == 0) return ASYN_NONE;
+        tcp->piped = n;
+    }
+
+    ret = asyn_os_splice(tcp->pipe[0], NULL, tcp->fd, tcp->piped, tcp->piped < left || chunk->next, done);
+    if(ret != ASYN_DONE) return ret;
+    tcp->piped -= *done;
+    return ASYN_DONE;
+}
+
+
+/* Sends one step of the file chunk \chunk by reading it into a buffer. The file is
+ * read at the current offset every time, so a short write loses nothing.
+ */
+static unsigned int asyn_tcp_fcopy(asyn_tcp_t *tcp, asyn_chunk_t *chunk, size_t *done) {
+    unsigned char buf[ASYN_TCP_FBUF];
+    asyn_os_iov_t iov;
+    size_t n;
+    unsigned int ret;
+
+    *done = 0;
+    n = chunk->size - chunk->off;
+    if(n > sizeof(buf)) n = sizeof(buf);
+    ret = asyn_os_pread(chunk->file, buf, n, chunk->foff + chunk->off, &n);
+    if(ret != ASYN_DONE) return ret;
+    if(n == 0) return ASYN_NONE;
+
+    iov.buf = buf;
+    iov.size = n;
+    return asyn_os_sendv(tcp->fd, &iov, 1, 0, done);
+}
+
+
+/* Sends the rest of the file chunk \chunk until it is done or the socket blocks. The
+ * number of sent bytes is saved in \done. If the file cannot be sent the current
+ * way, the next one is tried; the chunk remembers the way which works.
+ */
+static unsigned int asyn_tcp_sendfile(asyn_tcp_t *tcp, asyn_chunk_t *chunk, size_t *done) {
+    size_t left, n;
+    unsigned int ret;
+
+    *done = 0;
+    left = chunk->size - chunk->off;
+    while(*done < left) {
+        switch(chunk->fmode) {
+            case ASYN_TCP_FSENDFILE:
+                ret = asyn_os_sendfile(tcp->fd, chunk->file, chunk->foff + chunk->off + *done, left - *done, &n);
+                if(ret == ASYN_DONE && n == 0) ret = ASYN_NONE;
+                break;
+            case ASYN_TCP_FSPLICE:
+                /* The chunk's offset is advanced by the caller, not by us. */
+                chunk->off += *done;
+                ret = asyn_tcp_splice(tcp, chunk, &n);
+                chunk->off -= *done;
+                break;
+            default:
+                chunk->off += *done;
+                ret = asyn_tcp_fcopy(tcp, chunk, &n);
+                chunk->off -= *done;
+                break;
+        }
+
+        /* Data in the pipe must be sent with splice(), so we never leave it then. */
+        if(ret == ASYN_NOTSUPP && chunk->fmode != ASYN_TCP_FCOPY && !tcp->piped) {
+            ++chunk->fmode;
+            continue;
+        }
+        if(ret != ASYN_DONE) return (*done > 0 && ret == ASYN_BLOCKED)?ASYN_DONE:ret;
+        *done += n;
+        if(n == 0) break;
+    }
+
+    return ASYN_DONE;
+}
+
+
+unsigned int asyn_tcp_flush(asyn_tcp_t *tcp) {
+    asyn_os_iov_t iov[ASYN_OS_IOV];
+    asyn_chunk_t *chunk;
+    unsigned int i, ret, zc;
+    size_t total, done, left;
+
+    SUNDRY_ASSERT(tcp != NULL);
+
+    asyn_tcp_reap(tcp);
+
+    while(tcp->first) {
+        /* A gather write stops at the next file chunk which is sent on its own. */
+        total = 0;
+        for(i = 0, chunk = tcp->first; i < ASYN_OS_IOV && chunk && chunk->buf; ++i, chunk = chunk->next) {
+            iov[i].buf = (const unsigned char*)chunk->buf + chunk->off;
+            iov[i].size = chunk->size - chunk->off;
+            total += iov[i].size;
+        }
+
+        if(i == 0) {
+            zc = 0;
+            total = tcp->first->size - tcp->first->off;
+            ret = asyn_tcp_sendfile(tcp, tcp->first, &done);
+        }
+        else {
+            /* The kernel may run out of memory to pin pages, then we copy this time. */
+            zc = (tcp->opts & ASYN_TCP_ZEROCOPY) && total >= ASYN_TCP_ZCMIN;
+            ret = asyn_os_sendv(tcp->fd, iov, i, zc, &done);
+            if(ret == ASYN_MEMFAIL && zc) {
+                zc = 0;
+                ret = asyn_os_sendv(tcp->fd, iov, i, 0, &done);
+            }
+        }
+        if(ret != ASYN_DONE) {
+            if(ret != ASYN_BLOCKED) tcp->error = ret;
+            return ret;
+        }
+
+        /* Release every chunk which was written completely. The callback may requeue
+         * the chunk, hence, it is unlinked before. Chunks which were (partly) sent
+         * without copying wait for the kernel's notification.
+         */
+        tcp->queued -= done;
+        for(left = done; tcp->first; ) {
+            chunk = tcp->first;
+            if(zc && left > 0) {
+                if(!chunk->zc) {
+                    chunk->zc = 1;
+                    chunk->zlo = tcp->zseq;
+                    chunk->zpend = 0;
+                }
+                chunk->zhi = tcp->zseq;
+                ++chunk->zpend;
+            }
+            if(left < chunk->size - chunk->off) {
+                chunk->off += left;
+                break;
+            }
+            left -= chunk->size - chunk->off;
+            chunk->off = chunk->size;
+            tcp->first = chunk->next;
+            if(!tcp->first) tcp->last = NULL;
+            chunk->next = NULL;
+            if(chunk->zc) {
+                if(tcp->zlast) tcp->zlast->next = chunk;
+                else tcp->zfirst = chunk;
+                tcp->zlast = chunk;
+            }
+            else if(chunk->fn) chunk->fn(tcp, chunk, chunk->size);
+        }
+        if(zc) ++tcp->zseq;
+
+        /* A short write means that the send buffer is full. We save the syscall which
+         * would only return EAGAIN.
+         */
+        if(done < total && (tcp->opts & ASYN_TCP_NBLOCK)) return ASYN_BLOCKED;
+    }
+
+    return ASYN_DONE;
+}
@@ -8,7 +8,7 @@
  * - Created: 26. May 2009
  * - Lead-Dev: - David Herrmann
  * - Contributors: /
- * - Last-Change: 30. May 2009
+ * - Last-Change: 17. October 2026
  */
 
 /* UDP backend
@@ -23,6 +23,193 @@
 
 #include <stdarg.h>
 #include <stdint.h>
+#include <string.h>
+
+
+/* Number of datagrams in \msg. A super-buffer contains \segsize sized datagrams. */
+#define ASYN_UDP_PKTS(msg) (((msg)->segsize > 0 && (msg)->segsize < (msg)->size) \
+                            ?(((msg)->size + (msg)->segsize - 1) / (msg)->segsize):1)
+
+
+/* Accounts the result \ret of a receive call. */
+static void asyn_udp_count_in(asyn_udp_stats_t *stats, unsigned int ret, const asyn_msg_t *msgs, unsigned int count) {
+    unsigned int i;
+
+    if(ret == ASYN_BLOCKED) ++stats->blocked_in;
+    else if(ret != ASYN_DONE) ++stats->errors_in;
+
+    for(i = 0; i < count; ++i) {
+        stats->pkts_in += ASYN_UDP_PKTS(&msgs[i]);
+        stats->bytes_in += msgs[i].size;
+        if(msgs[i].flags & ASYN_MSG_TRUNC) ++stats->truncated;
+        if(msgs[i].drops > stats->drops) stats->drops = msgs[i].drops;
+    }
+}
+
+
+/* Accounts the result \ret of a send call. */
+static void asyn_udp_count_out(asyn_udp_stats_t *stats, unsigned int ret, const asyn_msg_t *msgs, unsigned int count) {
+    unsigned int i;
+
+    if(ret == ASYN_BLOCKED) ++stats->blocked_out;
+    else if(ret != ASYN_DONE) ++stats->errors_out;
+
+    for(i = 0; i < count; ++i) {
+        stats->pkts_out += ASYN_UDP_PKTS(&msgs[i]);
+        stats->bytes_out += msgs[i].size;
+    }
+}
+
+
+/* Moves the receive (\send is 0) or send buffer to \size within its bounds. If the
+ * kernel caps the buffer at the system limit, the upper bound is lowered to it so we
+ * do not retry with every overflow.
+ */
+static unsigned int asyn_udp_tune_resize(asyn_udp_t *udp, unsigned int send, size_t size) {
+    asyn_udp_tune_t *tune = &udp->tune;
+    size_t *cur, *min, *max, rbuf, rused, sbuf, sused;
+    unsigned int ret = ASYN_DENIED;
+
+    cur = send?&tune->sndbuf:&tune->rcvbuf;
+    min = send?&tune->smin:&tune->rmin;
+    max = send?&tune->smax:&tune->rmax;
+    if(size < *min) size = *min;
+    if(size > *max) size = *max;
+    if(size == *cur) return ASYN_DONE;
+
+    /* Only privileged processes may exceed the system limit. */
+    if(!tune->noforce) {
+        ret = asyn_os_setbuf(udp->fd, send, size, 1);
+        if(ret == ASYN_DENIED) tune->noforce = 1;
+    }
+    if(ret == ASYN_DENIED) ret = asyn_os_setbuf(udp->fd, send, size, 0);
+    if(ret != ASYN_DONE) return ret;
+
+    ret = asyn_os_meminfo(udp->fd, &rbuf, &rused, &sbuf, &sused);
+    if(ret != ASYN_DONE && ret != ASYN_NOTSUPP) return ret;
+    *cur = send?sbuf:rbuf;
+    if(*cur < size) {
+        *max = *cur;
+        if(*min > *max) *min = *max;
+    }
+    return ASYN_DONE;
+}
+
+
+/* Grows a buffer which is more than half full and shrinks one which stayed nearly
+ * empty for ASYN_UDP_TUNE_QUIET intervals. If the fill level is unknown, only the
+ * quiet intervals count.
+ */
+static void asyn_udp_tune_level(asyn_udp_t *udp, unsigned int send, unsigned int known, size_t size, size_t used, unsigned int *quiet) {
+    if(known && used > size / 2) {
+        *quiet = 0;
+        asyn_udp_tune_resize(udp, send, size * 2);
+    }
+    else if(++*quiet >= ASYN_UDP_TUNE_QUIET) {
+        *quiet = 0;
+        if(!known || used < size / 8) asyn_udp_tune_resize(udp, send, size / 2);
+    }
+}
+
+
+static void asyn_udp_tune_check(asyn_udp_t *udp, uint64_t now) {
+    asyn_udp_tune_t *tune = &udp->tune;
+    size_t rbuf, rused, sbuf, sused;
+    unsigned int ret;
+
+    tune->calls = 0;
+
+    /* Overflows are handled at once, but a single burst must not double the buffer
+     * with every datagram.
+     */
+    if((tune->rpress || tune->spress) && now - tune->grown >= ASYN_UDP_TUNE_HOLD) {
+        if(tune->rpress) asyn_udp_tune_resize(udp, 0, tune->rcvbuf * 2);
+        if(tune->spress) asyn_udp_tune_resize(udp, 1, tune->sndbuf * 2);
+        tune->rpress = 0;
+        tune->spress = 0;
+        tune->rquiet = 0;
+        tune->squiet = 0;
+        tune->grown = now;
+    }
+
+    if(now - tune->stamp < ASYN_UDP_TUNE_INTERVAL) return;
+    tune->stamp = now;
+    if(tune->rpress || tune->spress) return;
+
+    ret = asyn_os_meminfo(udp->fd, &rbuf, &rused, &sbuf, &sused);
+    if(ret != ASYN_DONE && ret != ASYN_NOTSUPP) return;
+
+    /* The user may have changed the buffers behind our back. */
+    tune->rcvbuf = rbuf;
+    tune->sndbuf = sbuf;
+    asyn_udp_tune_level(udp, 0, ret == ASYN_DONE, rbuf, rused, &tune->rquiet);
+    asyn_udp_tune_level(udp, 1, ret == ASYN_DONE, sbuf, sused, &tune->squiet);
+}
+
+
+/* Counts an IO call and checks the buffers if something happened or enough calls
+ * passed.
+ */
+static void asyn_udp_tune_step(asyn_udp_t *udp) {
+    asyn_udp_tune_t *tune = &udp->tune;
+
+    if(tune->rpress || tune->spress || ++tune->calls >= ASYN_UDP_TUNE_CALLS) asyn_udp_tune_check(udp, asyn_os_clock());
+}
+
+
+/* Looks for new kernel drops in the received messages. The first message only sets
+ * the baseline as the kernel counts the drops since the socket was created.
+ */
+static void asyn_udp_tune_in(asyn_udp_t *udp, const asyn_msg_t *msgs, unsigned int count) {
+    asyn_udp_tune_t *tune = &udp->tune;
+    unsigned int i;
+
+    for(i = 0; i < count; ++i) {
+        if(msgs[i].drops > tune->drops) {
+            if(tune->primed) tune->rpress = 1;
+            tune->drops = msgs[i].drops;
+        }
+        tune->primed = 1;
+    }
+    asyn_udp_tune_step(udp);
+}
+
+
+static void asyn_udp_tune_out(asyn_udp_t *udp, unsigned int ret) {
+    if(ret == ASYN_BLOCKED) udp->tune.spress = 1;
+    asyn_udp_tune_step(udp);
+}
+
+
+/* Starts the tuning with the current sizes as lower bounds. */
+static unsigned int asyn_udp_tune_start(asyn_udp_t *udp) {
+    asyn_udp_tune_t *tune = &udp->tune;
+    size_t rused, sused;
+    unsigned int ret;
+
+    memset(tune, 0, sizeof(*tune));
+    ret = asyn_os_meminfo(udp->fd, &tune->rcvbuf, &rused, &tune->sndbuf, &sused);
+    if(ret != ASYN_DONE && ret != ASYN_NOTSUPP) return ret;
+
+    /* Without the drop counter the fill level and blocked sends still work. */
+    ret = asyn_os_setovfl(udp->fd, 1);
+    if(ret != ASYN_DONE && ret != ASYN_NOTSUPP) return ret;
+
+    tune->rmin = tune->rcvbuf;
+    tune->smin = tune->sndbuf;
+    tune->rmax = (tune->rcvbuf > ASYN_UDP_BUFMAX)?tune->rcvbuf:ASYN_UDP_BUFMAX;
+    tune->smax = (tune->sndbuf > ASYN_UDP_BUFMAX)?tune->sndbuf:ASYN_UDP_BUFMAX;
+    tune->stamp = asyn_os_clock();
+    tune->grown = tune->stamp;
+    return ASYN_DONE;
+}
+
+
+static unsigned int asyn_udp_tune_stop(asyn_udp_t *udp) {
+    /* The statistics still need the drop counter. */
+    if(!udp->stats) asyn_os_setovfl(udp->fd, 0);
+    return ASYN_DONE;
+}
 
 
 unsigned int asyn_udp_init(asyn_udp_t *udp, unsigned int opts, unsigned int type, const void *addr, unsigned int port) {
@@ -33,17 +220,421 @@ unsigned int asyn_udp_init(asyn_udp_t *udp, unsigned int opts, unsigned int type
     /* Clear invalid options in \opts to be compatible to possible future
      * asynchio headers.
      */
-    opts &= ASYN_UDP_NBLOCK | ASYN_UDP_CLOEXEC;
+    opts &= ASYN_UDP_NBLOCK | ASYN_UDP_CLOEXEC | ASYN_UDP_SEGMENT | ASYN_UDP_REUSEPORT | ASYN_UDP_TSTAMP | ASYN_UDP_PKTINFO | ASYN_UDP_AUTOBUF;
+    if(type != ASYN_IPV4) type = ASYN_IPV6;
+    udp->error = ASYN_NONE;
+    udp->opts = opts;
+    udp->slot = -1;
+    udp->stats = NULL;
 
     /* First we need to create the UDP socket. We immediately set CLOEXEC if required because
      * some systems allow to set it directly in the socket() syscall.
      */
-    ret = asyn_os_socket(&udp->fd, ASYN_OS_UDP, ASYN_IPV4, opts & ASYN_UDP_CLOEXEC);
+    ret = asyn_os_socket(&udp->fd, ASYN_OS_UDP, type, opts & ASYN_UDP_CLOEXEC);
     if(ret != ASYN_DONE) return ret;
 
     /* Now set the other options. */
     if(opts & ASYN_UDP_NBLOCK) {
-        
+        ret = asyn_os_setnblock(udp->fd, 1);
+        if(ret != ASYN_DONE) {
+            asyn_os_close(udp->fd);
+            return ret;
+        }
+    }
+    if(opts & ASYN_UDP_SEGMENT) {
+        ret = asyn_os_setgro(udp->fd, 1);
+        if(ret != ASYN_DONE) {
+            asyn_os_close(udp->fd);
+            return ret;
+        }
+    }
+    if(opts & ASYN_UDP_TSTAMP) {
+        ret = asyn_os_setstamp(udp->fd, 1);
+        if(ret != ASYN_DONE) {
+            asyn_os_close(udp->fd);
+            return ret;
+        }
+    }
+    if(opts & ASYN_UDP_PKTINFO) {
+        ret = asyn_os_setpktinfo(udp->fd, 1);
+        if(ret != ASYN_DONE) {
+            asyn_os_close(udp->fd);
+            return ret;
+        }
+    }
+    if(opts & ASYN_UDP_AUTOBUF) {
+        ret = asyn_udp_tune_start(udp);
+        if(ret != ASYN_DONE) {
+            asyn_os_close(udp->fd);
+            return ret;
+        }
+    }
+    if(opts & ASYN_UDP_REUSEPORT) {
+        ret = asyn_os_setreuse(udp->fd);
+        if(ret != ASYN_DONE) {
+            asyn_os_close(udp->fd);
+            return ret;
+        }
+    }
+
+    /* Bind the socket to the requested address. */
+    ret = asyn_os_bind(udp->fd, type, addr, port);
+    if(ret != ASYN_DONE) {
+        asyn_os_close(udp->fd);
+        return ret;
+    }
+
+    return ASYN_DONE;
+}
+
+
+void asyn_udp_close(asyn_udp_t *udp) {
+    SUNDRY_ASSERT(udp != NULL);
+
+    asyn_os_close(udp->fd);
+    udp->fd = -1;
+}
+
+
+unsigned int asyn_udp_ctl(asyn_udp_t *udp, unsigned int opts) {
+    unsigned int ret, res = ASYN_DONE, changed;
+
+    SUNDRY_ASSERT(udp != NULL);
+
+    opts &= ASYN_UDP_NBLOCK | ASYN_UDP_SEGMENT | ASYN_UDP_TSTAMP | ASYN_UDP_PKTINFO | ASYN_UDP_AUTOBUF;
+    changed = (udp->opts ^ opts) & (ASYN_UDP_NBLOCK | ASYN_UDP_SEGMENT | ASYN_UDP_TSTAMP | ASYN_UDP_PKTINFO | ASYN_UDP_AUTOBUF);
+
+    /* We try to set every option even if a previous one failed. \udp->opts always
+     * reflects the options which are really set.
+     */
+    if(changed & ASYN_UDP_NBLOCK) {
+        ret = asyn_os_setnblock(udp->fd, opts & ASYN_UDP_NBLOCK);
+        if(ret == ASYN_DONE) udp->opts ^= ASYN_UDP_NBLOCK;
+        else res = ret;
+    }
+    if(changed & ASYN_UDP_SEGMENT) {
+        ret = asyn_os_setgro(udp->fd, opts & ASYN_UDP_SEGMENT);
+        if(ret == ASYN_DONE) udp->opts ^= ASYN_UDP_SEGMENT;
+        else if(res == ASYN_DONE) res = ret;
+    }
+    if(changed & ASYN_UDP_TSTAMP) {
+        ret = asyn_os_setstamp(udp->fd, opts & ASYN_UDP_TSTAMP);
+        if(ret == ASYN_DONE) udp->opts ^= ASYN_UDP_TSTAMP;
+        else if(res == ASYN_DONE) res = ret;
+    }
+    if(changed & ASYN_UDP_PKTINFO) {
+        ret = asyn_os_setpktinfo(udp->fd, opts & ASYN_UDP_PKTINFO);
+        if(ret == ASYN_DONE) udp->opts ^= ASYN_UDP_PKTINFO;
+        else if(res == ASYN_DONE) res = ret;
+    }
+    if(changed & ASYN_UDP_AUTOBUF) {
+        if(opts & ASYN_UDP_AUTOBUF) ret = asyn_udp_tune_start(udp);
+        else ret = asyn_udp_tune_stop(udp);
+        if(ret == ASYN_DONE) udp->opts ^= ASYN_UDP_AUTOBUF;
+        else if(res == ASYN_DONE) res = ret;
+    }
+
+    return res;
+}
+
+
+unsigned int asyn_udp_adopt(asyn_udp_t *udp, signed int fd, unsigned int opts) {
+    unsigned int ret;
+
+    SUNDRY_ASSERT(udp != NULL);
+
+    udp->fd = fd;
+    udp->error = ASYN_NONE;
+    udp->opts = 0;
+    udp->slot = -1;
+    udp->stats = NULL;
+
+    ret = asyn_udp_ctl(udp, opts);
+    if(ret != ASYN_DONE) {
+        asyn_os_close(fd);
+        udp->fd = -1;
+    }
+    return ret;
+}
+
+
+unsigned int asyn_udp_autobuf(asyn_udp_t *udp, size_t rmin, size_t rmax, size_t smin, size_t smax) {
+    asyn_udp_tune_t *tune = &udp->tune;
+    unsigned int ret;
+
+    SUNDRY_ASSERT(udp != NULL);
+
+    if(!(udp->opts & ASYN_UDP_AUTOBUF)) return ASYN_FAILED;
+
+    if(rmin) tune->rmin = rmin;
+    if(rmax) tune->rmax = rmax;
+    if(smin) tune->smin = smin;
+    if(smax) tune->smax = smax;
+    SUNDRY_MASSERT(tune->rmin <= tune->rmax && tune->smin <= tune->smax, "asyn_udp_autobuf(): Lower bound exceeds upper bound.");
+
+    ret = asyn_udp_tune_resize(udp, 0, tune->rcvbuf);
+    if(ret != ASYN_DONE) return ret;
+    return asyn_udp_tune_resize(udp, 1, tune->sndbuf);
+}
+
+
+void asyn_udp_tune(asyn_udp_t *udp) {
+    SUNDRY_ASSERT(udp != NULL);
+
+    if(udp->opts & ASYN_UDP_AUTOBUF) asyn_udp_tune_check(udp, asyn_os_clock());
+}
+
+
+unsigned int asyn_udp_busypoll(asyn_udp_t *udp, unsigned int usecs) {
+    SUNDRY_ASSERT(udp != NULL);
+
+    return asyn_os_setbusypoll(udp->fd, usecs);
+}
+
+
+unsigned int asyn_udp_join(asyn_udp_t *udp, const asyn_addr_t *group, const asyn_addr_t *source, unsigned int ifindex) {
+    SUNDRY_ASSERT(udp != NULL);
+    SUNDRY_ASSERT(group != NULL);
+
+    return asyn_os_mcast_member(udp->fd, 1, group, source, ifindex);
+}
+
+
+unsigned int asyn_udp_leave(asyn_udp_t *udp, const asyn_addr_t *group, const asyn_addr_t *source, unsigned int ifindex) {
+    SUNDRY_ASSERT(udp != NULL);
+    SUNDRY_ASSERT(group != NULL);
+
+    return asyn_os_mcast_member(udp->fd, 0, group, source, ifindex);
+}
+
+
+unsigned int asyn_udp_mcast_hops(asyn_udp_t *udp, unsigned int hops) {
+    SUNDRY_ASSERT(udp != NULL);
+
+    return asyn_os_setmcast_hops(udp->fd, hops);
+}
+
+
+unsigned int asyn_udp_mcast_loop(asyn_udp_t *udp, unsigned int set) {
+    SUNDRY_ASSERT(udp != NULL);
+
+    return asyn_os_setmcast_loop(udp->fd, set);
+}
+
+
+unsigned int asyn_udp_addr(asyn_udp_t *udp, asyn_addr_t *addr) {
+    SUNDRY_ASSERT(udp != NULL);
+    SUNDRY_ASSERT(addr != NULL);
+
+    return asyn_os_sockname(udp->fd, addr);
+}
+
+
+unsigned int asyn_udp_recv(asyn_udp_t *udp, void *buf, size_t *size, asyn_addr_t *addr) {
+    asyn_msg_t msg;
+    unsigned int ret;
+
+    SUNDRY_ASSERT(udp != NULL);
+    SUNDRY_ASSERT(buf != NULL);
+    SUNDRY_ASSERT(size != NULL);
+
+    msg.buf = buf;
+    msg.size = *size;
+    ret = asyn_os_recv(udp->fd, &msg, 0);
+    if(udp->stats) asyn_udp_count_in(udp->stats, ret, &msg, (ret == ASYN_DONE)?1:0);
+    if(udp->opts & ASYN_UDP_AUTOBUF) asyn_udp_tune_in(udp, &msg, (ret == ASYN_DONE)?1:0);
+    if(ret != ASYN_DONE) {
+        *size = 0;
+        if(ret != ASYN_BLOCKED) udp->error = ret;
+        return ret;
+    }
+
+    *size = msg.size;
+    if(addr) memcpy(addr, &msg.addr, sizeof(*addr));
+    return ASYN_DONE;
+}
+
+
+unsigned int asyn_udp_recv_msg(asyn_udp_t *udp, asyn_msg_t *msg) {
+    unsigned int ret;
+
+    SUNDRY_ASSERT(udp != NULL);
+    SUNDRY_ASSERT(msg != NULL);
+    SUNDRY_ASSERT(msg->buf != NULL);
+
+    ret = asyn_os_recv(udp->fd, msg, 0);
+    if(udp->stats) asyn_udp_count_in(udp->stats, ret, msg, (ret == ASYN_DONE)?1:0);
+    if(udp->opts & ASYN_UDP_AUTOBUF) asyn_udp_tune_in(udp, msg, (ret == ASYN_DONE)?1:0);
+    if(ret != ASYN_DONE) {
+        msg->size = 0;
+        if(ret != ASYN_BLOCKED) udp->error = ret;
+        return ret;
     }
+    return ASYN_DONE;
+}
+
+
+unsigned int asyn_udp_recv_batch(asyn_udp_t *udp, asyn_msg_t *msgs, unsigned int count, unsigned int *done) {
+    unsigned int ret;
+
+    SUNDRY_ASSERT(udp != NULL);
+    SUNDRY_ASSERT(msgs != NULL);
+    SUNDRY_ASSERT(done != NULL);
+
+    ret = asyn_os_recv_batch(udp->fd, msgs, count, done);
+    if(udp->stats) asyn_udp_count_in(udp->stats, ret, msgs, *done);
+    if(udp->opts & ASYN_UDP_AUTOBUF) asyn_udp_tune_in(udp, msgs, *done);
+    if(ret != ASYN_DONE && ret != ASYN_BLOCKED) udp->error = ret;
+    return ret;
 }
 
+
+unsigned int asyn_udp_send(asyn_udp_t *udp, const void *buf, size_t *size, const asyn_addr_t *addr) {
+    asyn_msg_t msg;
+    unsigned int ret;
+
+    SUNDRY_ASSERT(udp != NULL);
+    SUNDRY_ASSERT(buf != NULL);
+    SUNDRY_ASSERT(size != NULL);
+
+    msg.buf = (void*)buf;
+    msg.size = *size;
+    msg.segsize = 0;
+    msg.flags = 0;
+    if(addr) memcpy(&msg.addr, addr, sizeof(*addr));
+    else msg.addr.type = ASYN_NOADDR;
+    ret = asyn_os_send(udp->fd, &msg, 0);
+    if(udp->stats) asyn_udp_count_out(udp->stats, ret, &msg, (ret == ASYN_DONE)?1:0);
+    if(udp->opts & ASYN_UDP_AUTOBUF) asyn_udp_tune_out(udp, ret);
+    if(ret != ASYN_DONE) {
+        *size = 0;
+        if(ret != ASYN_BLOCKED) udp->error = ret;
+        return ret;
+    }
+    return ASYN_DONE;
+}
+
+
+unsigned int asyn_udp_connect(asyn_udp_t *udp, const asyn_addr_t *addr) {
+    unsigned int ret;
+
+    SUNDRY_ASSERT(udp != NULL);
+
+    if(!addr || addr->type == ASYN_NOADDR) ret = asyn_os_disconnect(udp->fd);
+    else ret = asyn_os_connect(udp->fd, addr->type, addr->ip, addr->port);
+    if(ret != ASYN_DONE && ret != ASYN_FAILED && ret != ASYN_DENIED) udp->error = ret;
+    return ret;
+}
+
+
+/* The peer functions only build a message for the statistics if they are enabled. */
+unsigned int asyn_udp_send_peer(asyn_udp_t *udp, const void *buf, size_t *size) {
+    asyn_msg_t msg;
+    unsigned int ret;
+
+    SUNDRY_ASSERT(udp != NULL);
+    SUNDRY_ASSERT(buf != NULL);
+    SUNDRY_ASSERT(size != NULL);
+
+    ret = asyn_os_peer_send(udp->fd, buf, *size);
+    if(udp->stats) {
+        msg.size = *size;
+        msg.segsize = 0;
+        asyn_udp_count_out(udp->stats, ret, &msg, (ret == ASYN_DONE)?1:0);
+    }
+    if(udp->opts & ASYN_UDP_AUTOBUF) asyn_udp_tune_out(udp, ret);
+    if(ret != ASYN_DONE) {
+        *size = 0;
+        if(ret != ASYN_BLOCKED) udp->error = ret;
+        return ret;
+    }
+    return ASYN_DONE;
+}
+
+
+unsigned int asyn_udp_recv_peer(asyn_udp_t *udp, void *buf, size_t *size) {
+    asyn_msg_t msg;
+    unsigned int ret, trunc;
+
+    SUNDRY_ASSERT(udp != NULL);
+    SUNDRY_ASSERT(buf != NULL);
+    SUNDRY_ASSERT(size != NULL);
+
+    ret = asyn_os_peer_recv(udp->fd, buf, size, &trunc);
+    if(udp->stats) {
+        msg.size = *size;
+        msg.segsize = 0;
+        msg.flags = trunc?ASYN_MSG_TRUNC:0;
+        msg.drops = 0;
+        asyn_udp_count_in(udp->stats, ret, &msg, (ret == ASYN_DONE)?1:0);
+    }
+    if(udp->opts & ASYN_UDP_AUTOBUF) asyn_udp_tune_in(udp, NULL, 0);
+    if(ret != ASYN_DONE && ret != ASYN_BLOCKED) udp->error = ret;
+    return ret;
+}
+
+
+unsigned int asyn_udp_send_batch(asyn_udp_t *udp, asyn_msg_t *msgs, unsigned int count, unsigned int *done) {
+    unsigned int ret;
+
+    SUNDRY_ASSERT(udp != NULL);
+    SUNDRY_ASSERT(msgs != NULL);
+    SUNDRY_ASSERT(done != NULL);
+
+    ret = asyn_os_send_batch(udp->fd, msgs, count, done);
+    if(udp->stats) asyn_udp_count_out(udp->stats, ret, msgs, *done);
+    if(udp->opts & ASYN_UDP_AUTOBUF) asyn_udp_tune_out(udp, ret);
+    if(ret != ASYN_DONE && ret != ASYN_BLOCKED) udp->error = ret;
+    return ret;
+}
+
+
+uint64_t asyn_stamp_now(void) {
+    return asyn_os_stamp();
+}
+
+
+unsigned int asyn_udp_stats(asyn_udp_t *udp, asyn_udp_stats_t *stats) {
+    unsigned int ret;
+
+    SUNDRY_ASSERT(udp != NULL);
+
+    if(!stats) {
+        if(udp->stats && !(udp->opts & ASYN_UDP_AUTOBUF)) asyn_os_setovfl(udp->fd, 0);
+        udp->stats = NULL;
+        return ASYN_DONE;
+    }
+
+    /* Missing kernel support only costs us the drop counter. */
+    ret = asyn_os_setovfl(udp->fd, 1);
+    if(ret != ASYN_DONE && ret != ASYN_NOTSUPP) return ret;
+
+    memset(stats, 0, sizeof(*stats));
+    udp->stats = stats;
+    return ret;
+}
+
+
+void asyn_udp_stats_snapshot(asyn_udp_stats_t *sum, const asyn_udp_t *udps, unsigned int count) {
+    const asyn_udp_stats_t *stats;
+    unsigned int i;
+
+    SUNDRY_ASSERT(sum != NULL);
+    SUNDRY_ASSERT(udps != NULL || count == 0);
+
+    memset(sum, 0, sizeof(*sum));
+    for(i = 0; i < count; ++i) {
+        stats = udps[i].stats;
+        if(!stats) continue;
+        sum->pkts_in += stats->pkts_in;
+        sum->bytes_in += stats->bytes_in;
+        sum->pkts_out += stats->pkts_out;
+        sum->bytes_out += stats->bytes_out;
+        sum->blocked_in += stats->blocked_in;
+        sum->blocked_out += stats->blocked_out;
+        sum->errors_in += stats->errors_in;
+        sum->errors_out += stats->errors_out;
+        sum->truncated += stats->truncated;
+        sum->drops += stats->drops;
+    }
+}
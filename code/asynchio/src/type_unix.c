@@ -0,0 +1,187 @@
+/*
+ * (COPYRIGHT) Copyright (C) 2008, 2009, The ONS Team.
+ * This file is part of ONS, see COPYING for details.
+ */
+
+/*
+ * File information:
+ * - Created: 17. October 2026
+ * - Lead-Dev: - David Herrmann
+ * - Contributors: /
+ * - Last-Change: 17. October 2026
+ */
+
+/* Local socket backend
+ * AF_UNIX backend for the asynchio interface.
+ */
+
+
+#include "config/machine.h"
+#include "sundry/sundry.h"
+#include "asynchio/asynchio.h"
+#include "backend.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+#define ASYN_UNIX_OPTS (ASYN_UNIX_NBLOCK | ASYN_UNIX_CLOEXEC | ASYN_UNIX_DGRAM)
+
+
+/* Initializes \ux with the new socket \fd and sets the options which were not set
+ * when \fd was created. \fd is closed on failure.
+ */
+static unsigned int asyn_unix_setup(asyn_unix_t *ux, signed int fd, unsigned int opts) {
+    unsigned int ret;
+
+    ux->fd = fd;
+    ux->error = ASYN_NONE;
+    ux->opts = opts;
+
+    if(opts & ASYN_UNIX_NBLOCK) {
+        ret = asyn_os_setnblock(fd, 1);
+        if(ret != ASYN_DONE) {
+            asyn_os_close(fd);
+            ux->fd = -1;
+            return ret;
+        }
+    }
+    return ASYN_DONE;
+}
+
+
+unsigned int asyn_unix_listen(asyn_unix_t *ux, unsigned int opts, const char *path, unsigned int backlog) {
+    signed int fd;
+    unsigned int ret;
+
+    SUNDRY_ASSERT(ux != NULL);
+    SUNDRY_ASSERT(path != NULL);
+
+    opts &= ASYN_UNIX_OPTS;
+    ret = asyn_os_uxsocket(&fd, opts & ASYN_UNIX_DGRAM, opts & ASYN_UNIX_CLOEXEC);
+    if(ret != ASYN_DONE) return ret;
+    ret = asyn_unix_setup(ux, fd, opts);
+    if(ret != ASYN_DONE) return ret;
+
+    ret = asyn_os_uxbind(fd, path);
+    if(ret == ASYN_DONE && !(opts & ASYN_UNIX_DGRAM)) ret = asyn_os_listen(fd, backlog?backlog:ASYN_TCP_BACKLOG);
+    if(ret != ASYN_DONE) {
+        asyn_os_close(fd);
+        ux->fd = -1;
+        return ret;
+    }
+
+    return ASYN_DONE;
+}
+
+
+unsigned int asyn_unix_accept(asyn_unix_t *listener, asyn_unix_t *ux, unsigned int opts) {
+    signed int fd;
+    unsigned int ret;
+
+    SUNDRY_ASSERT(listener != NULL);
+    SUNDRY_ASSERT(ux != NULL);
+
+    opts &= ASYN_UNIX_NBLOCK | ASYN_UNIX_CLOEXEC;
+    ret = asyn_os_accept(listener->fd, &fd, NULL, opts & ASYN_UNIX_NBLOCK, opts & ASYN_UNIX_CLOEXEC);
+    if(ret != ASYN_DONE) {
+        if(ret != ASYN_BLOCKED && ret != ASYN_FAILED) listener->error = ret;
+        return ret;
+    }
+
+    /* asyn_os_accept() already applied NBLOCK and CLOEXEC. */
+    ux->fd = fd;
+    ux->error = ASYN_NONE;
+    ux->opts = opts;
+    return ASYN_DONE;
+}
+
+
+unsigned int asyn_unix_connect(asyn_unix_t *ux, unsigned int opts, const char *path) {
+    signed int fd;
+    unsigned int ret;
+
+    SUNDRY_ASSERT(ux != NULL);
+    SUNDRY_ASSERT(path != NULL);
+
+    opts &= ASYN_UNIX_OPTS;
+    ret = asyn_os_uxsocket(&fd, opts & ASYN_UNIX_DGRAM, opts & ASYN_UNIX_CLOEXEC);
+    if(ret != ASYN_DONE) return ret;
+    ret = asyn_unix_setup(ux, fd, opts);
+    if(ret != ASYN_DONE) return ret;
+
+    /* Unlike TCP there is no connection in progress, so we close on ASYN_BLOCKED, too. */
+    ret = asyn_os_uxconnect(fd, path);
+    if(ret != ASYN_DONE) {
+        asyn_os_close(fd);
+        ux->fd = -1;
+    }
+    return ret;
+}
+
+
+unsigned int asyn_unix_pair(asyn_unix_t *a, asyn_unix_t *b, unsigned int opts) {
+    signed int fds[2];
+    unsigned int ret;
+
+    SUNDRY_ASSERT(a != NULL);
+    SUNDRY_ASSERT(b != NULL);
+
+    opts &= ASYN_UNIX_OPTS;
+    ret = asyn_os_uxpair(fds, opts & ASYN_UNIX_DGRAM, opts & ASYN_UNIX_CLOEXEC);
+    if(ret != ASYN_DONE) return ret;
+
+    ret = asyn_unix_setup(a, fds[0], opts);
+    if(ret != ASYN_DONE) {
+        asyn_os_close(fds[1]);
+        return ret;
+    }
+    ret = asyn_unix_setup(b, fds[1], opts);
+    if(ret != ASYN_DONE) {
+        asyn_unix_close(a);
+        return ret;
+    }
+
+    return ASYN_DONE;
+}
+
+
+void asyn_unix_close(asyn_unix_t *ux) {
+    SUNDRY_ASSERT(ux != NULL);
+
+    asyn_os_close(ux->fd);
+    ux->fd = -1;
+}
+
+
+unsigned int asyn_unix_send(asyn_unix_t *ux, const void *buf, size_t *size, const signed int *fds, unsigned int nfds) {
+    unsigned int ret;
+
+    SUNDRY_ASSERT(ux != NULL);
+    SUNDRY_ASSERT(size != NULL);
+    SUNDRY_ASSERT(buf != NULL || *size == 0);
+    SUNDRY_MASSERT(nfds <= ASYN_UNIX_FDMAX, "asyn_unix_send(): Too many descriptors.");
+
+    ret = asyn_os_uxsend(ux->fd, buf, size, fds, nfds);
+    if(ret != ASYN_DONE && ret != ASYN_BLOCKED) ux->error = ret;
+    return ret;
+}
+
+
+unsigned int asyn_unix_recv(asyn_unix_t *ux, void *buf, size_t *size, signed int *fds, unsigned int *nfds) {
+    unsigned int ret, num = 0;
+
+    SUNDRY_ASSERT(ux != NULL);
+    SUNDRY_ASSERT(size != NULL);
+    SUNDRY_ASSERT(buf != NULL || *size == 0);
+
+    if(!nfds) nfds = &num;
+    ret = asyn_os_uxrecv(ux->fd, buf, size, fds, nfds, ux->opts & ASYN_UNIX_CLOEXEC);
+    if(ret == ASYN_DONE) {
+        /* Empty datagrams are valid, an empty read of a stream is its end. */
+        if(*size == 0 && *nfds == 0 && !(ux->opts & ASYN_UNIX_DGRAM)) return ASYN_NONE;
+        return ASYN_DONE;
+    }
+    if(ret != ASYN_BLOCKED) ux->error = ret;
+    return ret;
+}
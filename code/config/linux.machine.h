@@ -8,7 +8,135 @@
  * - Created: 25. May 2009
  * - Lead-Dev: - David Herrmann
  * - Contributors: /
- * - Last-Change: 26. May 2009
+ * - Last-Change: 17. October 2026
  */
 
-#error "Not written yet."
+/* Linux configuration.
+ *
+ * This configuration runs on Linux systems with the GNU C library.
+ * This comment lists all platforms which are served by this header.
+ *
+ * Definitions file for all Linux platforms. This includes:
+ *  - Linux 3.0 and newer
+ * On all of the platforms supported by these systems. These are:
+ *  - x86
+ *  - x86_64
+ *  - ppc
+ *  - ppc64
+ *  - arm
+ * Older kernels lack sendmmsg(), SOCK_CLOEXEC or epoll_create1(). Please remove
+ * ONS_SOCKET_MMSG, ONS_SOCKET_EXTSOCK and ONS_POLL_EPOLL below if you are running
+ * on such a system.
+ * This file is not supposed to be included on any other platform.
+ */
+
+/* Several linux extensions like recvmmsg() are only declared by glibc if
+ * _GNU_SOURCE is defined before the first system header is included. This
+ * file is always included first, so we define it here.
+ */
+#ifndef _GNU_SOURCE
+    #define _GNU_SOURCE
+#endif
+
+/* Check endianness.
+ * <endian.h> is available with every glibc so we use it to get
+ * the required symbols.
+ */
+#include <endian.h>
+#if defined(__BYTE_ORDER) && (__BYTE_ORDER == __LITTLE_ENDIAN)
+    #define ONS_ARCH_LITTLEENDIAN
+#elif defined(__BYTE_ORDER) && (__BYTE_ORDER == __BIG_ENDIAN)
+    #define ONS_ARCH_BIGENDIAN
+#else
+    #error "linux.machine.h: Could not detect endiannes; ist this really a Linux system?"
+#endif
+
+/* pthread is the native thread library on Linux and
+ * the TMR extension is available since glibc 2.2.
+ */
+#define ONS_THREAD_PTHREAD
+#define ONS_THREAD_PTHREAD_TMR
+
+/* GCC and clang provide the __atomic_* builtins. */
+#define ONS_ATOMIC_GCC
+
+/* GetTimeOfDay() is available. */
+#define ONS_TIME_GTOD
+
+/* The full Berkeley Socket API is available including
+ * the SOCK_NONBLOCK/SOCK_CLOEXEC extension of socket().
+ */
+#define ONS_SOCKET_BERKELEY_HEADERS
+#define ONS_SOCKET_EXTSOCK
+#define ONS_SOCKET_IOCTL
+#define ONS_SOCKET_FCNTL
+
+/* recvmmsg() is available since 2.6.33 and sendmmsg() since 3.0. */
+#define ONS_SOCKET_MMSG
+
+/* UDP_SEGMENT is available since 4.18 and UDP_GRO since 5.0. Older kernels reject
+ * them at runtime, which is reported as ASYN_NOTSUPP, so we always define this.
+ */
+#define ONS_SOCKET_UDPSEG
+
+/* SO_REUSEPORT with load balancing is available since 3.9. */
+#define ONS_SOCKET_REUSEPORT
+
+/* SO_RXQ_OVFL is available since 2.6.33. */
+#define ONS_SOCKET_RXQOVFL
+
+/* SO_TIMESTAMPNS is available since 2.6.22. */
+#define ONS_SOCKET_TIMESTAMP
+
+/* io_uring with multishot recvmsg() and provided buffer rings needs 6.0. The
+ * completion ring returns ASYN_NOTSUPP on older kernels.
+ */
+#define ONS_SOCKET_URING
+
+/* MSG_ZEROCOPY for TCP is available since 4.14. Older kernels reject SO_ZEROCOPY at
+ * runtime and the TCP object falls back to copying.
+ */
+#define ONS_SOCKET_ZEROCOPY
+
+/* sendfile() to sockets is available since 2.2, splice() since 2.6.17 and pipe2()
+ * since 2.6.27.
+ */
+#define ONS_SOCKET_SENDFILE
+#define ONS_SOCKET_SPLICE
+
+/* SO_BUSY_POLL is available since 3.11 and SO_PREFER_BUSY_POLL since 5.11. The
+ * latter is silently skipped on older kernels.
+ */
+#define ONS_SOCKET_BUSYPOLL
+
+/* IP_PKTINFO is available since 2.2 and IPV6_RECVPKTINFO (RFC 3542) since 2.6.14. */
+#define ONS_SOCKET_PKTINFO
+
+/* MCAST_JOIN_GROUP and the source-specific requests of RFC 3678 are available since
+ * 2.6.15.
+ */
+#define ONS_SOCKET_MCAST
+
+/* SO_MAX_PACING_RATE is available since 3.13. UDP is only paced by the fq qdisc. */
+#define ONS_SOCKET_PACING
+
+/* SO_RCVBUFFORCE is available since 2.6.14 and SO_MEMINFO since 4.6. Older kernels
+ * only lose the fill level, which is detected at runtime.
+ */
+#define ONS_SOCKET_MEMINFO
+
+/* epoll is available since 2.6 and epoll_create1() since 2.6.27. */
+#define ONS_POLL_EPOLL
+
+/* eventfd() with flags is available since 2.6.27. */
+#define ONS_POLL_EVENTFD
+
+/* The context switch is hand-written for x86-64. All other architectures use
+ * ucontext which is part of every glibc. mmap() and mprotect() are always there.
+ */
+#if defined(__x86_64__)
+    #define ONS_CORO_X86_64
+#else
+    #define ONS_CORO_UCONTEXT
+#endif
+#define ONS_CORO_GUARD
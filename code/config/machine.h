@@ -8,7 +8,7 @@
  * - Created: 25. May 2009
  * - Lead-Dev: - David Herrmann
  * - Contributors: /
- * - Last-Change: 17. June 2009
+ * - Last-Change: 17. October 2026
  */
 
 /* ONS configuration
@@ -106,6 +106,17 @@
 /* #define ONS_THREAD_PTHREAD_TMR */
 
 
+/* Atomic operations
+ *
+ * If the compiler provides the __atomic_* builtins (GCC 4.7 and newer, clang), then
+ * define ONS_ATOMIC_GCC. If the Interlocked* functions are available through the
+ * Windows API then define ONS_ATOMIC_WIN.
+ * One of them must be defined.
+ */
+/* #define ONS_ATOMIC_GCC */
+/* #define ONS_ATOMIC_WIN */
+
+
 /* Precise time backend
  *
  * If the GetTimeOfDay() function is available on your platform through <sys/time.h> then define
@@ -136,6 +147,39 @@
  * - If the ioctl() syscall is available, define ONS_SOCKET_IOCTL.
  * - If the ioctlsocket() function is available, define ONS_SOCKET_IOCTLSOCKET.
  * - If the BSD address structures have a "len" member, then define ONS_SOCKET_ALEN.
+ * - If recvmmsg() and sendmmsg() are available to transfer several datagrams with a
+ *   single syscall, then define ONS_SOCKET_MMSG.
+ * - If UDP segmentation offload is available through the UDP_SEGMENT control message
+ *   and the UDP_GRO socket option (<netinet/udp.h>), then define ONS_SOCKET_UDPSEG.
+ * - If several sockets can be bound to the same port with SO_REUSEPORT and the kernel
+ *   balances incoming datagrams between them, then define ONS_SOCKET_REUSEPORT.
+ * - If the kernel reports its drop counter of a socket with every received datagram
+ *   (SO_RXQ_OVFL control message), then define ONS_SOCKET_RXQOVFL.
+ * - If received datagrams can be stamped by the kernel with a CLOCK_REALTIME
+ *   timestamp in nanoseconds (SO_TIMESTAMPNS), then define ONS_SOCKET_TIMESTAMP.
+ * - If the linux io_uring interface is available through <linux/io_uring.h> and the
+ *   raw syscalls (headers of linux 6.0 or newer), then define ONS_SOCKET_URING. This
+ *   enables the completion ring (asyn_ring_*).
+ * - If zero-copy transmission is available through SO_ZEROCOPY, MSG_ZEROCOPY and the
+ *   completion notifications of <linux/errqueue.h>, then define ONS_SOCKET_ZEROCOPY.
+ * - If sendfile() is available through <sys/sendfile.h> with the linux semantics (any
+ *   file to a socket), then define ONS_SOCKET_SENDFILE.
+ * - If splice() and pipe2() are available through <fcntl.h> and <unistd.h>, then
+ *   define ONS_SOCKET_SPLICE.
+ * - If sockets can busy poll the device queue with SO_BUSY_POLL, then define
+ *   ONS_SOCKET_BUSYPOLL.
+ * - If the destination address of received datagrams is reported and the source
+ *   address of sent datagrams can be selected with the IP_PKTINFO and IPV6_PKTINFO
+ *   control messages (struct in_pktinfo and RFC 3542), then define ONS_SOCKET_PKTINFO.
+ * - If multicast groups can be joined with the protocol independent requests of
+ *   RFC 3678 (MCAST_JOIN_GROUP, MCAST_JOIN_SOURCE_GROUP and struct group_req), then
+ *   define ONS_SOCKET_MCAST.
+ * - If the kernel can pace the output of a socket to the rate set with the
+ *   SO_MAX_PACING_RATE socket option, then define ONS_SOCKET_PACING.
+ * - If socket buffers can be set beyond the system limit with SO_RCVBUFFORCE and
+ *   SO_SNDBUFFORCE, their fill level is reported by SO_MEMINFO (<linux/sock_diag.h>)
+ *   and the kernel doubles the values of SO_RCVBUF and SO_SNDBUF for its bookkeeping
+ *   (linux semantics), then define ONS_SOCKET_MEMINFO.
  *
  * One of *_FCNTL, *_IOCTL, *_IOCTLSOCKET must be defined.
  * A combination of ONS_SOCKET_WIN_HEADERS with one of the following is invalid:
@@ -150,6 +194,58 @@
 /* #define ONS_SOCKET_IOCTL */
 /* #define ONS_SOCKET_IOCTLSOCKET */
 /* #define ONS_SOCKET_ALEN */
+/* #define ONS_SOCKET_MMSG */
+/* #define ONS_SOCKET_UDPSEG */
+/* #define ONS_SOCKET_URING */
+/* #define ONS_SOCKET_REUSEPORT */
+/* #define ONS_SOCKET_RXQOVFL */
+/* #define ONS_SOCKET_TIMESTAMP */
+/* #define ONS_SOCKET_ZEROCOPY */
+/* #define ONS_SOCKET_SENDFILE */
+/* #define ONS_SOCKET_SPLICE */
+/* #define ONS_SOCKET_BUSYPOLL */
+/* #define ONS_SOCKET_PKTINFO */
+/* #define ONS_SOCKET_MCAST */
+/* #define ONS_SOCKET_PACING */
+/* #define ONS_SOCKET_MEMINFO */
+
+
+/* Readiness notification
+ *
+ * Event loops need a way to wait for readiness on many file descriptors at once. The
+ * classic select() and poll() calls scale linearly with the number of watched
+ * descriptors, therefore, we use the faster kernel interfaces if available:
+ * - If epoll_create1(), epoll_ctl() and epoll_wait() are available through <sys/epoll.h>
+ *   then define ONS_POLL_EPOLL.
+ *
+ * If none of them is defined, the event loop is not available and returns ASYN_NOTSUPP.
+ *
+ * Other threads wake up a sleeping event loop through a descriptor which they make
+ * readable:
+ * - If eventfd() is available through <sys/eventfd.h> then define ONS_POLL_EVENTFD.
+ * If it is not defined, submission queues are not available and return ASYN_NOTSUPP.
+ */
+/* #define ONS_POLL_EPOLL */
+/* #define ONS_POLL_EVENTFD */
+
+
+/* Coroutines
+ *
+ * Coroutines switch between their stacks without a syscall if a hand-written context
+ * switch is available for the architecture:
+ * - On x86-64 with ELF objects and the System V ABI (linux, BSDs) define ONS_CORO_X86_64.
+ * Otherwise, if getcontext(), makecontext() and swapcontext() are available through
+ * <ucontext.h> then define ONS_CORO_UCONTEXT. This is slower since every switch saves
+ * and restores the signal mask with a syscall.
+ * If none of them is defined, coroutines are not available and return ASYN_NOTSUPP.
+ *
+ * If mmap(), mprotect() and sysconf() are available through <sys/mman.h> and <unistd.h>
+ * then define ONS_CORO_GUARD. Every coroutine stack gets an inaccessible guard page,
+ * so an overflow crashes the process instead of corrupting other memory.
+ */
+/* #define ONS_CORO_X86_64 */
+/* #define ONS_CORO_UCONTEXT */
+/* #define ONS_CORO_GUARD */
 
 
 /* Debug mode
@@ -8,7 +8,7 @@
  * - Created: 25. May 2009
  * - Lead-Dev: - David Herrmann
  * - Contributors: /
- * - Last-Change: 26. May 2009
+ * - Last-Change: 17. October 2026
  */
 
 /* MacOS configuration.
@@ -47,6 +47,9 @@
  */
 #define ONS_THREAD_PTHREAD
 
+/* Apple's GCC and clang provide the __atomic_* builtins. */
+#define ONS_ATOMIC_GCC
+
 /* GetTimeOfDay() is available on Mac OS X
  * as on any other good Unix system.
  */
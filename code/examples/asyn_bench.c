@@ -0,0 +1,540 @@
+/*
+ * (COPYRIGHT) Copyright (C) 2008, 2009, The ONS Team.
+ * This file is part of ONS, see COPYING for details.
+ */
+
+/*
+ * File information:
+ * - Created: 17. October 2026
+ * - Lead-Dev: - David Herrmann
+ * - Contributors: /
+ * - Last-Change: 17. October 2026
+ */
+
+/* This example is a UDP load generator and echo sink built on the
+ * asynchio batch functions and the event loop. It is the baseline
+ * for every change to the UDP path of libasynchio.
+ *
+ * Build it with "make bench" and run it from the code directory:
+ *   LD_LIBRARY_PATH=. ./examples/asyn_bench [options]
+ * Options:
+ *   -m mode: "both" (default) runs the sink in a second thread on
+ *            loopback, "sink" and "blast" run only one side.
+ *   -a addr: Address of the sink (default 127.0.0.1, IPv6 if it
+ *            contains a colon). The sink binds to it.
+ *   -p port: Port of the sink (default 0: random, only for "both").
+ *   -r rate: Datagrams per second of the blaster (0: unlimited).
+ *   -s size: Datagram size in bytes (at least 16).
+ *   -c num: Number of blaster sockets (concurrency).
+ *   -b num: Datagrams per batch call.
+ *   -t secs: Duration in seconds (0: the sink runs forever, only
+ *            for "sink").
+ *
+ * Both sides print one line per second and the blaster prints a
+ * summary with the loss and the percentiles of the round trip time.
+ * The exit status is not 0 if a socket could not be set up or a
+ * send failed, which also stops the blaster.
+ */
+
+
+#include "config/machine.h"
+#include "include.h"
+#include <sundry/sundry.h>
+#include <sundry/thread.h>
+#include <asynchio/asynchio.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+
+#define BENCH_MAXBATCH 64
+#define BENCH_MAXFLOWS 1024
+#define BENCH_MAXSIZE 65507
+#define BENCH_LINGER 200000
+
+/* Histogram of the round trip times in microseconds. Every power of two
+ * is split into 16 linear buckets, so the error is below 7%.
+ */
+#define BENCH_SUB 16
+#define BENCH_BUCKETS 1024
+
+
+/* Header at the beginning of every datagram. */
+typedef struct bench_hdr_t {
+    uint32_t flow;
+    uint32_t seq;
+    uint64_t stamp;
+} bench_hdr_t;
+
+
+typedef struct bench_flow_t {
+    struct bench_blast_t *blast;
+    asyn_udp_t udp;
+    asyn_ev_t ev;
+    uint32_t seq;
+} bench_flow_t;
+
+
+/* Configuration. */
+static const char *bench_mode = "both";
+static const char *bench_host = "127.0.0.1";
+static unsigned int bench_port = 0;
+static uint64_t bench_rate = 100000;
+static size_t bench_size = 64;
+static unsigned int bench_flows = 4;
+static unsigned int bench_batch = 32;
+static unsigned int bench_secs = 5;
+
+static asyn_addr_t bench_addr;
+static volatile unsigned int bench_stop = 0;
+
+
+/* Microseconds of the monotonic clock, so clock steps do not end up in the RTTs. */
+static uint64_t bench_now(void) {
+    return asyn_clock_now() / 1000;
+}
+
+
+static unsigned int bench_bucket(uint64_t value) {
+    unsigned int bit;
+
+    if(value < BENCH_SUB) return value;
+    for(bit = 63; !(value & ((uint64_t)1 << bit)); --bit) /* empty */ ;
+    return (bit - 3) * BENCH_SUB + ((value >> (bit - 4)) & (BENCH_SUB - 1));
+}
+
+
+/* Returns the lower bound of bucket \idx. */
+static uint64_t bench_bucket_value(unsigned int idx) {
+    if(idx < BENCH_SUB) return idx;
+    return (uint64_t)(BENCH_SUB + idx % BENCH_SUB) << (idx / BENCH_SUB - 1);
+}
+
+
+static uint64_t bench_percentile(const uint64_t *hist, uint64_t total, double pct) {
+    uint64_t sum = 0, want;
+    unsigned int i;
+
+    if(total == 0) return 0;
+    want = (uint64_t)(total * pct / 100.0);
+    if(want >= total) want = total - 1;
+    for(i = 0; i < BENCH_BUCKETS; ++i) {
+        sum += hist[i];
+        if(sum > want) return bench_bucket_value(i);
+    }
+    return 0;
+}
+
+
+/*
+ * Sink
+ * Receives batches, echoes every datagram to its sender and counts the
+ * gaps in the sequence numbers of every flow as loss.
+ */
+
+typedef struct bench_sink_t {
+    asyn_loop_t loop;
+    asyn_udp_t udp;
+    asyn_ev_t ev;
+    unsigned char *rxbufs;
+    uint64_t pkts;
+    uint64_t bytes;
+    uint64_t echoed;
+    uint32_t next[BENCH_MAXFLOWS];
+    uint64_t seen[BENCH_MAXFLOWS];
+} bench_sink_t;
+
+
+static unsigned int bench_sink_read(asyn_loop_t *loop, asyn_ev_t *ev) {
+    bench_sink_t *sink = ev->arg;
+    asyn_msg_t msgs[BENCH_MAXBATCH];
+    bench_hdr_t hdr;
+    unsigned int i, ret, done, sent;
+
+    memset(msgs, 0, sizeof(msgs));
+    for(i = 0; i < bench_batch; ++i) {
+        msgs[i].buf = &sink->rxbufs[i * BENCH_MAXSIZE];
+        msgs[i].size = BENCH_MAXSIZE;
+    }
+
+    ret = asyn_udp_recv_batch(&sink->udp, msgs, bench_batch, &done);
+    if(ret != ASYN_DONE) return ASYN_BLOCKED;
+
+    for(i = 0; i < done; ++i) {
+        ++sink->pkts;
+        sink->bytes += msgs[i].size;
+        if(msgs[i].size < sizeof(hdr)) continue;
+
+        memcpy(&hdr, msgs[i].buf, sizeof(hdr));
+        if(hdr.flow >= BENCH_MAXFLOWS) continue;
+        ++sink->seen[hdr.flow];
+        if(hdr.seq >= sink->next[hdr.flow]) sink->next[hdr.flow] = hdr.seq + 1;
+    }
+
+    /* The messages still carry the source addresses, so they are echoed as they are.
+     * If the socket is full, the rest of the echoes is dropped.
+     */
+    for(i = 0; i < done; i += sent) {
+        if(asyn_udp_send_batch(&sink->udp, &msgs[i], done - i, &sent) != ASYN_DONE) break;
+        sink->echoed += sent;
+    }
+
+    return ASYN_DONE;
+}
+
+
+static uint64_t bench_sink_loss(bench_sink_t *sink) {
+    uint64_t expected = 0, seen = 0;
+    unsigned int i;
+
+    for(i = 0; i < BENCH_MAXFLOWS; ++i) {
+        expected += sink->next[i];
+        seen += sink->seen[i];
+    }
+    return (expected > seen)?expected - seen:0;
+}
+
+
+static unsigned int bench_sink_init(bench_sink_t *sink) {
+    unsigned int ret;
+
+    memset(sink, 0, sizeof(*sink));
+    sink->rxbufs = malloc(bench_batch * BENCH_MAXSIZE);
+    if(!sink->rxbufs) return ASYN_MEMFAIL;
+    if(asyn_loop_init(&sink->loop, 0) != ASYN_DONE) {
+        free(sink->rxbufs);
+        return ASYN_FAILED;
+    }
+
+    ret = asyn_udp_init(&sink->udp, ASYN_UDP_NBLOCK, bench_addr.type, bench_addr.ip, bench_port);
+    if(ret != ASYN_DONE) {
+        asyn_loop_free(&sink->loop);
+        free(sink->rxbufs);
+        return ret;
+    }
+
+    asyn_ev_init(&sink->ev, asyn_udp_fd(&sink->udp), bench_sink_read, NULL, sink);
+    asyn_loop_add(&sink->loop, &sink->ev, ASYN_EV_READ);
+    return ASYN_DONE;
+}
+
+
+static void bench_sink_free(bench_sink_t *sink) {
+    asyn_loop_del(&sink->ev);
+    asyn_udp_close(&sink->udp);
+    asyn_loop_free(&sink->loop);
+    free(sink->rxbufs);
+}
+
+
+static void *bench_sink_main(void *arg) {
+    bench_sink_t *sink = arg;
+    uint64_t last, now, pkts = 0, bytes = 0, secs;
+
+    last = bench_now();
+    while(!bench_stop) {
+        asyn_loop_run_once(&sink->loop, 100);
+
+        now = bench_now();
+        if(now - last < 1000000) continue;
+        secs = (now - last) / 1000000;
+        printf("sink:  rx %10llu pps %10.2f MB/s  loss %llu\n", (unsigned long long)((sink->pkts - pkts) / secs),
+               (sink->bytes - bytes) / (double)secs / 1000000.0, (unsigned long long)bench_sink_loss(sink));
+        pkts = sink->pkts;
+        bytes = sink->bytes;
+        last += secs * 1000000;
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Blaster
+ * Sends datagrams round-robin over all flows. The rate is kept by sending the
+ * datagrams which are due since the start in batches. The echoes are received
+ * by the event loop and their round trip times are put into the histogram.
+ */
+
+typedef struct bench_blast_t {
+    asyn_loop_t loop;
+    bench_flow_t *flows;
+    unsigned int count;
+    unsigned char *txbufs;
+    unsigned char *rxbufs;
+    uint64_t sent;
+    uint64_t bytes;
+    uint64_t blocked;
+    uint64_t echoed;
+    uint64_t hist[BENCH_BUCKETS];
+    unsigned int error;
+} bench_blast_t;
+
+
+static unsigned int bench_blast_read(asyn_loop_t *loop, asyn_ev_t *ev) {
+    bench_flow_t *flow = ev->arg;
+    bench_blast_t *blast = flow->blast;
+    asyn_msg_t msgs[BENCH_MAXBATCH];
+    bench_hdr_t hdr;
+    unsigned int i, ret, done;
+    uint64_t now;
+
+    memset(msgs, 0, sizeof(msgs));
+    for(i = 0; i < bench_batch; ++i) {
+        msgs[i].buf = &blast->rxbufs[i * bench_size];
+        msgs[i].size = bench_size;
+    }
+
+    ret = asyn_udp_recv_batch(&flow->udp, msgs, bench_batch, &done);
+    if(ret != ASYN_DONE) return ASYN_BLOCKED;
+
+    now = bench_now();
+    for(i = 0; i < done; ++i) {
+        if(msgs[i].size < sizeof(hdr)) continue;
+        memcpy(&hdr, msgs[i].buf, sizeof(hdr));
+        ++blast->echoed;
+        ++blast->hist[bench_bucket((now > hdr.stamp)?now - hdr.stamp:0)];
+    }
+
+    return ASYN_DONE;
+}
+
+
+/* Sends up to \num datagrams on \flow. Returns the number of sent datagrams. A failed
+ * call is saved in \blast->error.
+ */
+static unsigned int bench_blast_send(bench_blast_t *blast, bench_flow_t *flow, unsigned int num) {
+    asyn_msg_t msgs[BENCH_MAXBATCH];
+    unsigned char *buf;
+    bench_hdr_t hdr;
+    unsigned int i, ret, done;
+
+    memset(msgs, 0, sizeof(msgs));
+    hdr.flow = flow - blast->flows;
+    hdr.stamp = bench_now();
+    for(i = 0; i < num; ++i) {
+        buf = &blast->txbufs[i * bench_size];
+        hdr.seq = flow->seq + i;
+        memcpy(buf, &hdr, sizeof(hdr));
+        msgs[i].buf = buf;
+        msgs[i].size = bench_size;
+        memcpy(&msgs[i].addr, &bench_addr, sizeof(bench_addr));
+    }
+
+    ret = asyn_udp_send_batch(&flow->udp, msgs, num, &done);
+    if(ret == ASYN_BLOCKED) ++blast->blocked;
+    else if(ret != ASYN_DONE) {
+        fprintf(stderr, "blast: send failed (%u)\n", ret);
+        blast->error = ret;
+    }
+
+    flow->seq += done;
+    blast->sent += done;
+    blast->bytes += done * bench_size;
+    return done;
+}
+
+
+static void bench_blast_free(bench_blast_t *blast) {
+    unsigned int i;
+
+    for(i = 0; i < blast->count; ++i) {
+        asyn_loop_del(&blast->flows[i].ev);
+        asyn_udp_close(&blast->flows[i].udp);
+    }
+    free(blast->flows);
+    free(blast->txbufs);
+    free(blast->rxbufs);
+    asyn_loop_free(&blast->loop);
+}
+
+
+static unsigned int bench_blast_init(bench_blast_t *blast) {
+    unsigned int i, ret;
+
+    memset(blast, 0, sizeof(*blast));
+    if(asyn_loop_init(&blast->loop, 0) != ASYN_DONE) return ASYN_FAILED;
+
+    blast->flows = calloc(bench_flows, sizeof(bench_flow_t));
+    blast->txbufs = calloc(bench_batch, bench_size);
+    blast->rxbufs = calloc(bench_batch, bench_size);
+    if(!blast->flows || !blast->txbufs || !blast->rxbufs) {
+        bench_blast_free(blast);
+        return ASYN_MEMFAIL;
+    }
+
+    for(i = 0; i < bench_flows; ++i) {
+        blast->flows[i].blast = blast;
+        ret = asyn_udp_init(&blast->flows[i].udp, ASYN_UDP_NBLOCK, bench_addr.type, NULL, 0);
+        if(ret != ASYN_DONE) {
+            bench_blast_free(blast);
+            return ret;
+        }
+        asyn_ev_init(&blast->flows[i].ev, asyn_udp_fd(&blast->flows[i].udp), bench_blast_read, NULL, &blast->flows[i]);
+        asyn_loop_add(&blast->loop, &blast->flows[i].ev, ASYN_EV_READ);
+        ++blast->count;
+    }
+
+    return ASYN_DONE;
+}
+
+
+static void bench_blast_report(bench_blast_t *blast, uint64_t usecs) {
+    double secs = usecs / 1000000.0;
+    uint64_t loss;
+
+    loss = (blast->sent > blast->echoed)?blast->sent - blast->echoed:0;
+    printf("\nsummary: %llu datagrams of %lu bytes over %u sockets in %.2fs\n", (unsigned long long)blast->sent,
+           (unsigned long)bench_size, bench_flows, secs);
+    printf("  tx:   %12.0f pps %10.2f MB/s (blocked %llu times)\n", blast->sent / secs, blast->bytes / secs / 1000000.0,
+           (unsigned long long)blast->blocked);
+    printf("  echo: %12.0f pps  loss %llu (%.3f%%)\n", blast->echoed / secs, (unsigned long long)loss,
+           blast->sent?loss * 100.0 / blast->sent:0.0);
+    printf("  rtt:  p50 %llu us  p90 %llu us  p99 %llu us  p99.9 %llu us  max %llu us\n",
+           (unsigned long long)bench_percentile(blast->hist, blast->echoed, 50.0),
+           (unsigned long long)bench_percentile(blast->hist, blast->echoed, 90.0),
+           (unsigned long long)bench_percentile(blast->hist, blast->echoed, 99.0),
+           (unsigned long long)bench_percentile(blast->hist, blast->echoed, 99.9),
+           (unsigned long long)bench_percentile(blast->hist, blast->echoed, 100.0));
+}
+
+
+static unsigned int bench_blast_run(void) {
+    bench_blast_t *blast;
+    uint64_t start, now, end, last, due, pkts = 0, echoed = 0;
+    unsigned int ret, num, flow = 0;
+
+    blast = malloc(sizeof(*blast));
+    if(!blast) return ASYN_MEMFAIL;
+    ret = bench_blast_init(blast);
+    if(ret != ASYN_DONE) {
+        fprintf(stderr, "blast: cannot create the sockets (%u)\n", ret);
+        free(blast);
+        return ret;
+    }
+
+    start = last = now = bench_now();
+    end = start + bench_secs * (uint64_t)1000000;
+    while(!blast->error && (now = bench_now()) < end) {
+        due = bench_rate?(now - start) * bench_rate / 1000000 - blast->sent:bench_batch * bench_flows;
+
+        /* Send what is due but give the loop a chance after every round over the
+         * flows, so the echoes do not overflow the receive queues.
+         */
+        for(num = bench_flows; due > 0 && num > 0; --num) {
+            ret = bench_blast_send(blast, &blast->flows[flow], (due < bench_batch)?due:bench_batch);
+            flow = (flow + 1) % bench_flows;
+            if(ret == 0) break;
+            due -= ret;
+        }
+
+        asyn_loop_run_once(&blast->loop, 0);
+        if(bench_rate && due == 0) usleep(100);
+
+        if(now - last >= 1000000) {
+            printf("blast: tx %10llu pps %10.2f MB/s  echo %10llu pps\n", (unsigned long long)(blast->sent - pkts),
+                   (blast->sent - pkts) * bench_size / 1000000.0, (unsigned long long)(blast->echoed - echoed));
+            pkts = blast->sent;
+            echoed = blast->echoed;
+            last += 1000000;
+        }
+    }
+
+    /* Collect the echoes which are still in flight. */
+    while(bench_now() < now + BENCH_LINGER && blast->echoed < blast->sent) asyn_loop_run_once(&blast->loop, 10);
+
+    bench_blast_report(blast, now - start);
+    ret = blast->error?blast->error:ASYN_DONE;
+    bench_blast_free(blast);
+    free(blast);
+    return ret;
+}
+
+
+static void bench_usage(const char *name) {
+    fprintf(stderr, "Usage: %s [-m both|sink|blast] [-a addr] [-p port] [-r pps] [-s size] [-c sockets] [-b batch] [-t secs]\n", name);
+    exit(EXIT_FAILURE);
+}
+
+
+int main(int argc, char **argv) {
+    sundry_thread_t thread;
+    bench_sink_t *sink = NULL;
+    asyn_addr_t local;
+    signed int opt;
+    unsigned int ret = ASYN_DONE;
+
+    while((opt = getopt(argc, argv, "m:a:p:r:s:c:b:t:")) != -1) {
+        switch(opt) {
+            case 'm': bench_mode = optarg; break;
+            case 'a': bench_host = optarg; break;
+            case 'p': bench_port = atoi(optarg); break;
+            case 'r': bench_rate = strtoull(optarg, NULL, 10); break;
+            case 's': bench_size = atoi(optarg); break;
+            case 'c': bench_flows = atoi(optarg); break;
+            case 'b': bench_batch = atoi(optarg); break;
+            case 't': bench_secs = atoi(optarg); break;
+            default: bench_usage(argv[0]);
+        }
+    }
+
+    if(bench_size < sizeof(bench_hdr_t) || bench_size > BENCH_MAXSIZE) bench_usage(argv[0]);
+    if(bench_flows == 0 || bench_flows > BENCH_MAXFLOWS) bench_usage(argv[0]);
+    if(bench_batch == 0 || bench_batch > BENCH_MAXBATCH) bench_usage(argv[0]);
+    if(bench_secs == 0 && strcmp(bench_mode, "sink") != 0) bench_usage(argv[0]);
+
+    memset(&bench_addr, 0, sizeof(bench_addr));
+    bench_addr.type = strchr(bench_host, ':')?ASYN_IPV6:ASYN_IPV4;
+    if(asyn_str2addr(bench_addr.type, bench_host, bench_addr.ip) != ASYN_DONE) bench_usage(argv[0]);
+
+    if(strcmp(bench_mode, "blast") != 0) {
+        sink = malloc(sizeof(*sink));
+        if(!sink || (ret = bench_sink_init(sink)) != ASYN_DONE) {
+            fprintf(stderr, "sink: cannot bind to %s:%u\n", bench_host, bench_port);
+            free(sink);
+            return EXIT_FAILURE;
+        }
+        asyn_udp_addr(&sink->udp, &local);
+        bench_port = local.port;
+        printf("sink: listening on %s port %u\n", bench_host, bench_port);
+    }
+    else if(bench_port == 0) bench_usage(argv[0]);
+    bench_addr.port = bench_port;
+
+    if(strcmp(bench_mode, "sink") == 0) {
+        if(bench_secs) {
+            if(!sundry_thread_run(&thread, bench_sink_main, sink)) {
+                fprintf(stderr, "sink: cannot start the thread\n");
+                bench_sink_free(sink);
+                free(sink);
+                return EXIT_FAILURE;
+            }
+            sleep(bench_secs);
+            bench_stop = 1;
+            sundry_thread_join(&thread);
+        }
+        else bench_sink_main(sink);
+    }
+    else if(sink) {
+        if(!sundry_thread_run(&thread, bench_sink_main, sink)) {
+            fprintf(stderr, "sink: cannot start the thread\n");
+            bench_sink_free(sink);
+            free(sink);
+            return EXIT_FAILURE;
+        }
+        ret = bench_blast_run();
+        bench_stop = 1;
+        sundry_thread_join(&thread);
+        printf("  sink: %llu received, %llu echoed, %llu lost\n", (unsigned long long)sink->pkts,
+               (unsigned long long)sink->echoed, (unsigned long long)bench_sink_loss(sink));
+    }
+    else ret = bench_blast_run();
+
+    if(sink) {
+        bench_sink_free(sink);
+        free(sink);
+    }
+    return (ret == ASYN_DONE)?EXIT_SUCCESS:EXIT_FAILURE;
+}
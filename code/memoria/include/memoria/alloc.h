@@ -8,7 +8,7 @@
  * - Created: 18. December 2008
  * - Lead-Dev: - David Herrmann
  * - Contributors: /
- * - Last-Change: 26. May 2009
+ * - Last-Change: 17. October 2026
  */
 
 /* This interface wraps the traditional malloc()'ish functions
@@ -126,6 +126,41 @@ static char *mem_strdup(const char *str) {
     return ret;
 }
 
+/* Allocates a big memory block of \size bytes whose address is a multiple of \align
+ * and returns a pointer to it. \align must be a power of 2. This is used to carve
+ * many small objects out of one allocation, for instance, to align every object to a
+ * cache line.
+ * Calls the global out-of-mem handler if the allocation fails.
+ * If \size equals zero the behaviour is undefined.
+ * The returned value must be freed with mem_block_free().
+ */
+static void *mem_block_alloc(size_t size, size_t align) {
+    unsigned char *raw, *ret;
+
+    SUNDRY_ASSERT(size > 0);
+    SUNDRY_ASSERT(align > 0 && (align & (align - 1)) == 0);
+
+    /* We store the pointer of the real allocation right in front of the
+     * aligned block.
+     */
+    if(align < sizeof(void*)) align = sizeof(void*);
+    raw = mem_malloc(size + align + sizeof(void*));
+    ret = (unsigned char*)(((uintptr_t)raw + sizeof(void*) + align - 1) & ~(uintptr_t)(align - 1));
+    memcpy(ret - sizeof(void*), &raw, sizeof(void*));
+    return ret;
+}
+
+/* Frees a block which was allocated with mem_block_alloc().
+ * If \mem is NULL, nothing is done.
+ */
+static void mem_block_free(void *mem) {
+    void *raw;
+
+    if(!mem) return;
+    memcpy(&raw, (unsigned char*)mem - sizeof(void*), sizeof(void*));
+    free(raw);
+}
+
 /* Frees memory blocks.
  * If \mem is NULL, nothing is done.
  * \mem should be the pointer returned by the allocation functions.
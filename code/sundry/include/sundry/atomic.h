@@ -0,0 +1,98 @@
+/*
+ * (COPYRIGHT) Copyright (C) 2008, 2009, The ONS Team.
+ * This file is part of ONS, see COPYING for details.
+ */
+
+/*
+ * File information:
+ * - Created: 17. October 2026
+ * - Lead-Dev: - David Herrmann
+ * - Contributors: /
+ * - Last-Change: 17. October 2026
+ */
+
+/* Atomic operations.
+ * Provides a small set of atomic operations on integers and pointers which
+ * can be used to share data between threads without a mutex.
+ * Loads have acquire semantics, stores have release semantics and all
+ * read-modify-write operations are full barriers.
+ *
+ * Integer operations work on \sundry_atomic_t:
+ * - sundry_atomic_load(ptr): Returns the value of \*ptr.
+ * - sundry_atomic_store(ptr, val): Sets \*ptr to \val.
+ * - sundry_atomic_add(ptr, val): Adds \val to \*ptr and returns the new value.
+ * - sundry_atomic_sub(ptr, val): Subtracts \val from \*ptr and returns the new value.
+ * - sundry_atomic_cas(ptr, old, val): Sets \*ptr to \val if it equals \old. Returns
+ *                                     1 if \*ptr was changed, otherwise 0.
+ * - sundry_atomic_xchg(ptr, val): Sets \*ptr to \val and returns the old value.
+ * Pointer operations work on "void * volatile" and have the same semantics:
+ * - sundry_atomic_loadptr(ptr)
+ * - sundry_atomic_storeptr(ptr, val)
+ * - sundry_atomic_casptr(ptr, old, val)
+ * - sundry_atomic_xchgptr(ptr, val)
+ * - sundry_atomic_fence(): Full memory barrier.
+ */
+
+
+#include <sundry/sundry.h>
+
+#ifndef SUNDRY_INCLUDED_sundry_atomic_h
+#define SUNDRY_INCLUDED_sundry_atomic_h
+SUNDRY_EXTERN_C_BEGIN
+
+
+#if defined(ONS_ATOMIC_GCC)
+    typedef volatile long sundry_atomic_t;
+
+    #define sundry_atomic_load(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+    #define sundry_atomic_store(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+    #define sundry_atomic_add(ptr, val) __atomic_add_fetch((ptr), (val), __ATOMIC_SEQ_CST)
+    #define sundry_atomic_sub(ptr, val) __atomic_sub_fetch((ptr), (val), __ATOMIC_SEQ_CST)
+    #define sundry_atomic_cas(ptr, old, val) sundry_atomic_gcc_cas((ptr), (old), (val))
+    #define sundry_atomic_xchg(ptr, val) __atomic_exchange_n((ptr), (val), __ATOMIC_SEQ_CST)
+
+    #define sundry_atomic_loadptr(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+    #define sundry_atomic_storeptr(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+    #define sundry_atomic_casptr(ptr, old, val) sundry_atomic_gcc_casptr((ptr), (old), (val))
+    #define sundry_atomic_xchgptr(ptr, val) __atomic_exchange_n((ptr), (val), __ATOMIC_SEQ_CST)
+
+    #define sundry_atomic_fence() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+    /* __atomic_compare_exchange_n() writes the current value into \old on failure,
+     * so we need a copy to keep the macro free of side effects.
+     */
+    static unsigned int sundry_atomic_gcc_cas(sundry_atomic_t *ptr, long old, long val) {
+        return __atomic_compare_exchange_n(ptr, &old, val, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)?1:0;
+    }
+    static unsigned int sundry_atomic_gcc_casptr(void * volatile *ptr, void *old, void *val) {
+        return __atomic_compare_exchange_n(ptr, &old, val, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)?1:0;
+    }
+#elif defined(ONS_ATOMIC_WIN)
+    #include <windows.h>
+    typedef volatile LONG sundry_atomic_t;
+
+    /* Aligned stores are atomic on windows platforms and the barrier in front gives
+     * them release semantics. A barrier in front of a load does not keep later loads
+     * behind it, so loads are done with an interlocked call which never changes the
+     * value but is a full barrier.
+     */
+    #define sundry_atomic_load(ptr) InterlockedCompareExchange((ptr), 0, 0)
+    #define sundry_atomic_store(ptr, val) do { MemoryBarrier(); *(ptr) = (val); } while(0)
+    #define sundry_atomic_add(ptr, val) (InterlockedExchangeAdd((ptr), (val)) + (val))
+    #define sundry_atomic_sub(ptr, val) (InterlockedExchangeAdd((ptr), -(val)) - (val))
+    #define sundry_atomic_cas(ptr, old, val) ((InterlockedCompareExchange((ptr), (val), (old)) == (old))?1:0)
+    #define sundry_atomic_xchg(ptr, val) InterlockedExchange((ptr), (val))
+
+    #define sundry_atomic_loadptr(ptr) InterlockedCompareExchangePointer((ptr), NULL, NULL)
+    #define sundry_atomic_storeptr(ptr, val) do { MemoryBarrier(); *(ptr) = (val); } while(0)
+    #define sundry_atomic_casptr(ptr, old, val) ((InterlockedCompareExchangePointer((ptr), (val), (old)) == (old))?1:0)
+    #define sundry_atomic_xchgptr(ptr, val) InterlockedExchangePointer((ptr), (val))
+
+    #define sundry_atomic_fence() MemoryBarrier()
+#else
+    #error "No atomic backend specified. Please check your ONS configuration."
+#endif
+
+
+SUNDRY_EXTERN_C_END
+#endif /* SUNDRY_INCLUDED_sundry_atomic_h */